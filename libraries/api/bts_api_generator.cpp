@@ -1,5 +1,4 @@
 #include <bts/api/api_metadata.hpp>
-#include <bts/api/global_api_logger.hpp>
 #include <bts/utilities/string_escape.hpp>
 #include <fc/optional.hpp>
 #include <fc/filesystem.hpp>
@@ -183,14 +182,11 @@ public:
 private:
   void write_includes_to_stream(std::ostream& stream);
   void generate_prerequisite_checks_to_stream(const method_description& method, std::ostream& stream);
+  void generate_default_value_to_stream(const parameter_description& parameter, std::ostream& stream);
   void generate_positional_server_implementation_to_stream(const method_description& method, const std::string& server_classname, std::ostream& stream);
   void generate_named_server_implementation_to_stream(const method_description& method, const std::string& server_classname, std::ostream& stream);
   void generate_server_call_to_client_to_stream(const method_description& method, std::ostream& stream);
   std::string generate_detailed_description_for_method(const method_description& method);
-#if BTS_GLOBAL_API_LOG
-  void create_global_api_entry_log_for_method( std::ostream& cpp_file, const fc::string& client_classname, const method_description& method );
-  void create_global_api_exit_log_for_method( std::ostream& cpp_file, const fc::string& client_classname, const method_description& method );
-#endif
   void write_generated_file_header(std::ostream& stream);
   std::string create_logging_statement_for_method(const method_description& method);
 
@@ -693,6 +689,20 @@ void api_generator::generate_server_call_to_client_to_stream(const method_descri
     stream << "  return fc::variant(result);\n";
 }
 
+// Defaults are converted from their JSON the first time a call leaves the parameter out, and kept.
+// Calls that pass the parameter never convert it, so a default that does not convert only fails those that use it.
+void api_generator::generate_default_value_to_stream(const parameter_description& parameter, std::ostream& stream)
+{
+  const std::string type = parameter.type->get_cpp_return_type();
+  stream << "  const auto " << parameter.name << "_default = []() -> const " << type << "& {\n";
+  stream << "    static const " << type << " default_value =\n";
+  stream << "      " << parameter.type->create_value_of_type_from_variant(*parameter.default_value) << ";\n";
+  stream << "    return default_value;\n";
+  stream << "  };\n";
+}
+
+// The wrappers read their arguments in place from the array the request parser built and convert each one
+// once; callers pass that array by reference. Results are returned as an fc::variant for the reply encoder.
 void api_generator::generate_positional_server_implementation_to_stream(const method_description& method, const std::string& server_classname, std::ostream& stream)
 {
   stream << "fc::variant " << server_classname << "::" << method.name << "_positional(fc::rpc::json_connection* json_connection, const fc::variants& parameters)\n";
@@ -708,9 +718,10 @@ void api_generator::generate_positional_server_implementation_to_stream(const me
 
     if (parameter.default_value)
     {
+      generate_default_value_to_stream(parameter, stream);
       stream << "  " << parameter.type->get_cpp_return_type() << " " << parameter.name << 
                   " = (parameters.size() <= " << parameter_index << ") ?\n";
-      stream << "    (" << parameter.type->create_value_of_type_from_variant(*parameter.default_value) << ") :\n";
+      stream << "    " << parameter.name << "_default() :\n";
       stream << "    " << parameter.type->convert_variant_to_object_of_type(this_parameter.str()) << ";\n";
     }
     else
@@ -742,9 +753,10 @@ void api_generator::generate_named_server_implementation_to_stream(const method_
 
     if (parameter.default_value)
     {
+      generate_default_value_to_stream(parameter, stream);
       stream << "  " << parameter.type->get_cpp_return_type() << " " << parameter.name << 
-                  " = parameters.contains(\"" << parameter.name << "\") ? \n";
-      stream << "    (" << parameter.type->create_value_of_type_from_variant(*parameter.default_value) << ") :\n";
+                  " = !parameters.contains(\"" << parameter.name << "\") ?\n";
+      stream << "    " << parameter.name << "_default() :\n";
       stream << "    " << parameter.type->convert_variant_to_object_of_type(this_parameter.str()) << ";\n";
     }
     else
@@ -816,6 +828,7 @@ void api_generator::generate_rpc_server_files(const fc::path& rpc_server_output_
   header_file << "    virtual void verify_wallet_is_unlocked() const = 0;\n";
   header_file << "    virtual void verify_connected_to_network() const = 0;\n\n";
   header_file << "    virtual void store_method_metadata(const bts::api::method_data& method_metadata) = 0;\n";
+  header_file << "    typedef fc::variant (" << server_classname << "::*positional_method)(fc::rpc::json_connection* json_connection, const fc::variants& parameters);\n";
   header_file << "    fc::variant direct_invoke_positional_method(const std::string& method_name, const fc::variants& parameters);\n";
   header_file << "    void register_" << _api_classname << "_methods(const fc::rpc::json_connection_ptr& json_connection);\n\n";
   header_file << "    void register_" << _api_classname << "_method_metadata();\n\n";
@@ -834,6 +847,7 @@ void api_generator::generate_rpc_server_files(const fc::path& rpc_server_output_
   server_cpp_file << "#include <bts/api/api_metadata.hpp>\n";
   server_cpp_file << "#include <bts/api/conversion_functions.hpp>\n";
   server_cpp_file << "#include <boost/bind.hpp>\n";
+  server_cpp_file << "#include <unordered_map>\n";
   write_includes_to_stream(server_cpp_file);
   server_cpp_file << "\n";
   server_cpp_file << "namespace bts { namespace rpc_stubs {\n\n";
@@ -888,9 +902,12 @@ void api_generator::generate_rpc_server_files(const fc::path& rpc_server_output_
         server_cpp_file << ",";
       server_cpp_file << "\n        {\"" << parameter.name << "\", \"" << parameter.type->get_type_name() <<  "\", bts::api::";
       if (parameter.default_value)
-        server_cpp_file << "optional_positional, fc::variant(fc::json::from_string(" << bts::utilities::escape_string_for_c_source_code(fc::json::to_string(parameter.default_value)) << "))}";
+        server_cpp_file << "optional_positional, fc::variant(fc::json::from_string(" << bts::utilities::escape_string_for_c_source_code(fc::json::to_string(parameter.default_value)) << "))";
       else
-        server_cpp_file << "required_positional, fc::ovariant()}";
+        server_cpp_file << "required_positional, fc::ovariant()";
+      if (parameter.type->get_obscure_in_log_files())
+        server_cpp_file << ", true";
+      server_cpp_file << "}";
     }
     if( !first_parameter )
       server_cpp_file << "\n      ";
@@ -910,7 +927,7 @@ void api_generator::generate_rpc_server_files(const fc::path& rpc_server_output_
         server_cpp_file << "\"" << alias << "\"";
       }
     }
-    server_cpp_file << "}, " << (method.cached ? "true" : "false")<<"};\n";
+    server_cpp_file << "}, " << (method.cached ? "true" : "false") << ", " << (method.is_const ? "true" : "false") << "};\n";
       
     server_cpp_file << "    store_method_metadata(" << method.name << "_method_metadata);\n";
     server_cpp_file << "  }\n\n";
@@ -920,66 +937,19 @@ void api_generator::generate_rpc_server_files(const fc::path& rpc_server_output_
   // generate a function for directly invoking a method, probably a stop-gap until we finish migrating all methods to this code
   server_cpp_file << "fc::variant " << server_classname << "::direct_invoke_positional_method(const std::string& method_name, const fc::variants& parameters)\n";
   server_cpp_file << "{\n";
+  server_cpp_file << "  static const std::unordered_map<std::string, positional_method> methods = {\n";
   for (const method_description& method : _methods)
-  {
-    server_cpp_file << "  if (method_name == \"" << method.name << "\")\n";
-    server_cpp_file << "    return " << method.name << "_positional(nullptr, parameters);\n";
-  }
-  server_cpp_file << "  FC_ASSERT(false, \"shouldn't happen\");\n";
+    server_cpp_file << "    {\"" << method.name << "\", &" << server_classname << "::" << method.name << "_positional},\n";
+  server_cpp_file << "  };\n";
+  server_cpp_file << "  auto iter = methods.find(method_name);\n";
+  server_cpp_file << "  FC_ASSERT(iter != methods.end(), \"shouldn't happen\");\n";
+  server_cpp_file << "  return (this->*iter->second)(nullptr, parameters);\n";
   server_cpp_file << "}\n";
 
   server_cpp_file << "\n";
   server_cpp_file << "} } // end namespace bts::rpc_stubs\n";
 }
 
-#if BTS_GLOBAL_API_LOG
-void api_generator::create_global_api_entry_log_for_method(
-    std::ostream& cpp_file,
-    const fc::string& client_classname,
-    const method_description& method
-    )
-{
-  cpp_file << "  bts::api::global_api_logger* glog = bts::api::global_api_logger::get_instance();\n"
-              "  uint64_t call_id = 0;\n"
-              "  fc::variants args;\n"
-              "  if( glog != NULL )\n"
-              "  {\n";
-  
-  for( const parameter_description& param : method.parameters )
-  {
-    if( param.type->get_obscure_in_log_files() )
-    {
-      cpp_file << "    if( glog->obscure_passwords() )\n"
-                  "      args.push_back( fc::variant(\"*********\") );\n"
-                  "    else\n"
-                  "      ";
-    }
-    else
-      cpp_file << "    ";
-
-    cpp_file << "args.push_back( " <<
-        param.type->convert_object_of_type_to_variant( param.name )
-        << " );\n";
-  }
-  cpp_file << "    call_id = glog->log_call_started( this, \"" << method.name << "\", args );\n"
-              "  }\n";
-  return;
-}
-
-void api_generator::create_global_api_exit_log_for_method(
-    std::ostream& cpp_file,
-    const fc::string& client_classname,
-    const method_description& method
-    )
-{
-  cpp_file << "    if( call_id != 0 )\n"
-              "      glog->log_call_finished( call_id, this, \"" << method.name << "\", args, "
-           << method.return_type->convert_object_of_type_to_variant( "result" )
-           << " );\n";
-  return;
-}
-#endif
-
 void api_generator::generate_client_files(const fc::path& client_output_dir, const std::string& generated_filename_suffix)
 {
   fc::path client_header_path = client_output_dir / "include" / "bts" / "rpc_stubs";
@@ -1010,10 +980,6 @@ void api_generator::generate_client_files(const fc::path& client_output_dir, con
   interceptor_header_file << "} } // end namespace bts::rpc_stubs\n";
 
   interceptor_cpp_file << "#define DEFAULT_LOGGER \"rpc\"\n";
-#if BTS_GLOBAL_API_LOG
-  interceptor_cpp_file << "#include <bts/api/global_api_logger.hpp>\n";
-  interceptor_cpp_file << "#include <bts/api/conversion_functions.hpp>\n";
-#endif
   interceptor_cpp_file << "#include <bts/rpc_stubs/" << interceptor_classname << ".hpp>\n\n";
   interceptor_cpp_file << "namespace bts { namespace rpc_stubs {\n\n";
 
@@ -1022,10 +988,6 @@ void api_generator::generate_client_files(const fc::path& client_output_dir, con
     interceptor_cpp_file << generate_signature_for_method(method, interceptor_classname, false) << "\n";
     interceptor_cpp_file << "{\n";
     interceptor_cpp_file << "  " << create_logging_statement_for_method(method) << "\n";
-#if BTS_GLOBAL_API_LOG
-    create_global_api_entry_log_for_method( interceptor_cpp_file, interceptor_classname, method );
-    interceptor_cpp_file << "\n";
-#endif
     interceptor_cpp_file << "  struct scope_exit\n";
     interceptor_cpp_file << "  {\n";
     interceptor_cpp_file << "    fc::time_point start_time;\n";
@@ -1036,26 +998,12 @@ void api_generator::generate_client_files(const fc::path& client_output_dir, con
     interceptor_cpp_file << "  {\n";
     interceptor_cpp_file << "    ";
     bool is_void = !!std::dynamic_pointer_cast<void_type_mapping>(method.return_type);
-#if BTS_GLOBAL_API_LOG
-    if( !is_void )
-      interceptor_cpp_file << method.return_type->get_cpp_return_type() << " result = ";
-    else
-      interceptor_cpp_file << "std::nullptr_t result = nullptr;\n    ";
-#else
     if( !is_void )
       interceptor_cpp_file << "return ";
-#endif
     std::list<std::string> args;
     for (const parameter_description& param : method.parameters)
       args.push_back(param.name);
     interceptor_cpp_file << "get_impl()->" << method.name << "(" << boost::join(args, ", ") << ");\n";
-#if BTS_GLOBAL_API_LOG
-    create_global_api_exit_log_for_method( interceptor_cpp_file, interceptor_classname, method );
-    if( !is_void )
-      interceptor_cpp_file << "\n    return result;\n";
-    else
-      interceptor_cpp_file << "\n    return;\n";
-#endif
     interceptor_cpp_file << "  }\n";
     interceptor_cpp_file << "  FC_RETHROW_EXCEPTIONS(warn, \"\")\n";
     interceptor_cpp_file << "}\n\n";
@@ -28,27 +28,32 @@ namespace bts { namespace api {
     std::string type;
     parameter_classification classification;
     fc::ovariant default_value;
+    bool obscure_in_log_files = false; /* passphrases and keys, never written to logs or traces */
     parameter_data(){}
     parameter_data(const parameter_data& rhs) :
       name(rhs.name),
       type(rhs.type),
       classification(rhs.classification),
-      default_value(rhs.default_value)
+      default_value(rhs.default_value),
+      obscure_in_log_files(rhs.obscure_in_log_files)
     {}
     parameter_data(const parameter_data&& rhs) :
       name(std::move(rhs.name)),
       type(std::move(rhs.type)),
       classification(std::move(rhs.classification)),
-      default_value(std::move(rhs.default_value))
+      default_value(std::move(rhs.default_value)),
+      obscure_in_log_files(rhs.obscure_in_log_files)
     {}
     parameter_data(std::string name,
                     std::string type,
                     parameter_classification classification,
-                    fc::ovariant default_value) :
+                    fc::ovariant default_value,
+                    bool obscure_in_log_files = false) :
       name(name),
       type(type),
       classification(classification),
-      default_value(default_value)
+      default_value(default_value),
+      obscure_in_log_files(obscure_in_log_files)
     {}
     parameter_data& operator=(const parameter_data& rhs)
     {
@@ -56,6 +61,7 @@ namespace bts { namespace api {
       type = rhs.type;
       classification = rhs.classification;
       default_value = rhs.default_value;
+      obscure_in_log_files = rhs.obscure_in_log_files;
       return *this;
     }
   };
@@ -73,6 +79,7 @@ namespace bts { namespace api {
     std::string                 detailed_description;
     std::vector<std::string>    aliases;
     bool                        cached;
+    bool                        is_const;
   };
 
 } } // end namespace bts::api
@@ -1,6 +1,7 @@
 #include <bts/blockchain/asset.hpp>
 #include <bts/blockchain/config.hpp>
 #include <bts/blockchain/exceptions.hpp>
+#include <bts/blockchain/wide_integer.hpp>
 
 #include <fc/reflect/variant.hpp>
 #include <fc/uint128.hpp>
@@ -10,6 +11,26 @@
 
 namespace bts { namespace blockchain {
 
+  namespace
+  {
+     const uint64_t real128_precision = FC_REAL128_PRECISION;
+
+     /** |v| without overflowing on INT64_MIN */
+     uint64_t magnitude( const share_type v )
+     {
+        return v < 0 ? uint64_t( -( v + 1 ) ) + 1 : uint64_t( v );
+     }
+
+     /** Same semantics as fc::bigint::to_int64() on a value with the given sign */
+     template<unsigned Limbs>
+     share_type to_share( const wide_uint<Limbs>& value, const bool negative )
+     {
+        FC_ASSERT( value.num_bits() <= 63 );
+        const share_type result = share_type( value.limb[ 0 ] );
+        return negative ? -result : result;
+     }
+  }
+
   price operator *( const price& l, const price& r )
   { try {
      FC_ASSERT( l.quote_asset_id == r.quote_asset_id );
@@ -36,16 +57,15 @@ namespace bts { namespace blockchain {
      if( r.ratio == fc::uint128_t(0) )
          return r;
 
-     fc::bigint product = l.ratio;
-     product *= r.ratio;
-     product /= FC_REAL128_PRECISION;
+     wide_uint<4> product = wide_uint<4>( l.ratio ) * wide_uint<4>( r.ratio );
+     product.divide( real128_precision );
 
      // if the quotient is zero, it means there was an underflow
      //    (i.e. the result is nonzero but too small to represent)
-     if( product == fc::bigint() )
+     if( product.is_zero() )
          FC_THROW_EXCEPTION( price_multiplication_underflow, "price multiplication underflow" );
 
-     static fc::bigint bi_infinity = price::infinite();
+     static const wide_uint<4> bi_infinity( price::infinite() );
 
      // if the quotient is infinity or bigger, then we have a finite
      //    result that is too big to represent (overflow)
@@ -54,7 +74,7 @@ namespace bts { namespace blockchain {
 
      // NB we throw away the low bits, thus this function always rounds down
 
-     price result( fc::uint128( product ), l.quote_asset_id, l.base_asset_id );
+     price result( product.to_uint128(), l.quote_asset_id, l.base_asset_id );
      return result;
   } FC_CAPTURE_AND_RETHROW( (l)(r) ) }
 
@@ -222,11 +242,14 @@ namespace bts { namespace blockchain {
         p.base_asset_id = r.asset_id;
         p.quote_asset_id = l.asset_id;
 
-        fc::bigint bl = l.amount;
-        fc::bigint br = r.amount;
-        fc::bigint result = (bl * fc::bigint(FC_REAL128_PRECISION)) / br;
+        // |l| * 10^18 < 2^123, so the quotient always fits in 128 bits; a negative
+        // quotient is truncated toward zero and stored modulo 2^128
+        wide_uint<2> result = wide_uint<2>( magnitude( l.amount ) ) * wide_uint<2>( real128_precision );
+        result.divide( magnitude( r.amount ) );
+        if( (l.amount < 0) != (r.amount < 0) )
+           result.negate();
 
-        p.ratio = result;
+        p.ratio = result.to_uint128();
         return p;
     } FC_RETHROW_EXCEPTIONS( warn, "${a} / ${b}", ("a",a)("b",b) );
   }
@@ -250,19 +273,15 @@ namespace bts { namespace blockchain {
     try {
         if( a.asset_id == p.base_asset_id )
         {
-            fc::bigint ba( a.amount ); // 64.64
-            fc::bigint r( p.ratio ); // 64.64
-
-            auto amnt = ba * r; //  128.128
-            amnt /= FC_REAL128_PRECISION; // 128.64
-            auto lg2 = amnt.log2();
-            if( lg2 >= 128 )
+            wide_uint<3> amnt = wide_uint<3>( magnitude( a.amount ) ) * wide_uint<3>( p.ratio ); // 64 * 128 bits
+            amnt.divide( real128_precision );
+            if( amnt.num_bits() >= 128 )
             {
                FC_THROW_EXCEPTION( addition_overflow, "overflow ${a} * ${p}", ("a",a)("p",p) );
             }
 
             asset rtn;
-            rtn.amount = amnt.to_int64();
+            rtn.amount = to_share( amnt, a.amount < 0 );
             rtn.asset_id = p.quote_asset_id;
 
             //ilog( "${a} * ${p} => ${rtn}", ("a", a)("p",p )("rtn",rtn) );
@@ -270,25 +289,24 @@ namespace bts { namespace blockchain {
         }
         else if( a.asset_id == p.quote_asset_id )
         {
-            fc::bigint amt( a.amount ); // 64.64
-            amt *= FC_REAL128_PRECISION; //<<= 64;  // 64.128
-            fc::bigint pri( p.ratio ); // 64.64
+            const wide_uint<2> amt = wide_uint<2>( magnitude( a.amount ) ) * wide_uint<2>( real128_precision );
 
-            auto result = amt / pri;  // 64.64
-//            ilog( "amt: ${amt} / ${pri}", ("amt",string(amt))("pri",string(pri) ) );
- //           ilog( "${r}", ("r",string(result) ) );
+            // a zero ratio yields a zero amount, as the failed BN_div in fc::bigint did
+            wide_uint<2> result;
+            if( p.ratio != fc::uint128() )
+               result = wide_uint<2>( divide_uint128( amt.to_uint128(), p.ratio ) );
 
-            auto lg2 = result.log2();
+            const auto lg2 = result.num_bits();
             if( lg2 >= 128 )
             {
              //  wlog( "." );
                FC_THROW_EXCEPTION( addition_overflow,
                                     "overflow ${a} / ${p} = ${r} lg2 = ${l}",
-                                    ("a",a)("p",p)("r", std::string(result)  )("l",lg2) );
+                                    ("a",a)("p",p)("r", std::string(result.to_uint128())  )("l",lg2) );
             }
           //  result += 5000000000; // TODO: evaluate this rounding factor..
             asset r;
-            r.amount    = result.to_int64();
+            r.amount    = to_share( result, a.amount < 0 );
             r.asset_id  = p.base_asset_id;
            // ilog( "r.amount = ${r}", ("r",r.amount) );
            // ilog( "${a} * ${p} => ${rtn}", ("a", a)("p",p )("rtn",r) );
@@ -19,17 +19,62 @@
 
 #include <bts/blockchain/fork_blocks.hpp>
 
+#include <boost/thread/locks.hpp>
+
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <thread>
 
 namespace bts { namespace blockchain {
 
    const static short MAX_RECENT_OPERATIONS = 20;
 
+   namespace
+   {
+      /**
+       *  Signature recovery and market matching threads, started on first use and shared by every
+       *  chain_database in the process so opening several databases does not multiply them.
+       */
+      const vector<std::unique_ptr<fc::thread>>& worker_threads()
+      {
+         static const vector<std::unique_ptr<fc::thread>> threads = []()
+         {
+            const unsigned num_worker_threads = std::max( 1u, std::thread::hardware_concurrency() );
+            vector<std::unique_ptr<fc::thread>> started;
+            started.reserve( num_worker_threads );
+            for( unsigned i = 0; i < num_worker_threads; ++i )
+                started.push_back( std::unique_ptr<fc::thread>( new fc::thread( "chain_worker_" + std::to_string( i ) ) ) );
+            return started;
+         }();
+         return threads;
+      }
+   }
+
    namespace detail
    {
+      boost::unique_lock<boost::shared_mutex> chain_database_impl::lock_snapshots()const
+      {
+            std::unique_lock<std::mutex> gate( _snapshot_gate, std::try_to_lock );
+            while( !gate.owns_lock() )
+            {
+                fc::usleep( fc::microseconds( 100 ) );
+                gate.try_lock();
+            }
+
+            boost::unique_lock<boost::shared_mutex> lock( _snapshot_mutex, boost::try_to_lock );
+            while( !lock.owns_lock() )
+            {
+                fc::usleep( fc::microseconds( 100 ) );
+                lock.try_lock();
+            }
+            return lock;
+      }
+
       void chain_database_impl::revalidate_pending()
       {
+            const auto snapshot_lock = lock_snapshots();
             _pending_fee_index.clear();
 
             vector<transaction_id_type> trx_to_discard;
@@ -162,6 +207,7 @@ namespace bts { namespace blockchain {
           _note_index_to_record.open( data_dir / "index/note_index_to_record" );
           
           _game_data_db.open( data_dir / "index/game_data_db" );
+          _game_data_db.set_max_cached( BTS_BLOCKCHAIN_GAME_DATA_CACHE_SIZE );
           _game_result_transactions_db.open( data_dir / "game_result_transactions_db" );
 
           _packet_id_to_record.open( data_dir / "index/packet_id_to_record");
@@ -171,6 +217,7 @@ namespace bts { namespace blockchain {
           _feed_index_to_record.open( data_dir / "index/feed_index_to_record" );
 
           _market_transactions_db.open( data_dir / "index/market_transactions_db" );
+          _market_candles_file = data_dir / "index/market_candles.dat";
 
           _pending_transaction_db.open( data_dir / "index/pending_transaction_db" );
 
@@ -221,6 +268,18 @@ namespace bts { namespace blockchain {
               const feed_index& index = iter.key();
               _nested_feed_map[ index.quote_id ][ index.delegate_id ] = iter.value();
           }
+          clear_feed_medians();
+
+          _order_books.clear();
+          _order_id_to_key.clear();
+          _owner_to_order_keys.clear();
+          for( auto iter = _bid_db.begin(); iter.valid(); ++iter )
+              store_order_book_entry( bid_order, iter.key(), iter.value() );
+          for( auto iter = _ask_db.begin(); iter.valid(); ++iter )
+              store_order_book_entry( ask_order, iter.key(), iter.value() );
+
+          if( !_market_candles.load( _market_candles_file, _head_block_id ) )
+              rebuild_market_candles();
 
       } FC_CAPTURE_AND_RETHROW() }
 
@@ -725,11 +784,17 @@ namespace bts { namespace blockchain {
       void chain_database_impl::apply_transactions( const full_block& block_data,
                                                     const pending_chain_state_ptr& pending_state )const
       { try {
+         vector<optional<vector<public_key_type>>> signing_keys;
+         if( self->_verify_transaction_signatures )
+             signing_keys = recover_signing_keys( block_data.user_transactions );
+
          uint32_t trx_num = 0;
          for( const auto& trx : block_data.user_transactions )
          {
             transaction_evaluation_state_ptr trx_eval_state = std::make_shared<transaction_evaluation_state>( pending_state );
             trx_eval_state->_skip_signature_check = !self->_verify_transaction_signatures;
+            if( trx_num < signing_keys.size() )
+                trx_eval_state->_signing_keys = signing_keys[ trx_num ];
             trx_eval_state->evaluate( trx );
 
             const transaction_id_type& trx_id = trx.id();
@@ -742,6 +807,77 @@ namespace bts { namespace blockchain {
          }
       } FC_CAPTURE_AND_RETHROW( (block_data) ) }
 
+      /**
+       *  Runs task( i ) for every i < count spread across the worker threads and returns once
+       *  all of them are done. The calling fiber blocks instead of yielding, so this is safe
+       *  within the non-preemptable block application path. If any task throws, the first
+       *  exception is rethrown after every task has finished.
+       */
+      void chain_database_impl::run_on_worker_threads( const size_t count, const std::function<void( size_t )>& task )const
+      {
+         const auto& threads = worker_threads();
+         const size_t num_threads = std::min( threads.size(), count );
+         if( num_threads < 2 )
+         {
+             for( size_t i = 0; i < count; ++i )
+                 task( i );
+             return;
+         }
+
+         vector<std::promise<void>> done( num_threads );
+         vector<std::future<void>> progress;
+         progress.reserve( num_threads );
+         for( size_t t = 0; t < num_threads; ++t )
+         {
+             progress.push_back( done[ t ].get_future() );
+             threads[ t ]->async( [ &, t ]()
+             {
+                 try
+                 {
+                     for( size_t i = t; i < count; i += num_threads )
+                         task( i );
+                     done[ t ].set_value();
+                 }
+                 catch( ... )
+                 {
+                     done[ t ].set_exception( std::current_exception() );
+                 }
+             }, "chain_worker_task" );
+         }
+
+         for( auto& fut : progress )
+             fut.wait();
+         for( auto& fut : progress )
+             fut.get();
+      }
+
+      /**
+       *  Recovers the signing keys of every transaction across the worker threads so
+       *  that apply_transactions() does not pay for each EC recovery serially. Transactions
+       *  whose signatures cannot be recovered are left unset and fail during evaluation.
+       */
+      vector<optional<vector<public_key_type>>> chain_database_impl::recover_signing_keys(
+              const signed_transactions& transactions )const
+      { try {
+         vector<optional<vector<public_key_type>>> signing_keys( transactions.size() );
+         if( transactions.size() < 2 )
+             return signing_keys;
+
+         const digest_type chain_id = self->get_chain_id();
+         run_on_worker_threads( transactions.size(), [ & ]( const size_t i )
+         {
+             try
+             {
+                 signing_keys[ i ] = transactions[ i ].get_signing_keys( chain_id, false );
+             }
+             catch( const fc::exception& )
+             {
+             }
+         } );
+
+         return signing_keys;
+      } FC_CAPTURE_AND_RETHROW() }
+
       void chain_database_impl::pay_delegate( const block_id_type& block_id,
                                               const public_key_type& block_signee,
                                               const pending_chain_state_ptr& pending_state,
@@ -966,26 +1102,95 @@ namespace bts { namespace blockchain {
       void chain_database_impl::execute_markets( const time_point_sec timestamp,
                                                  const pending_chain_state_ptr& pending_state )const
       { try {
-        vector<market_transaction> market_transactions;
-
         const auto dirty_markets = self->get_dirty_markets();
-        for( const auto& market_pair : dirty_markets )
-        {
+        const vector<pair<asset_id_type, asset_id_type>> markets( dirty_markets.begin(), dirty_markets.end() );
+        for( const auto& market_pair : markets )
            FC_ASSERT( market_pair.first > market_pair.second );
-           market_engine engine( pending_state, *this );
+
+        const auto execute_market = [&]( const pair<asset_id_type, asset_id_type>& market_pair,
+                                         const pending_chain_state_ptr& market_state ) -> vector<market_transaction>
+        {
+           market_engine engine( market_state, *this );
            if( engine.execute( market_pair.first, market_pair.second, timestamp ) )
-           {
-               market_transactions.insert( market_transactions.end(), engine._market_transactions.begin(),
-                                                                      engine._market_transactions.end() );
-           }
-        }
+              return std::move( engine._market_transactions );
+           return vector<market_transaction>();
+        };
 
-        pending_state->set_market_transactions( std::move( market_transactions ) );
+        pending_state->set_market_transactions( match_markets( markets, pending_state, execute_market ) );
         if( self->_debug_verify_market_matching )
         {
             debug_check_no_orders_overlap();
         }
       } FC_CAPTURE_AND_RETHROW( (timestamp) ) }
+
+      vector<market_transaction> chain_database_impl::match_markets( const vector<pair<asset_id_type, asset_id_type>>& markets,
+                                                                     const pending_chain_state_ptr& pending_state,
+                                                                     const chain_database::market_executor& execute_market )const
+      { try {
+        // Every market first runs on the worker threads in its own child of pending_state
+        vector<pending_chain_state_ptr> market_states( markets.size() );
+        vector<vector<market_transaction>> market_results( markets.size() );
+        run_on_worker_threads( markets.size(), [&]( const size_t i )
+        {
+           market_states[ i ] = std::make_shared<pending_chain_state>( pending_state );
+           market_results[ i ] = execute_market( markets[ i ], market_states[ i ] );
+        } );
+
+        // Markets only share asset records, whose collected fees are additive, and the balance
+        // records of owners trading in several markets. Merge in canonical order, and rerun any
+        // market that touched a balance an earlier market already changed so it sees that change.
+        unordered_map<asset_id_type, asset_record> original_assets;
+        unordered_set<balance_id_type> touched_balances;
+        for( size_t i = 0; i < markets.size(); ++i )
+        {
+           pending_chain_state_ptr& market_state = market_states[ i ];
+
+           bool independent = true;
+           for( const auto& item : market_state->_balance_id_to_record )
+              independent &= touched_balances.count( item.first ) == 0;
+
+           for( auto& item : market_state->_asset_id_to_record )
+           {
+              // pending_state still holds the record every market saw until the first merge that changes it
+              if( original_assets.count( item.first ) == 0 )
+              {
+                 const oasset_record original = pending_state->get_asset_record( item.first );
+                 FC_ASSERT( original.valid() );
+                 original_assets[ item.first ] = *original;
+              }
+
+              const asset_record& original = original_assets[ item.first ];
+              asset_record& updated = item.second;
+              const share_type fees_collected = updated.collected_fees - original.collected_fees;
+
+              // the rest of the record must match what earlier merges left, not just what the market saw
+              const oasset_record current = pending_state->get_asset_record( item.first );
+              FC_ASSERT( current.valid() );
+              updated.collected_fees = current->collected_fees;
+              independent &= fc::raw::pack( updated ) == fc::raw::pack( *current );
+              updated.collected_fees = current->collected_fees + fees_collected;
+           }
+
+           if( !independent )
+           {
+              market_state = std::make_shared<pending_chain_state>( pending_state );
+              market_results[ i ] = execute_market( markets[ i ], market_state );
+           }
+
+           for( const auto& item : market_state->_balance_id_to_record )
+              touched_balances.insert( item.first );
+
+           market_state->apply_changes();
+        }
+
+        vector<market_transaction> market_transactions;
+        for( auto& results : market_results )
+        {
+           market_transactions.insert( market_transactions.end(), std::make_move_iterator( results.begin() ),
+                                                                  std::make_move_iterator( results.end() ) );
+        }
+        return market_transactions;
+      } FC_CAPTURE_AND_RETHROW( (markets) ) }
        
       void chain_database_impl::pay_operation_rewards( const uint32_t block_num, const time_point_sec timestamp,
                                                                          const pending_chain_state_ptr& pending_state )const
@@ -1261,6 +1466,113 @@ namespace bts { namespace blockchain {
           return;
       }
 
+      feed_median& chain_database_impl::get_feed_median( const asset_id_type quote_id )const
+      { try {
+          if( _feed_median_delegates.empty() )
+          {
+              const vector<account_id_type> delegate_ids = self->get_active_delegates();
+              _feed_median_delegates.insert( delegate_ids.begin(), delegate_ids.end() );
+          }
+
+          const time_point_sec now = self->now();
+          auto iter = _feed_medians.find( quote_id );
+          if( iter != _feed_medians.end() )
+          {
+              // Popping blocks can bring expired feeds back, so only moving forward is incremental
+              if( iter->second.now() <= now )
+              {
+                  iter->second.advance( now );
+                  return iter->second;
+              }
+              _feed_medians.erase( iter );
+          }
+
+          iter = _feed_medians.emplace( quote_id, feed_median( quote_id, now ) ).first;
+          const auto outer_iter = _nested_feed_map.find( quote_id );
+          if( outer_iter != _nested_feed_map.end() )
+          {
+              for( const auto& item : outer_iter->second )
+              {
+                  if( _feed_median_delegates.count( item.first ) > 0 )
+                      iter->second.store( item.first, item.second );
+              }
+          }
+          return iter->second;
+      } FC_CAPTURE_AND_RETHROW( (quote_id) ) }
+
+      void chain_database_impl::store_feed_median_entry( const feed_index index, const ofeed_record& record )
+      {
+          std::lock_guard<std::mutex> lock( _feed_median_mutex );
+          const auto iter = _feed_medians.find( index.quote_id );
+          if( iter == _feed_medians.end() ) return;
+          if( _feed_median_delegates.count( index.delegate_id ) == 0 ) return;
+          iter->second.store( index.delegate_id, record );
+      }
+
+      void chain_database_impl::clear_feed_medians()
+      {
+          std::lock_guard<std::mutex> lock( _feed_median_mutex );
+          _feed_medians.clear();
+          _feed_median_delegates.clear();
+      }
+
+      void chain_database_impl::rebuild_market_candles()
+      { try {
+          _market_candles.clear();
+          const uint32_t head_block_num = _head_block_header.block_num;
+          for( auto iter = _market_transactions_db.begin(); iter.valid() && iter.key() <= head_block_num; ++iter )
+              _market_candles.apply_block( iter.key(), self->get_block_header( iter.key() ).timestamp, iter.value() );
+      } FC_CAPTURE_AND_RETHROW() }
+
+      const market_order_book* chain_database_impl::get_order_book( const asset_id_type quote_id, const asset_id_type base_id )const
+      {
+          const auto itr = _order_books.find( std::make_pair( quote_id, base_id ) );
+          if( itr == _order_books.end() ) return nullptr;
+          return &itr->second;
+      }
+
+      void chain_database_impl::store_order_book_entry( const order_type_enum type, const market_index_key& key,
+                                                        const order_record& order )
+      {
+          const auto market = key.order_price.asset_pair();
+          auto itr = _order_books.find( market );
+          if( itr == _order_books.end() )
+          {
+              if( order.is_null() ) return;
+              itr = _order_books.emplace( market, market_order_book( market.first, market.second ) ).first;
+          }
+
+          order_book_side& side = (type == bid_order) ? itr->second.bids : itr->second.asks;
+          const bool existed = side.find( key ).valid();
+          side.store( key, order );
+
+          if( itr->second.empty() )
+              _order_books.erase( itr );
+
+          // Keep the order id and owner indexes in step with the set of open orders
+          if( existed == !order.is_null() )
+              return;
+
+          const order_id_type order_id = market_order( type, key, order ).get_id();
+          const auto order_key = std::make_pair( type, key );
+          if( !existed )
+          {
+              _order_id_to_key[ order_id ] = order_key;
+              _owner_to_order_keys[ key.owner ].insert( order_key );
+          }
+          else
+          {
+              _order_id_to_key.erase( order_id );
+              const auto owner_itr = _owner_to_order_keys.find( key.owner );
+              if( owner_itr != _owner_to_order_keys.end() )
+              {
+                  owner_itr->second.erase( order_key );
+                  if( owner_itr->second.empty() )
+                      _owner_to_order_keys.erase( owner_itr );
+              }
+          }
+      }
+
       /**
        *  Performs all of the block validation steps and throws if error.
        */
@@ -1268,6 +1580,7 @@ namespace bts { namespace blockchain {
       { try {
          const time_point start_time = time_point::now();
          const block_id_type& block_id = block_data.id();
+         pending_chain_state_ptr pending_state;
          try
          {
             public_key_type block_signee;
@@ -1289,7 +1602,7 @@ namespace bts { namespace blockchain {
             verify_header( digest_block( block_data ), block_signee );
 
             // Create a pending state to track changes that would apply as we evaluate the block
-            pending_chain_state_ptr pending_state = std::make_shared<pending_chain_state>( self->shared_from_this() );
+            pending_state = std::make_shared<pending_chain_state>( self->shared_from_this() );
 
             /** Increment the blocks produced or missed for all delegates. This must be done
              *  before applying transactions because it depends upon the current active delegate order.
@@ -1330,6 +1643,8 @@ namespace bts { namespace blockchain {
 
             update_head_block( block_data, block_id );
 
+            _market_candles.apply_block( block_data.block_num, block_data.timestamp, pending_state->market_transactions );
+
             clear_pending( block_data );
 
             _block_num_to_id_db.store( block_data.block_num, block_id );
@@ -1361,6 +1676,11 @@ namespace bts { namespace blockchain {
                  fc::async( [ = ] { o->block_pushed( block_data ); }, "call_block_pushed_observer" );
              }
          }
+
+         for( chain_observer* o : _observers )
+         {
+             fc::async( [ = ] { o->state_changed( pending_state ); }, "call_state_changed_observer" );
+         }
       } FC_CAPTURE_AND_RETHROW( (block_data) ) }
 
       /**
@@ -1415,6 +1735,10 @@ namespace bts { namespace blockchain {
          // update the block_num_to_block_id index
          _block_num_to_id_db.remove( _head_block_header.block_num );
 
+         // market transactions are not part of the undo state
+         _market_transactions_db.remove( _head_block_header.block_num );
+         _market_candles.pop_block( _head_block_header.block_num );
+
          auto previous_block_id = _head_block_header.previous;
 
          const auto undo_iter = _block_id_to_undo_state.unordered_find( _head_block_id );
@@ -1437,6 +1761,7 @@ namespace bts { namespace blockchain {
          for( chain_observer* o : _observers )
          {
              fc::async( [ = ] { o->block_popped( undo_state_ptr ); }, "call_block_popped_observer" );
+             fc::async( [ = ] { o->state_changed( undo_state_ptr ); }, "call_state_changed_observer" );
          }
       } FC_CAPTURE_AND_RETHROW() }
 
@@ -1727,6 +2052,20 @@ namespace bts { namespace blockchain {
 
    void chain_database::close()
    { try {
+      const auto snapshot_lock = my->lock_snapshots();
+      if( !my->_market_candles_file.empty() )
+      {
+          try
+          {
+              my->_market_candles.save( my->_market_candles_file, my->_head_block_id );
+          }
+          catch( const fc::exception& e )
+          {
+              wlog( "failed to save market candles: ${e}", ("e",e.to_detail_string()) );
+          }
+      }
+      my->_market_candles.clear();
+
       my->_pending_transaction_db.close();
 
       my->_block_id_to_full_block.close();
@@ -1764,9 +2103,13 @@ namespace bts { namespace blockchain {
        my->_operation_reward_id_to_record.close();
 
       my->_feed_index_to_record.close();
+      my->clear_feed_medians();
 
       my->_ask_db.close();
       my->_bid_db.close();
+      my->_order_books.clear();
+      my->_order_id_to_key.clear();
+      my->_owner_to_order_keys.clear();
 
       my->_market_history_db.close();
       my->_market_status_db.close();
@@ -2022,6 +2365,7 @@ namespace bts { namespace blockchain {
       // only allow a single fiber attempt to push blocks at any given time,
       // this method is not re-entrant.
       fc::unique_lock<fc::mutex> lock( my->_push_block_mutex );
+      const auto snapshot_lock = my->lock_snapshots();
 
       // The above check probably isn't enough.  We need to make certain that
       // no other code sees the chain_database in an inconsistent state.
@@ -2127,6 +2471,21 @@ namespace bts { namespace blockchain {
        return my->_game_data_db.fetch_optional( index );
    }
 
+   map<data_id_type, game_data_record> chain_database::scan_game_data_records( const game_id_type& game_id, const data_id_type& first,
+                                                                              const data_id_type& last, uint32_t limit )const
+   { try {
+       map<data_id_type, game_data_record> records;
+       if( limit == 0 || last < first ) return records;
+
+       my->_game_data_db.scan( game_data_index{ game_id, first }, game_data_index{ game_id, last },
+                               [&]( const game_data_index& index, const game_data_record& record ) -> bool
+       {
+           records.emplace_hint( records.end(), index.data_id, record );
+           return records.size() < limit;
+       } );
+       return records;
+   } FC_CAPTURE_AND_RETHROW( (game_id)(first)(last)(limit) ) }
+
    void chain_database::store_game_data_record( const game_id_type& game_id, const data_id_type& data_id, const game_data_record& r )
    {
        game_data_index index;
@@ -2265,6 +2624,7 @@ namespace bts { namespace blockchain {
       if (override_limits)
         ilog("storing new local transaction with id ${id}", ("id", trx_id));
 
+      const auto snapshot_lock = my->lock_snapshots();
       auto current_itr = my->_pending_transaction_db.find( trx_id );
       if( current_itr.valid() )
         return nullptr;
@@ -2721,13 +3081,12 @@ namespace bts { namespace blockchain {
    omarket_order chain_database::get_lowest_ask_record( const asset_id_type quote_id, const asset_id_type base_id )
    {
       omarket_order result;
-      auto itr = my->_ask_db.lower_bound( market_index_key( price( 0, quote_id, base_id ) ) );
-      if( itr.valid() )
+      const market_order_book* book = my->get_order_book( quote_id, base_id );
+      if( book != nullptr )
       {
-         auto market_index = itr.key();
-         if( market_index.order_price.quote_asset_id == quote_id &&
-             market_index.order_price.base_asset_id == base_id      )
-            return market_order( ask_order, market_index, itr.value() );
+         const auto itr = book->asks.begin();
+         if( itr.valid() )
+            return market_order( ask_order, itr.key(), itr.value() );
       }
       return result;
    }
@@ -2743,6 +3102,7 @@ namespace bts { namespace blockchain {
          my->_bid_db.remove( key );
       else
          my->_bid_db.store( key, order );
+      my->store_order_book_entry( bid_order, key, order );
    }
 
    void chain_database::store_ask_record( const market_index_key& key, const order_record& order )
@@ -2751,6 +3111,7 @@ namespace bts { namespace blockchain {
          my->_ask_db.remove( key );
       else
          my->_ask_db.store( key, order );
+      my->store_order_book_entry( ask_order, key, order );
    }
 
    bool chain_database::is_valid_asset_symbol( const string& symbol )const
@@ -2803,10 +3164,12 @@ namespace bts { namespace blockchain {
 
    optional<market_order> chain_database::get_market_bid( const market_index_key& key )const
    { try {
-       { // absolute bids
-          auto market_itr  = my->_bid_db.find(key);
-          if( market_itr.valid() )
-             return market_order { bid_order, market_itr.key(), market_itr.value() };
+       const market_order_book* book = my->get_order_book( key.order_price.quote_asset_id, key.order_price.base_asset_id );
+       if( book != nullptr )
+       {
+          const oorder_record order = book->bids.find( key );
+          if( order.valid() )
+             return market_order { bid_order, key, *order };
        }
        return optional<market_order>();
    } FC_CAPTURE_AND_RETHROW( (key) ) }
@@ -2819,40 +3182,28 @@ namespace bts { namespace blockchain {
           FC_CAPTURE_AND_THROW( invalid_market, (quote_id)(base_id) );
 
        vector<market_order> results;
+       const market_order_book* book = my->get_order_book( quote_id, base_id );
+       if( book == nullptr )
+          return results;
 
-       //We dance around like this because the _bid_db sorts the bids backwards, so we must iterate it backwards.
-       { // absolute bids
-          const price next_pair = (base_id+1 == quote_id) ? price( 0, quote_id+1, 0 ) : price( 0, quote_id, base_id+1 );
-          auto market_itr = my->_bid_db.lower_bound( market_index_key( next_pair ) );
-          if( market_itr.valid() )   --market_itr;
-          else market_itr = my->_bid_db.last();
-
-          while( market_itr.valid() )
-          {
-             auto key = market_itr.key();
-             if( key.order_price.quote_asset_id == quote_id &&
-                 key.order_price.base_asset_id == base_id  )
-             {
-                results.push_back( {bid_order, key, market_itr.value()} );
-             }
-             else break;
-
-
-             if( results.size() >= limit )
-                return results;
-
-             --market_itr;
-          }
+       results.reserve( std::min<size_t>( limit, book->bids.size() ) );
+       for( auto itr = book->bids.begin(); itr.valid(); ++itr )
+       {
+          results.push_back( {bid_order, itr.key(), itr.value()} );
+          if( results.size() >= limit )
+             break;
        }
        return results;
    } FC_CAPTURE_AND_RETHROW( (quote_symbol)(base_symbol)(limit) ) }
 
    optional<market_order> chain_database::get_market_ask( const market_index_key& key )const
    { try {
-       { // abs asks
-          auto market_itr  = my->_ask_db.find(key);
-          if( market_itr.valid() )
-             return market_order { ask_order, market_itr.key(), market_itr.value() };
+       const market_order_book* book = my->get_order_book( key.order_price.quote_asset_id, key.order_price.base_asset_id );
+       if( book != nullptr )
+       {
+          const oorder_record order = book->asks.find( key );
+          if( order.valid() )
+             return market_order { ask_order, key, *order };
        }
        return optional<market_order>();
    } FC_CAPTURE_AND_RETHROW( (key) ) }
@@ -2865,26 +3216,16 @@ namespace bts { namespace blockchain {
           FC_CAPTURE_AND_THROW( invalid_market, (quote_asset_id)(base_asset_id) );
 
        vector<market_order> results;
-       { // absolute asks
-          auto market_itr  = my->_ask_db.lower_bound( market_index_key( price( 0, quote_asset_id, base_asset_id ) ) );
-          while( market_itr.valid() )
-          {
-             auto key = market_itr.key();
-             if( key.order_price.quote_asset_id == quote_asset_id &&
-                 key.order_price.base_asset_id == base_asset_id  )
-             {
-                results.push_back( {ask_order, key, market_itr.value()} );
-             }
-             else
-             {
-                break;
-             }
+       const market_order_book* book = my->get_order_book( quote_asset_id, base_asset_id );
+       if( book == nullptr )
+          return results;
 
-             if( results.size() >= limit )
-                return results;
-
-             ++market_itr;
-          }
+       results.reserve( std::min<size_t>( limit, book->asks.size() ) );
+       for( auto itr = book->asks.begin(); itr.valid(); ++itr )
+       {
+          results.push_back( {ask_order, itr.key(), itr.value()} );
+          if( results.size() >= limit )
+             break;
        }
        return results;
    } FC_CAPTURE_AND_RETHROW( (quote_symbol)(base_symbol)(limit) ) }
@@ -2928,17 +3269,34 @@ namespace bts { namespace blockchain {
 
    optional<market_order> chain_database::get_market_order( const order_id_type& order_id, order_type_enum type )const
    { try {
-       const auto filter = [&]( const market_order& order ) -> bool
-       {
-           return order.get_id() == order_id;
-       };
+       const auto itr = my->_order_id_to_key.find( order_id );
+       if( itr == my->_order_id_to_key.end() )
+           return optional<market_order>();
 
-       const auto orders = scan_market_orders( filter, 1, type );
-       if( !orders.empty() )
-           return orders.front();
+       const order_type_enum order_type = itr->second.first;
+       if( type != null_order && type != order_type )
+           return optional<market_order>();
 
-       return optional<market_order>();
-   } FC_CAPTURE_AND_RETHROW() }
+       return order_type == bid_order ? get_market_bid( itr->second.second ) : get_market_ask( itr->second.second );
+   } FC_CAPTURE_AND_RETHROW( (order_id)(type) ) }
+
+   vector<market_order> chain_database::get_market_orders_by_owner( const address& owner )const
+   { try {
+       vector<market_order> orders;
+       const auto itr = my->_owner_to_order_keys.find( owner );
+       if( itr == my->_owner_to_order_keys.end() )
+           return orders;
+
+       orders.reserve( itr->second.size() );
+       for( const auto& order_key : itr->second )
+       {
+           const optional<market_order> order = order_key.first == bid_order ? get_market_bid( order_key.second )
+                                                                              : get_market_ask( order_key.second );
+           FC_ASSERT( order.valid() );
+           orders.push_back( *order );
+       }
+       return orders;
+   } FC_CAPTURE_AND_RETHROW( (owner) ) }
 
    pending_chain_state_ptr chain_database::get_pending_state()const
    {
@@ -3025,6 +3383,26 @@ namespace bts { namespace blockchain {
                                                                    market_history_key::time_granularity_enum granularity )const
    {
       time_point_sec end_time = start_time + duration;
+
+      if( granularity != market_history_key::each_block )
+      {
+         const candle_interval_enum interval = granularity == market_history_key::each_hour ? one_hour : one_day;
+         market_history_points history;
+         for( const market_candle& candle : my->_market_candles.get_candles( quote_id, base_id, interval, start_time,
+                                                                             end_time, std::numeric_limits<uint32_t>::max() ) )
+         {
+            history.push_back( {
+                                 candle.open_time,
+                                 to_pretty_price( candle.high_price, false ),
+                                 to_pretty_price( candle.low_price, false ),
+                                 to_pretty_price( candle.open_price, false ),
+                                 to_pretty_price( candle.close_price, false ),
+                                 candle.volume
+                               } );
+         }
+         return history;
+      }
+
       auto record_itr = my->_market_history_db.lower_bound( market_history_key(quote_id, base_id, granularity, start_time) );
       market_history_points history;
       auto base = get_asset_record(base_id);
@@ -3052,11 +3430,45 @@ namespace bts { namespace blockchain {
       return history;
    }
 
+   vector<market_candle> chain_database::get_market_candles( const asset_id_type quote_id,
+                                                             const asset_id_type base_id,
+                                                             const candle_interval_enum interval,
+                                                             const time_point_sec start_time,
+                                                             const time_point_sec end_time,
+                                                             const uint32_t limit )const
+   { try {
+      return my->_market_candles.get_candles( quote_id, base_id, interval, start_time, end_time, limit );
+   } FC_CAPTURE_AND_RETHROW( (quote_id)(base_id)(interval)(start_time)(end_time)(limit) ) }
+
    bool chain_database::is_known_transaction( const transaction& trx )const
    { try {
        return my->_unique_transactions.count( unique_transaction_key( trx, get_chain_id() ) ) > 0;
    } FC_CAPTURE_AND_RETHROW( (trx) ) }
 
+   chain_snapshot_ptr chain_database::acquire_snapshot()const
+   {
+      std::unique_ptr<chain_snapshot> snapshot( new chain_snapshot );
+      const auto release = [this]( const chain_snapshot* snapshot )
+      {
+         delete snapshot;
+         my->_snapshot_mutex.unlock_shared();
+      };
+
+      {
+          // a writer waiting for the snapshots before this one holds the gate
+          std::lock_guard<std::mutex> gate( my->_snapshot_gate );
+          my->_snapshot_mutex.lock_shared();
+      }
+      snapshot->block_num = my->_head_block_header.block_num;
+      snapshot->block_id = my->_head_block_id;
+      return chain_snapshot_ptr( snapshot.release(), release );
+   }
+
+   void chain_database::run_on_worker_threads( const size_t count, const std::function<void( size_t )>& task )const
+   {
+      my->run_on_worker_threads( count, task );
+   }
+
    void chain_database::set_relay_fee( share_type shares )
    {
       my->_relay_fee = shares;
@@ -3433,42 +3845,11 @@ namespace bts { namespace blockchain {
 
    oprice chain_database::get_active_feed_price( const asset_id_type quote_id )const
    { try {
-       const auto outer_iter = my->_nested_feed_map.find( quote_id );
-       if( outer_iter == my->_nested_feed_map.end() )
+       if( my->_nested_feed_map.count( quote_id ) == 0 )
            return oprice();
 
-       // TODO: Caller passes in delegate list
-       const vector<account_id_type>& delegate_ids = get_active_delegates();
-
-       vector<price> prices;
-       prices.reserve( delegate_ids.size() );
-
-       const time_point_sec now = this->now();
-       static const auto limit = fc::days( 1 );
-
-       const unordered_map<account_id_type, feed_record>& delegate_feeds = outer_iter->second;
-       for( const account_id_type delegate_id : delegate_ids )
-       {
-           const auto iter = delegate_feeds.find( delegate_id );
-           if( iter == delegate_feeds.end() ) continue;
-
-           const feed_record& record = iter->second;
-           if( time_point( now ) - time_point( record.last_update ) >= limit ) continue;
-
-           if( record.value.quote_asset_id != quote_id ) continue;
-           if( record.value.base_asset_id != 0 ) continue;
-
-           prices.push_back( record.value );
-       }
-
-       if( prices.size() >= BTS_BLOCKCHAIN_MIN_FEEDS )
-       {
-           const auto midpoint = prices.size() / 2;
-           std::nth_element( prices.begin(), prices.begin() + midpoint, prices.end() );
-           return prices.at( midpoint );
-       }
-
-       return oprice();
+       std::lock_guard<std::mutex> lock( my->_feed_median_mutex );
+       return my->get_feed_median( quote_id ).median();
    } FC_CAPTURE_AND_RETHROW( (quote_id) ) }
 
    vector<feed_record> chain_database::get_feeds_for_asset( const asset_id_type quote_id, const asset_id_type base_id )const
@@ -3592,14 +3973,11 @@ namespace bts { namespace blockchain {
         const auto opt_game_record = get_game_record( game_name );
         FC_ASSERT( opt_game_record.valid() );
         
-        auto itr = my->_game_data_db.lower_bound( {opt_game_record->id} );
-        while( itr.valid() && itr.key().game_id == opt_game_record->id )
-        {
-            results.push_back( itr.value() );
-            ++itr;
-            
-            if( results.size() >= limit ) break;
-        }
+        const auto records = scan_game_data_records( opt_game_record->id, std::numeric_limits<int32_t>::min(),
+                                                     std::numeric_limits<int32_t>::max(), limit );
+        results.reserve( records.size() );
+        for( const auto& item : records )
+            results.push_back( item.second );
         
         return results;
     } FC_CAPTURE_AND_RETHROW( (game_name) ) }
@@ -3632,11 +4010,15 @@ namespace bts { namespace blockchain {
    void chain_database::property_insert_into_id_map( const property_id_type id, const property_record& record )
    {
        my->_property_id_to_record.store( static_cast<uint8_t>( id ), record );
+       if( id == property_id_type::active_delegate_list_id )
+           my->clear_feed_medians();
    }
 
    void chain_database::property_erase_from_id_map( const property_id_type id )
    {
        my->_property_id_to_record.remove( static_cast<uint8_t>( id ) );
+       if( id == property_id_type::active_delegate_list_id )
+           my->clear_feed_medians();
    }
 
    oaccount_record chain_database::account_lookup_by_id( const account_id_type id )const
@@ -3979,6 +4361,7 @@ namespace bts { namespace blockchain {
    {
        my->_feed_index_to_record.store( index, record );
        my->_nested_feed_map[ index.quote_id ][ index.delegate_id ] = record;
+       my->store_feed_median_entry( index, record );
 
        //reindex_shorts_at_feed( index.quote_id );
    }
@@ -3993,6 +4376,7 @@ namespace bts { namespace blockchain {
            if( inner_iter != outer_iter->second.end() )
                outer_iter->second.erase( index.delegate_id );
        }
+       my->store_feed_median_entry( index, ofeed_record() );
 
        //reindex_shorts_at_feed( index.quote_id );
    }
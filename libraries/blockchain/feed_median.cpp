@@ -0,0 +1,125 @@
+#include <bts/blockchain/config.hpp>
+#include <bts/blockchain/feed_median.hpp>
+
+#include <iterator>
+
+namespace bts { namespace blockchain {
+
+   feed_median::feed_median( const asset_id_type quote_id, const time_point_sec now )
+   :_quote_id( quote_id ),_now( now )
+   {
+   }
+
+   void feed_median::store( const account_id_type delegate_id, const ofeed_record& record )
+   {
+      const auto feed_itr = _feeds.find( delegate_id );
+      if( feed_itr != _feeds.end() )
+      {
+         erase( feed_itr->second.ratio );
+         const auto range = _expirations.equal_range( feed_itr->second.expiration );
+         for( auto itr = range.first; itr != range.second; ++itr )
+         {
+            if( itr->second != delegate_id ) continue;
+            _expirations.erase( itr );
+            break;
+         }
+         _feeds.erase( feed_itr );
+      }
+
+      if( !record.valid() ) return;
+      if( record->value.quote_asset_id != _quote_id ) return;
+      if( record->value.base_asset_id != 0 ) return;
+
+      const fc::time_point expiration = fc::time_point( record->last_update ) + fc::days( 1 );
+      if( fc::time_point( _now ) >= expiration ) return;
+
+      insert( record->value.ratio );
+      _feeds[ delegate_id ] = tracked_feed{ record->value.ratio, expiration };
+      _expirations.emplace( expiration, delegate_id );
+   }
+
+   void feed_median::advance( const time_point_sec now )
+   {
+      FC_ASSERT( now >= _now, "feed medians cannot move back in time" );
+      _now = now;
+
+      while( !_expirations.empty() && _expirations.begin()->first <= fc::time_point( _now ) )
+      {
+         const auto feed_itr = _feeds.find( _expirations.begin()->second );
+         FC_ASSERT( feed_itr != _feeds.end() );
+         erase( feed_itr->second.ratio );
+         _feeds.erase( feed_itr );
+         _expirations.erase( _expirations.begin() );
+      }
+   }
+
+   oprice feed_median::median()const
+   {
+      if( _ratios.size() < BTS_BLOCKCHAIN_MIN_FEEDS )
+         return oprice();
+      return price( *_median, _quote_id, asset_id_type( 0 ) );
+   }
+
+   void feed_median::insert( const fc::uint128& ratio )
+   {
+      // Equal ratios are inserted after the ones already present, so after the median
+      const auto itr = _ratios.insert( ratio );
+      if( _ratios.size() == 1 )
+      {
+         _median = itr;
+         _median_pos = 0;
+         return;
+      }
+
+      if( ratio < *_median )
+         ++_median_pos;
+      seek_median();
+   }
+
+   void feed_median::erase( const fc::uint128& ratio )
+   {
+      const auto itr = *_median == ratio ? _median : ratio_index::const_iterator( _ratios.find( ratio ) );
+      FC_ASSERT( itr != _ratios.end() );
+
+      if( itr == _median )
+      {
+         if( std::next( _median ) != _ratios.end() )
+         {
+            ++_median;
+         }
+         else if( _median != _ratios.begin() )
+         {
+            --_median;
+            --_median_pos;
+         }
+      }
+      else if( ratio < *_median )
+      {
+         --_median_pos;
+      }
+
+      _ratios.erase( itr );
+      if( _ratios.empty() )
+      {
+         _median_pos = 0;
+         return;
+      }
+      seek_median();
+   }
+
+   void feed_median::seek_median()
+   {
+      const size_t target = _ratios.size() / 2;
+      while( _median_pos < target )
+      {
+         ++_median;
+         ++_median_pos;
+      }
+      while( _median_pos > target )
+      {
+         --_median;
+         --_median_pos;
+      }
+   }
+
+} } // bts::blockchain
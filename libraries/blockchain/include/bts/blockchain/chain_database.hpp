@@ -2,8 +2,11 @@
 
 #include <bts/blockchain/chain_interface.hpp>
 #include <bts/blockchain/delegate_config.hpp>
+#include <bts/blockchain/market_candles.hpp>
 #include <bts/blockchain/pending_chain_state.hpp>
 
+#include <functional>
+
 namespace bts { namespace blockchain {
 
    namespace detail { class chain_database_impl; }
@@ -64,12 +67,32 @@ namespace bts { namespace blockchain {
    };
    typedef fc::optional<fork_record> ofork_record;
 
+   /**
+    *  Pins the chain at the head block it was taken at so threads other than the one that
+    *  owns the database can read it consistently. Pushing blocks and changing pending
+    *  transactions wait until every snapshot alive when they start is released, and no
+    *  snapshot is taken while one of them waits, so hold a snapshot for one read only.
+    *  The database's thread runs its other fibers while such a change waits.
+    */
+   struct chain_snapshot
+   {
+      uint32_t          block_num = 0;
+      block_id_type     block_id;
+   };
+   typedef std::shared_ptr<const chain_snapshot> chain_snapshot_ptr;
+
    class chain_observer
    {
       public:
          virtual ~chain_observer() {}
          virtual void block_pushed( const full_block& ) = 0;
          virtual void block_popped( const pending_chain_state_ptr& ) = 0;
+
+         /**
+          * Called for every pushed or popped block, including during sync and replay,
+          * with the records that block changed (the undo state when popping).
+          */
+         virtual void state_changed( const pending_chain_state_ptr& ) {}
    };
     
     class game_interface;
@@ -87,6 +110,16 @@ namespace bts { namespace blockchain {
          void add_observer( chain_observer* observer );
          void remove_observer( chain_observer* observer );
 
+         /** Blocks the calling thread while a block is being pushed; never call it from the database's thread */
+         chain_snapshot_ptr acquire_snapshot()const;
+
+         /**
+          * Runs task( i ) for every i < count on the chain's worker threads, each in a fiber of its own,
+          * and returns once all are done. The caller blocks rather than yields; the first exception
+          * a task threw is rethrown.
+          */
+         void run_on_worker_threads( const size_t count, const std::function<void( size_t )>& task )const;
+
          void set_relay_fee( share_type shares );
          share_type get_relay_fee();
 
@@ -226,6 +259,7 @@ namespace bts { namespace blockchain {
                                                              uint32_t limit = uint32_t(-1) )const;
 
          optional<market_order>             get_market_order( const order_id_type& order_id, order_type_enum type = null_order )const;
+         vector<market_order>               get_market_orders_by_owner( const address& owner )const;
 
          vector<market_order>               scan_market_orders( std::function<bool( const market_order& )> filter,
                                                                 uint32_t limit = -1, order_type_enum type = null_order )const;
@@ -239,6 +273,8 @@ namespace bts { namespace blockchain {
          void                               scan_transactions( const function<void( const transaction_record& )> callback )const;
 
          virtual ogame_data_record          get_game_data_record( const game_id_type& game_id, const data_id_type& data_id )const override;
+         virtual map<data_id_type, game_data_record> scan_game_data_records( const game_id_type& game_id, const data_id_type& first,
+                                                                             const data_id_type& last, uint32_t limit )const override;
        
          virtual void                       store_game_data_record(const game_id_type& game_id, const data_id_type& data_id, const game_data_record& r )override;
 
@@ -271,6 +307,12 @@ namespace bts { namespace blockchain {
                                                                       const fc::time_point start_time,
                                                                       const fc::microseconds duration,
                                                                       market_history_key::time_granularity_enum granularity )const;
+         vector<market_candle>              get_market_candles( const asset_id_type quote_id,
+                                                                const asset_id_type base_id,
+                                                                const candle_interval_enum interval,
+                                                                const time_point_sec start_time,
+                                                                const time_point_sec end_time,
+                                                                const uint32_t limit )const;
 
          virtual void                       set_market_transactions( vector<market_transaction> trxs )override;
          vector<market_transaction>         get_market_transactions( uint32_t block_num  )const;
@@ -306,11 +348,16 @@ namespace bts { namespace blockchain {
          
          vector<string> debug_get_matching_errors() const;
 
+         typedef std::function<vector<market_transaction>( const pair<asset_id_type, asset_id_type>&,
+                                                           const pending_chain_state_ptr& )> market_executor;
+
          // Applies only when pushing new blocks; gets enabled in delegate loop
          bool                               _verify_transaction_signatures = false;
          bool _debug_verify_market_matching = false;
 
       private:
+         friend class chain_database_test_access;
+
          unique_ptr<detail::chain_database_impl> my;
 
          virtual oproperty_record property_lookup_by_id( const property_id_type )const override;
@@ -1,9 +1,17 @@
 #pragma once
 
 #include <bts/blockchain/chain_database.hpp>
+#include <bts/blockchain/feed_median.hpp>
+#include <bts/blockchain/order_book.hpp>
 #include <bts/db/cached_level_map.hpp>
 #include <bts/db/fast_level_map.hpp>
+#include <bts/db/paged_level_map.hpp>
 #include <fc/thread/mutex.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/thread/shared_mutex.hpp>
+
+#include <mutex>
 
 namespace bts { namespace blockchain {
 
@@ -75,6 +83,10 @@ namespace bts { namespace blockchain {
 
             void                                        execute_markets( const time_point_sec timestamp,
                                                                          const pending_chain_state_ptr& pending_state )const;
+
+            vector<market_transaction>                  match_markets( const vector<pair<asset_id_type, asset_id_type>>& markets,
+                                                                       const pending_chain_state_ptr& pending_state,
+                                                                       const chain_database::market_executor& execute_market )const;
           
             void                                        pay_operation_rewards( const uint32_t block_num, const time_point_sec timestamp,
                                                                       const pending_chain_state_ptr& pending_state )const;
@@ -82,6 +94,11 @@ namespace bts { namespace blockchain {
             void                                        apply_transactions( const full_block& block_data,
                                                                             const pending_chain_state_ptr& pending_state )const;
 
+            void                                        run_on_worker_threads( const size_t count,
+                                                                               const std::function<void( size_t )>& task )const;
+
+            vector<optional<vector<public_key_type>>>   recover_signing_keys( const signed_transactions& transactions )const;
+
             void                                        update_active_delegate_list( const uint32_t block_num,
                                                                                      const pending_chain_state_ptr& pending_state )const;
 
@@ -98,6 +115,24 @@ namespace bts { namespace blockchain {
 
             void debug_check_no_orders_overlap() const;
 
+            void                                        rebuild_market_candles();
+
+            /**
+             * Takes _snapshot_mutex exclusively for a change to the chain or pending state. Live snapshots
+             * are waited out without blocking the database's thread, so its other tasks keep running.
+             */
+            boost::unique_lock<boost::shared_mutex>     lock_snapshots()const;
+
+            const market_order_book*                    get_order_book( const asset_id_type quote_id, const asset_id_type base_id )const;
+            void                                        store_order_book_entry( const order_type_enum type,
+                                                                                const market_index_key& key,
+                                                                                const order_record& order );
+
+            /** Caller must hold _feed_median_mutex */
+            feed_median&                                get_feed_median( const asset_id_type quote_id )const;
+            void                                        store_feed_median_entry( const feed_index index, const ofeed_record& record );
+            void                                        clear_feed_medians();
+
             chain_database*                                                             self = nullptr;
             unordered_set<chain_observer*>                                              _observers;
           
@@ -114,6 +149,10 @@ namespace bts { namespace blockchain {
             uint32_t /* Only used to skip undo states when possible during replay */    _min_undo_block = 0;
 
             fc::mutex                                                                   _push_block_mutex;
+            /* Shared by live snapshots; held exclusively by anything that changes the chain or pending state */
+            mutable boost::shared_mutex                                                 _snapshot_mutex;
+            /* Held by a writer waiting for snapshots to be released, so new ones cannot keep it waiting */
+            mutable std::mutex                                                          _snapshot_gate;
 
             bts::db::level_map<block_id_type, full_block>                               _block_id_to_full_block;
             bts::db::fast_level_map<block_id_type, pending_chain_state>                 _block_id_to_undo_state;
@@ -160,18 +199,27 @@ namespace bts { namespace blockchain {
 
             bts::db::cached_level_map<feed_index, feed_record>                          _feed_index_to_record;
             unordered_map<asset_id_type, unordered_map<account_id_type, feed_record>>   _nested_feed_map;
+            /* Built lazily from _nested_feed_map; the market engine reads them from worker threads */
+            mutable std::mutex                                                          _feed_median_mutex;
+            mutable unordered_map<asset_id_type, feed_median>                           _feed_medians;
+            mutable unordered_set<account_id_type>                                      _feed_median_delegates;
 
             bts::db::cached_level_map<market_index_key, order_record>                   _ask_db;
             bts::db::cached_level_map<market_index_key, order_record>                   _bid_db;
+            map<pair<asset_id_type,asset_id_type>, market_order_book>                   _order_books; // Mirrors _bid_db and _ask_db
+            unordered_map<order_id_type, pair<order_type_enum, market_index_key>>       _order_id_to_key;
+            unordered_map<address, set<pair<order_type_enum, market_index_key>>>        _owner_to_order_keys;
 
             bts::db::cached_level_map<uint32_t, vector<market_transaction>>             _market_transactions_db;
+            market_candle_store                                                         _market_candles;
+            fc::path                                                                    _market_candles_file;
             bts::db::cached_level_map<pair<asset_id_type,asset_id_type>, market_status> _market_status_db;
             bts::db::cached_level_map<market_history_key, market_history_record>        _market_history_db;
 
             bts::db::level_map<slot_index, slot_record>                                 _slot_index_to_record;
             bts::db::level_map<time_point_sec, account_id_type>                         _slot_timestamp_to_delegate;
 
-            bts::db::cached_level_map<game_data_index, game_data_record >               _game_data_db;
+            bts::db::paged_level_map<game_data_index, game_data_record >                _game_data_db;
             bts::db::cached_level_map<uint32_t, std::vector<game_result_transaction> >  _game_result_transactions_db;
             bts::db::cached_level_map<game_id_type, game_status>                        _game_status_db;
           
@@ -97,6 +97,10 @@ namespace bts { namespace blockchain {
 
          virtual ogame_data_record          get_game_data_record( const game_id_type& game_id, const data_id_type& data_id )const    = 0;
 
+         /** The records of a game with first <= data_id <= last, at most limit of them from first on */
+         virtual map<data_id_type, game_data_record> scan_game_data_records( const game_id_type& game_id, const data_id_type& first,
+                                                                             const data_id_type& last, uint32_t limit )const = 0;
+
          virtual omarket_order              get_lowest_ask_record( const asset_id_type quote_id,
                                                                    const asset_id_type base_id )           = 0;
          virtual oorder_record              get_bid_record( const market_index_key& )const                  = 0;
@@ -91,3 +91,9 @@
 #define BTS_BLOCKCHAIN_DEFAULT_RELAY_FEE                    10000 // XTS
 #define BTS_BLOCKCHAIN_MAX_TRX_PER_SECOND                   1  // (10)
 #define BTS_BLOCKCHAIN_MAX_PENDING_QUEUE_SIZE               10 // (BTS_BLOCKCHAIN_MAX_TRX_PER_SECOND * BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC)
+
+// Not consensus critical; only bounds memory used for signature verification
+#define BTS_BLOCKCHAIN_KEY_ADDRESS_CACHE_SIZE               (1024*64)
+
+// Not consensus critical; game data records kept in memory, the rest are read from leveldb
+#define BTS_BLOCKCHAIN_GAME_DATA_CACHE_SIZE                 (1024*64)
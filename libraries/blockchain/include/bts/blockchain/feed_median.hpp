@@ -0,0 +1,63 @@
+#pragma once
+
+#include <bts/blockchain/feed_record.hpp>
+
+#include <map>
+#include <set>
+
+namespace bts { namespace blockchain {
+
+   /**
+    * @class feed_median
+    *
+    *  The feeds of one asset that currently count toward its median price: published by
+    *  an active delegate, quoted against the base asset, and updated less than a day
+    *  before the head block.
+    *
+    *  The prices are kept sorted together with an iterator to the element at index
+    *  size / 2, which is the price the nth_element scan over all active delegates used
+    *  to pick. Publishing or expiring a feed moves that iterator by at most one step, so
+    *  reading the median is constant time.
+    */
+   class feed_median
+   {
+      public:
+         feed_median( const asset_id_type quote_id, const time_point_sec now );
+
+         /** Replaces, adds or, for a null record, removes the feed of delegate_id */
+         void              store( const account_id_type delegate_id, const ofeed_record& record );
+
+         /** Drops the feeds that expired by now, which must not be earlier than the last call */
+         void              advance( const time_point_sec now );
+
+         time_point_sec    now()const { return _now; }
+         size_t            size()const { return _ratios.size(); }
+
+         /** The median price, or an invalid price if fewer than BTS_BLOCKCHAIN_MIN_FEEDS count */
+         oprice            median()const;
+
+      private:
+         struct tracked_feed
+         {
+            fc::uint128    ratio;
+            fc::time_point expiration;
+         };
+
+         typedef std::multiset<fc::uint128> ratio_index;
+
+         void              insert( const fc::uint128& ratio );
+         void              erase( const fc::uint128& ratio );
+         void              seek_median();
+
+         asset_id_type                                                  _quote_id;
+         time_point_sec                                                 _now;
+
+         ratio_index                                                    _ratios;
+         ratio_index::const_iterator                                    _median;
+         size_t                                                         _median_pos = 0;
+
+         unordered_map<account_id_type, tracked_feed>                   _feeds;
+         std::multimap<fc::time_point, account_id_type>                 _expirations;
+   };
+
+} } // bts::blockchain
@@ -6,3 +6,11 @@
 
 #include <stdint.h>
 #include <vector>
+
+// From this block, games whose script sets PLAY.isolated may only touch their own records in PLAY.execute,
+// and run beside each other
+#define BTS_V0_GAME_ISOLATION_FORK_BLOCK_NUM                1500000
+
+// From this block, calls into PLAY.execute and PLAY.evaluate are held to their call and step budgets, may not eval,
+// and must hand back arrays wherever arrays are expected
+#define BTS_V0_GAME_EXECUTION_LIMITS_FORK_BLOCK_NUM         1500000
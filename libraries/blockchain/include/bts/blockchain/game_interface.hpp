@@ -37,6 +37,26 @@ namespace bts { namespace blockchain {
    };
      */
     
+    /**
+     * What one game's script cost a block: its execute, and the evaluation of its
+     * operations while the block was built or applied. Kept by the game client for operators.
+     */
+    struct game_execution_profile
+    {
+        game_id_type    game_id = 0;
+        std::string     game_name;
+        uint32_t        block_num = 0;
+        uint32_t        execute_count = 0;       // 1 when the game was executed for the block
+        uint64_t        execute_us = 0;
+        uint32_t        evaluate_count = 0;
+        uint64_t        evaluate_us = 0;
+        uint64_t        max_budget_used = 0;     // the most any one call used of its budget
+        uint64_t        max_steps = 0;           // the most loop iterations and function calls any one call made
+        uint32_t        budget_exceeded = 0;     // calls stopped for running out of budget
+        uint64_t        used_heap_size = 0;      // of the game's isolate, after its last call
+        uint64_t        total_heap_size = 0;
+    };
+    
     class game_interface
     {
     public:
@@ -46,3 +66,18 @@ namespace bts { namespace blockchain {
 
 } } // bts:blockchain
 
+FC_REFLECT( bts::blockchain::game_execution_profile,
+            (game_id)
+            (game_name)
+            (block_num)
+            (execute_count)
+            (execute_us)
+            (evaluate_count)
+            (evaluate_us)
+            (max_budget_used)
+            (max_steps)
+            (budget_exceeded)
+            (used_heap_size)
+            (total_heap_size)
+            )
+
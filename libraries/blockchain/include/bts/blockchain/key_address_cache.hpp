@@ -0,0 +1,43 @@
+#pragma once
+
+#include <bts/blockchain/address.hpp>
+#include <bts/blockchain/types.hpp>
+
+#include <array>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace bts { namespace blockchain {
+
+   /**
+    *  Every address that a signature by a key satisfies: the BTS address followed by
+    *  the uncompressed and compressed BTC and PTS addresses.
+    */
+   typedef std::array<address, 5> key_addresses;
+
+   /**
+    * @class key_address_cache
+    *
+    *  Deriving the BTC and PTS forms of a key requires decompressing it, so they are
+    *  computed once per key and shared by transaction evaluation and the wallet.
+    *  Keys beyond BTS_BLOCKCHAIN_KEY_ADDRESS_CACHE_SIZE are dropped least recently
+    *  used first. Safe to use from any thread.
+    */
+   class key_address_cache
+   {
+       public:
+          static key_address_cache& instance();
+
+          key_addresses get_addresses( const public_key_type& key );
+          void          clear();
+
+       private:
+          typedef std::list<address>    lru_list;
+
+          std::mutex                                                                    _mutex;
+          lru_list                                                                      _lru;
+          std::unordered_map<address, std::pair<key_addresses, lru_list::iterator>>     _addresses;
+   };
+
+} } // bts::blockchain
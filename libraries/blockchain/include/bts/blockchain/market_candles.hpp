@@ -0,0 +1,115 @@
+#pragma once
+
+#include <bts/blockchain/market_records.hpp>
+#include <fc/filesystem.hpp>
+
+namespace bts { namespace blockchain {
+
+   enum candle_interval_enum
+   {
+      one_minute      = 60,
+      five_minutes    = 60*5,
+      fifteen_minutes = 60*15,
+      one_hour        = 60*60,
+      four_hours      = 60*60*4,
+      one_day         = 60*60*24,
+      one_week        = 60*60*24*7
+   };
+
+   /**
+    *  Open, high, low and close follow market_history_record: the first and last matched
+    *  bid price, the highest matched bid price and the lowest matched ask price. Volume is
+    *  counted as market_history_record counts it, the amount of the core asset received by
+    *  either side, and a block adds to the candles of a market only when that is above zero.
+    */
+   struct market_candle
+   {
+      time_point_sec    open_time;
+      price             open_price;
+      price             high_price;
+      price             low_price;
+      price             close_price;
+      share_type        volume = 0;
+   };
+
+   struct candle_series_key
+   {
+      asset_id_type     quote_id;
+      asset_id_type     base_id;
+      uint32_t          interval = one_minute;
+
+      friend bool operator < ( const candle_series_key& a, const candle_series_key& b )
+      {
+         return std::tie( a.quote_id, a.base_id, a.interval ) < std::tie( b.quote_id, b.base_id, b.interval );
+      }
+   };
+
+   /** One market at one interval, stored column by column in ascending open time */
+   struct candle_series
+   {
+      vector<uint32_t>      open_time;
+      vector<fc::uint128>   open;
+      vector<fc::uint128>   high;
+      vector<fc::uint128>   low;
+      vector<fc::uint128>   close;
+      vector<share_type>    volume;
+   };
+
+   /** The last candle of a series as it was before a block traded in it */
+   struct candle_undo_record
+   {
+      candle_series_key     key;
+      bool                  opened = false; // The block opened the candle, popping it removes the candle
+      fc::uint128           high;
+      fc::uint128           low;
+      fc::uint128           close;
+      share_type            volume = 0;
+   };
+
+   /**
+    * @class market_candle_store
+    *
+    *  Append-only OHLCV candles for every market at every supported interval, built from
+    *  the matched market transactions of each block. Candles are not part of consensus;
+    *  the store is saved alongside the chain indexes and can always be rebuilt from the
+    *  market transactions table.
+    */
+   class market_candle_store
+   {
+      public:
+         static const vector<candle_interval_enum>& intervals();
+
+         /** Blocks must be applied in increasing order */
+         void                    apply_block( const uint32_t block_num, const time_point_sec timestamp,
+                                              const vector<market_transaction>& transactions );
+
+         /** Removes the trades of the head block, which must be within BTS_BLOCKCHAIN_MAX_UNDO_HISTORY blocks */
+         void                    pop_block( const uint32_t block_num );
+
+         /** Candles opening within [start_time, end_time], oldest first */
+         vector<market_candle>   get_candles( const asset_id_type quote_id, const asset_id_type base_id,
+                                              const candle_interval_enum interval, const time_point_sec start_time,
+                                              const time_point_sec end_time, const uint32_t limit )const;
+
+         void                    clear() { _series.clear(); _undo_by_block.clear(); }
+
+         void                    save( const fc::path& file, const block_id_type& head_block_id )const;
+         /** Returns false, leaving the store empty, unless the file was saved at head_block_id */
+         bool                    load( const fc::path& file, const block_id_type& head_block_id );
+
+      private:
+         static void             add_trade( candle_series& series, const uint32_t open_time, const market_transaction& trx );
+
+         map<candle_series_key, candle_series>          _series;
+         /** Kept for the last BTS_BLOCKCHAIN_MAX_UNDO_HISTORY blocks */
+         map<uint32_t, vector<candle_undo_record>>      _undo_by_block;
+   };
+
+} } // bts::blockchain
+
+FC_REFLECT_ENUM( bts::blockchain::candle_interval_enum,
+                 (one_minute)(five_minutes)(fifteen_minutes)(one_hour)(four_hours)(one_day)(one_week) )
+FC_REFLECT( bts::blockchain::market_candle, (open_time)(open_price)(high_price)(low_price)(close_price)(volume) )
+FC_REFLECT( bts::blockchain::candle_series_key, (quote_id)(base_id)(interval) )
+FC_REFLECT( bts::blockchain::candle_series, (open_time)(open)(high)(low)(close)(volume) )
+FC_REFLECT( bts::blockchain::candle_undo_record, (key)(opened)(high)(low)(close)(volume) )
@@ -61,8 +61,8 @@ namespace bts { namespace blockchain { namespace detail {
     vector<market_transaction>    _market_transactions;
 
   private:
-    bts::db::cached_level_map< market_index_key, order_record >::iterator         _bid_itr;
-    bts::db::cached_level_map< market_index_key, order_record >::iterator         _ask_itr;
+    order_book_side::iterator     _bid_itr;
+    order_book_side::iterator     _ask_itr;
   };
 
 } } } // end namespace bts::blockchain::detail
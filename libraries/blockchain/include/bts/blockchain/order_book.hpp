@@ -0,0 +1,78 @@
+#pragma once
+
+#include <bts/blockchain/market_records.hpp>
+
+namespace bts { namespace blockchain {
+
+   /**
+    * @class order_book_side
+    *
+    *  The bids or the asks of a single market, grouped into price levels.
+    *
+    *  Orders within a level are queued by owner address rather than by arrival
+    *  because that is the order the bid and ask tables have always been matched
+    *  in; changing it would change consensus. Iteration starts at the best order
+    *  (highest bid or lowest ask) and walks toward worse prices, visiting orders in
+    *  exactly the sequence the market engine used to get from the global tables.
+    */
+   class order_book_side
+   {
+      public:
+         struct price_level
+         {
+            share_type                    total_balance = 0;
+            map<address, order_record>    orders;
+         };
+         typedef map<fc::uint128, price_level> level_index;
+
+         class iterator
+         {
+            public:
+               bool                 valid()const { return _side != nullptr; }
+               market_index_key     key()const;
+               const order_record&  value()const { return _order->second; }
+
+               /** Moves to the next worse order; a no-op once past the end */
+               iterator&            operator++();
+
+            private:
+               friend class order_book_side;
+
+               const order_book_side*                        _side = nullptr;
+               level_index::const_iterator                   _level;
+               map<address, order_record>::const_iterator    _order;
+         };
+
+         order_book_side( const asset_id_type quote_id, const asset_id_type base_id, const bool highest_first );
+
+         /** Inserts, updates or, for a null record, removes the order at key */
+         void                 store( const market_index_key& key, const order_record& order );
+
+         iterator             begin()const;
+         oorder_record        find( const market_index_key& key )const;
+
+         const level_index&   levels()const { return _levels; }
+         size_t               size()const { return _order_count; }
+         bool                 empty()const { return _order_count == 0; }
+
+      private:
+         asset_id_type        _quote_id;
+         asset_id_type        _base_id;
+         bool                 _highest_first;
+         level_index          _levels;
+         size_t               _order_count = 0;
+   };
+
+   /** Both sides of the book for one quote/base pair */
+   struct market_order_book
+   {
+      market_order_book( const asset_id_type quote_id, const asset_id_type base_id )
+      :bids( quote_id, base_id, true ),asks( quote_id, base_id, false ){}
+
+      bool empty()const { return bids.empty() && asks.empty(); }
+
+      order_book_side bids;
+      order_book_side asks;
+   };
+
+} } // bts::blockchain
@@ -15,6 +15,8 @@ namespace bts { namespace blockchain {
          virtual fc::time_point_sec     now()const override;
 
          virtual ogame_data_record      get_game_data_record( const game_id_type& game_id, const data_id_type& data_id )const override;
+         virtual map<data_id_type, game_data_record> scan_game_data_records( const game_id_type& game_id, const data_id_type& first,
+                                                                             const data_id_type& last, uint32_t limit )const override;
 
          virtual bool                   is_known_transaction( const transaction& trx )const override;
          virtual otransaction_record    get_transaction( const transaction_id_type& trx_id, bool exact = true )const override;
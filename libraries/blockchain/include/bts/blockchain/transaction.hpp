@@ -134,6 +134,7 @@ namespace bts { namespace blockchain {
       size_t                data_size()const;
       void                  sign( const fc::ecc::private_key& signer, const digest_type& chain_id );
       public_key_type       get_signing_key( const size_t sig_index, const digest_type& chain_id )const;
+      vector<public_key_type> get_signing_keys( const digest_type& chain_id, const bool enforce_canonical )const;
 
       vector<fc::ecc::compact_signature> signatures;
    };
@@ -74,6 +74,9 @@ struct transaction_evaluation_state
     bool                                           _enforce_canonical_signatures = false;
     bool                                           _skip_vote_adjustment = false;
 
+    // Signing keys recovered ahead of time in signature order; evaluate() recovers them itself if unset
+    optional<vector<public_key_type>>              _signing_keys;
+
 private:
     std::weak_ptr<pending_chain_state>             _pending_state;
     uint32_t                                       _current_op_index = 0;
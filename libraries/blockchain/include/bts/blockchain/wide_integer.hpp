@@ -0,0 +1,180 @@
+#pragma once
+
+#include <fc/uint128.hpp>
+
+#include <cstdint>
+
+#if defined( __SIZEOF_INT128__ )
+#define BTS_NATIVE_UINT128
+#endif
+
+namespace bts { namespace blockchain {
+
+#ifdef BTS_NATIVE_UINT128
+   typedef unsigned __int128 native_uint128;
+#endif
+
+   namespace detail
+   {
+      /** 64x64 -> 128 bit multiply; returns the high half and stores the low half in lo */
+      inline uint64_t mul_64( const uint64_t a, const uint64_t b, uint64_t& lo )
+      {
+#ifdef BTS_NATIVE_UINT128
+         const native_uint128 product = native_uint128( a ) * b;
+         lo = uint64_t( product );
+         return uint64_t( product >> 64 );
+#else
+         const uint64_t a_lo = uint32_t( a ), a_hi = a >> 32;
+         const uint64_t b_lo = uint32_t( b ), b_hi = b >> 32;
+         const uint64_t p0 = a_lo * b_lo;
+         const uint64_t p1 = a_lo * b_hi;
+         const uint64_t p2 = a_hi * b_lo;
+         const uint64_t p3 = a_hi * b_hi;
+         const uint64_t mid = ( p0 >> 32 ) + uint32_t( p1 ) + uint32_t( p2 );
+         lo = ( mid << 32 ) | uint32_t( p0 );
+         return p3 + ( p1 >> 32 ) + ( p2 >> 32 ) + ( mid >> 32 );
+#endif
+      }
+
+      /** (hi:lo) / d for hi < d; returns the quotient and stores the remainder in rem */
+      inline uint64_t div_128_by_64( uint64_t hi, uint64_t lo, const uint64_t d, uint64_t& rem )
+      {
+#ifdef BTS_NATIVE_UINT128
+         const native_uint128 n = ( native_uint128( hi ) << 64 ) | lo;
+         rem = uint64_t( n % d );
+         return uint64_t( n / d );
+#else
+         uint64_t q = 0;
+         for( int i = 0; i < 64; ++i )
+         {
+            const bool carry = ( hi >> 63 ) != 0;
+            hi = ( hi << 1 ) | ( lo >> 63 );
+            lo <<= 1;
+            q <<= 1;
+            if( carry || hi >= d )
+            {
+               hi -= d;
+               q |= 1;
+            }
+         }
+         rem = hi;
+         return q;
+#endif
+      }
+   } // detail
+
+   /**
+    *  Fixed width unsigned integer made of Limbs 64-bit words, least significant first.
+    *
+    *  Provides just what price and asset arithmetic needs to stay exact without
+    *  fc::bigint: widening multiplication, division by a 64-bit word and comparison.
+    *  Nothing here allocates.
+    */
+   template<unsigned Limbs>
+   struct wide_uint
+   {
+      static_assert( Limbs >= 2, "wide_uint needs at least 128 bits" );
+
+      uint64_t limb[ Limbs ];
+
+      wide_uint() : limb() {}
+      wide_uint( const uint64_t v ) : limb() { limb[ 0 ] = v; }
+      wide_uint( const fc::uint128& v ) : limb() { limb[ 0 ] = v.low_bits(); limb[ 1 ] = v.high_bits(); }
+
+      bool is_zero()const
+      {
+         for( unsigned i = 0; i < Limbs; ++i )
+            if( limb[ i ] != 0 ) return false;
+         return true;
+      }
+
+      /** Number of significant bits, 0 for zero (same as BN_num_bits) */
+      unsigned num_bits()const
+      {
+         for( unsigned i = Limbs; i > 0; --i )
+         {
+            uint64_t word = limb[ i - 1 ];
+            if( word == 0 ) continue;
+            unsigned bits = 0;
+            while( word != 0 ) { ++bits; word >>= 1; }
+            return ( i - 1 ) * 64 + bits;
+         }
+         return 0;
+      }
+
+      /** Low 128 bits */
+      fc::uint128 to_uint128()const { return fc::uint128( limb[ 1 ], limb[ 0 ] ); }
+
+      /** Two's complement negation modulo 2^(64*Limbs) */
+      wide_uint& negate()
+      {
+         uint64_t carry = 1;
+         for( unsigned i = 0; i < Limbs; ++i )
+         {
+            limb[ i ] = ~limb[ i ] + carry;
+            carry = ( carry != 0 && limb[ i ] == 0 ) ? 1 : 0;
+         }
+         return *this;
+      }
+
+      /** Divides in place by d != 0 and returns the remainder */
+      uint64_t divide( const uint64_t d )
+      {
+         uint64_t rem = 0;
+         for( unsigned i = Limbs; i > 0; --i )
+            limb[ i - 1 ] = detail::div_128_by_64( rem, limb[ i - 1 ], d, rem );
+         return rem;
+      }
+
+      friend int compare( const wide_uint& a, const wide_uint& b )
+      {
+         for( unsigned i = Limbs; i > 0; --i )
+         {
+            if( a.limb[ i - 1 ] < b.limb[ i - 1 ] ) return -1;
+            if( a.limb[ i - 1 ] > b.limb[ i - 1 ] ) return 1;
+         }
+         return 0;
+      }
+
+      friend bool operator == ( const wide_uint& a, const wide_uint& b ) { return compare( a, b ) == 0; }
+      friend bool operator != ( const wide_uint& a, const wide_uint& b ) { return compare( a, b ) != 0; }
+      friend bool operator <  ( const wide_uint& a, const wide_uint& b ) { return compare( a, b ) <  0; }
+      friend bool operator >= ( const wide_uint& a, const wide_uint& b ) { return compare( a, b ) >= 0; }
+
+      /** Product modulo 2^(64*Limbs); exact whenever the operands' bit counts sum to at most 64*Limbs */
+      friend wide_uint operator * ( const wide_uint& a, const wide_uint& b )
+      {
+         wide_uint result;
+         for( unsigned i = 0; i < Limbs; ++i )
+         {
+            if( a.limb[ i ] == 0 ) continue;
+            uint64_t carry = 0;
+            for( unsigned j = 0; i + j < Limbs; ++j )
+            {
+               uint64_t lo;
+               uint64_t hi = detail::mul_64( a.limb[ i ], b.limb[ j ], lo );
+               lo += carry;
+               hi += ( lo < carry );
+               result.limb[ i + j ] += lo;
+               hi += ( result.limb[ i + j ] < lo );
+               carry = hi;
+            }
+         }
+         return result;
+      }
+   };
+
+   /** Quotient of two 128-bit values, d != 0 */
+   inline fc::uint128 divide_uint128( const fc::uint128& n, const fc::uint128& d )
+   {
+#ifdef BTS_NATIVE_UINT128
+      const native_uint128 nn = ( native_uint128( n.high_bits() ) << 64 ) | n.low_bits();
+      const native_uint128 dd = ( native_uint128( d.high_bits() ) << 64 ) | d.low_bits();
+      const native_uint128 q = nn / dd;
+      return fc::uint128( uint64_t( q >> 64 ), uint64_t( q ) );
+#else
+      return n / d;
+#endif
+   }
+
+} } // bts::blockchain
@@ -0,0 +1,57 @@
+#include <bts/blockchain/config.hpp>
+#include <bts/blockchain/key_address_cache.hpp>
+#include <bts/blockchain/pts_address.hpp>
+
+namespace bts { namespace blockchain {
+
+    key_address_cache& key_address_cache::instance()
+    { try {
+        static std::unique_ptr<key_address_cache> inst( new key_address_cache() );
+        return *inst;
+    } FC_CAPTURE_AND_RETHROW() }
+
+    key_addresses key_address_cache::get_addresses( const public_key_type& key )
+    { try {
+        const address key_address = address( key );
+        {
+            std::lock_guard<std::mutex> lock( _mutex );
+            const auto iter = _addresses.find( key_address );
+            if( iter != _addresses.end() )
+            {
+                _lru.splice( _lru.begin(), _lru, iter->second.second );
+                return iter->second.first;
+            }
+        }
+
+        const key_addresses addresses =
+        {{
+            key_address,
+            address( pts_address( key, false, 0  ) ), // Uncompressed BTC
+            address( pts_address( key, true,  0  ) ), // Compressed BTC
+            address( pts_address( key, false, 56 ) ), // Uncompressed PTS
+            address( pts_address( key, true,  56 ) )  // Compressed PTS
+        }};
+
+        std::lock_guard<std::mutex> lock( _mutex );
+        // Another thread may have derived the same key meanwhile
+        if( _addresses.count( key_address ) )
+            return addresses;
+
+        _lru.push_front( key_address );
+        _addresses.emplace( key_address, std::make_pair( addresses, _lru.begin() ) );
+        while( _addresses.size() > BTS_BLOCKCHAIN_KEY_ADDRESS_CACHE_SIZE )
+        {
+            _addresses.erase( _lru.back() );
+            _lru.pop_back();
+        }
+        return addresses;
+    } FC_CAPTURE_AND_RETHROW( (key) ) }
+
+    void key_address_cache::clear()
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _addresses.clear();
+        _lru.clear();
+    }
+
+} } // bts::blockchain
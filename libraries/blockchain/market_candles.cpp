@@ -0,0 +1,209 @@
+#include <bts/blockchain/config.hpp>
+#include <bts/blockchain/market_candles.hpp>
+
+#include <fc/io/fstream.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+
+namespace bts { namespace blockchain {
+
+   const vector<candle_interval_enum>& market_candle_store::intervals()
+   {
+      static const vector<candle_interval_enum> all_intervals{ one_minute, five_minutes, fifteen_minutes, one_hour,
+                                                               four_hours, one_day, one_week };
+      return all_intervals;
+   }
+
+   /** The core asset received by either side, which is what market_engine counts as market history volume */
+   static share_type trading_volume( const market_transaction& trx )
+   {
+      if( trx.ask_received.asset_id == 0 )
+         return trx.ask_received.amount;
+      if( trx.bid_received.asset_id == 0 )
+         return trx.bid_received.amount;
+      return 0;
+   }
+
+   void market_candle_store::add_trade( candle_series& series, const uint32_t open_time, const market_transaction& trx )
+   {
+      const fc::uint128& bid_ratio = trx.bid_price.ratio;
+      const fc::uint128& ask_ratio = trx.ask_price.ratio;
+
+      if( series.open_time.empty() || series.open_time.back() < open_time )
+      {
+         series.open_time.push_back( open_time );
+         series.open.push_back( bid_ratio );
+         series.high.push_back( bid_ratio );
+         series.low.push_back( ask_ratio );
+         series.close.push_back( bid_ratio );
+         series.volume.push_back( trading_volume( trx ) );
+         return;
+      }
+
+      FC_ASSERT( series.open_time.back() == open_time, "market candles must be appended in time order" );
+      series.high.back() = std::max( series.high.back(), bid_ratio );
+      series.low.back() = std::min( series.low.back(), ask_ratio );
+      series.close.back() = bid_ratio;
+      series.volume.back() += trading_volume( trx );
+   }
+
+   void market_candle_store::apply_block( const uint32_t block_num, const time_point_sec timestamp,
+                                          const vector<market_transaction>& transactions )
+   {
+      // The trades of each market in this block, in the order they were matched
+      map<candle_series_key, vector<const market_transaction*>> trades_by_market;
+      map<candle_series_key, share_type> volume_by_market;
+      for( const market_transaction& trx : transactions )
+      {
+         candle_series_key key;
+         key.quote_id = trx.bid_price.quote_asset_id;
+         key.base_id = trx.bid_price.base_asset_id;
+         trades_by_market[ key ].push_back( &trx );
+         volume_by_market[ key ] += trading_volume( trx );
+      }
+
+      vector<candle_undo_record> undo_records;
+      for( const auto& item : trades_by_market )
+      {
+         // Same as market_engine::update_market_history
+         if( volume_by_market[ item.first ] <= 0 )
+            continue;
+
+         candle_series_key key = item.first;
+         for( const candle_interval_enum interval : intervals() )
+         {
+            key.interval = interval;
+            const uint32_t open_time = timestamp.sec_since_epoch() - (timestamp.sec_since_epoch() % interval);
+            candle_series& series = _series[ key ];
+
+            candle_undo_record undo;
+            undo.key = key;
+            undo.opened = series.open_time.empty() || series.open_time.back() < open_time;
+            if( !undo.opened )
+            {
+               undo.high = series.high.back();
+               undo.low = series.low.back();
+               undo.close = series.close.back();
+               undo.volume = series.volume.back();
+            }
+            undo_records.push_back( undo );
+
+            for( const market_transaction* trx : item.second )
+               add_trade( series, open_time, *trx );
+         }
+      }
+
+      if( !undo_records.empty() )
+         _undo_by_block[ block_num ] = std::move( undo_records );
+      while( !_undo_by_block.empty() && _undo_by_block.begin()->first + BTS_BLOCKCHAIN_MAX_UNDO_HISTORY <= block_num )
+         _undo_by_block.erase( _undo_by_block.begin() );
+   }
+
+   void market_candle_store::pop_block( const uint32_t block_num )
+   {
+      // Blocks without trades leave no undo records
+      const auto undo_itr = _undo_by_block.find( block_num );
+      if( undo_itr == _undo_by_block.end() )
+         return;
+
+      for( const candle_undo_record& undo : undo_itr->second )
+      {
+         const auto series_itr = _series.find( undo.key );
+         FC_ASSERT( series_itr != _series.end() && !series_itr->second.open_time.empty() );
+         candle_series& series = series_itr->second;
+
+         if( undo.opened )
+         {
+            series.open_time.pop_back();
+            series.open.pop_back();
+            series.high.pop_back();
+            series.low.pop_back();
+            series.close.pop_back();
+            series.volume.pop_back();
+            if( series.open_time.empty() )
+               _series.erase( series_itr );
+         }
+         else
+         {
+            series.high.back() = undo.high;
+            series.low.back() = undo.low;
+            series.close.back() = undo.close;
+            series.volume.back() = undo.volume;
+         }
+      }
+
+      _undo_by_block.erase( undo_itr );
+   }
+
+   vector<market_candle> market_candle_store::get_candles( const asset_id_type quote_id, const asset_id_type base_id,
+                                                           const candle_interval_enum interval,
+                                                           const time_point_sec start_time, const time_point_sec end_time,
+                                                           const uint32_t limit )const
+   {
+      vector<market_candle> candles;
+
+      candle_series_key key;
+      key.quote_id = quote_id;
+      key.base_id = base_id;
+      key.interval = interval;
+      const auto itr = _series.find( key );
+      if( itr == _series.end() )
+         return candles;
+
+      const candle_series& series = itr->second;
+      const auto begin = std::lower_bound( series.open_time.begin(), series.open_time.end(), start_time.sec_since_epoch() );
+      const auto end = std::upper_bound( begin, series.open_time.end(), end_time.sec_since_epoch() );
+
+      const size_t first = begin - series.open_time.begin();
+      const size_t count = std::min<size_t>( end - begin, limit );
+      candles.resize( count );
+      for( size_t i = 0; i < count; ++i )
+      {
+         market_candle& candle = candles[ i ];
+         candle.open_time = time_point_sec( series.open_time[ first + i ] );
+         candle.open_price = price( series.open[ first + i ], quote_id, base_id );
+         candle.high_price = price( series.high[ first + i ], quote_id, base_id );
+         candle.low_price = price( series.low[ first + i ], quote_id, base_id );
+         candle.close_price = price( series.close[ first + i ], quote_id, base_id );
+         candle.volume = series.volume[ first + i ];
+      }
+      return candles;
+   }
+
+   void market_candle_store::save( const fc::path& file, const block_id_type& head_block_id )const
+   { try {
+      fc::ofstream out( file );
+      fc::raw::pack( out, head_block_id );
+      fc::raw::pack( out, _series );
+      fc::raw::pack( out, _undo_by_block );
+   } FC_CAPTURE_AND_RETHROW( (file)(head_block_id) ) }
+
+   bool market_candle_store::load( const fc::path& file, const block_id_type& head_block_id )
+   {
+      clear();
+      if( !fc::exists( file ) )
+         return false;
+
+      try
+      {
+         fc::ifstream in( file );
+         block_id_type saved_head_block_id;
+         fc::raw::unpack( in, saved_head_block_id );
+         if( saved_head_block_id != head_block_id )
+            return false;
+
+         fc::raw::unpack( in, _series );
+         fc::raw::unpack( in, _undo_by_block );
+         return true;
+      }
+      catch( const fc::exception& e )
+      {
+         wlog( "unable to load market candles from ${f}: ${e}", ("f",file)("e",e.to_detail_string()) );
+         clear();
+      }
+      return false;
+   }
+
+} } // bts::blockchain
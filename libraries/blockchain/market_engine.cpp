@@ -32,41 +32,18 @@ namespace bts { namespace blockchain { namespace detail {
           FC_ASSERT( !quote_asset->flag_is_active( asset_record::halted_markets ) );
           FC_ASSERT( !base_asset->flag_is_active( asset_record::halted_markets ) );
 
-          // The order book is sorted from low to high price. So to get the last item (highest bid),
-          // we need to go to the first item in the next market class and then back up one
-          const price current_pair = price( 0, quote_id, base_id );
-          const price next_pair = (base_id+1 == quote_id) ? price( 0, quote_id+1, 0 ) : price( 0, quote_id, base_id+1 );
-
-          _bid_itr           = _db_impl._bid_db.lower_bound( market_index_key( next_pair ) );
-
-          _ask_itr           = _db_impl._ask_db.lower_bound( market_index_key( price( 0, quote_id, base_id ) ) );
+          // The book iterators start at the highest bid and the lowest ask and only visit this market
+          const market_order_book* book = _db_impl.get_order_book( quote_id, base_id );
+          if( book != nullptr )
+          {
+              _bid_itr = book->bids.begin();
+              _ask_itr = book->asks.begin();
+          }
 
           int last_orders_filled = -1;
           asset trading_volume(0, base_id);
           price opening_price, closing_price, highest_price, lowest_price;
 
-          if( !_ask_itr.valid() ) _ask_itr = _db_impl._ask_db.begin();
-
-          //
-          // following logic depends on the internals of cached_level_map class.
-          // if lower_bound() argument is past the end of the collection,
-          // then result will point to end() which has valid() == false
-          //
-          // so we need to decrement the returned iterator, but
-          // decrement operator may be undefined for end(), so we
-          // special-case the result.
-          //
-          // one day we should write a greatest_element_below() method
-          // for our DB class to implement the logic we're doing
-          // directly here
-          //
-          // decrementing begin() OTOH is well-defined and returns
-          // end() which is invalid, thus overflow of --itr here is
-          // ok as long as we check valid() later
-          //
-          if( _bid_itr.valid() )   --_bid_itr;
-          else _bid_itr = _db_impl._bid_db.last();
-
           // Market issued assets cannot match until the first time there is a median feed; assume feed price base id 0
           if( quote_asset->is_market_issued() && base_asset->id == 0 )
           {
@@ -345,17 +322,12 @@ namespace bts { namespace blockchain { namespace detail {
       optional<market_order> bid;
 
       if( _bid_itr.valid() )
-      {
-         market_order abs_bid( bid_order, _bid_itr.key(), _bid_itr.value() );
-         if( abs_bid.get_price().quote_asset_id == _quote_id && abs_bid.get_price().base_asset_id == _base_id )
-         {
-            bid = abs_bid;
-         }
-      }
+         bid = market_order( bid_order, _bid_itr.key(), _bid_itr.value() );
+
       if( !_feed_price )
       {
          _current_bid = bid;
-         --_bid_itr;
+         ++_bid_itr;
          return _current_bid.valid();
       }
 
@@ -421,7 +393,7 @@ namespace bts { namespace blockchain { namespace detail {
           switch( uint8_t(bid->type) )
           {
               case bid_order:
-                  --_bid_itr;
+                  ++_bid_itr;
                   break;
               default:
                   FC_ASSERT( false, "Unknown Bid Type" );
@@ -459,11 +431,7 @@ namespace bts { namespace blockchain { namespace detail {
       if( !_ask_itr.valid() )
           return false;
 
-      market_order abs_ask = market_order( ask_order, _ask_itr.key(), _ask_itr.value() );
-      if( (abs_ask.get_price().quote_asset_id != _quote_id) || (abs_ask.get_price().base_asset_id != _base_id) )
-          return false;
-
-      _current_ask = abs_ask;
+      _current_ask = market_order( ask_order, _ask_itr.key(), _ask_itr.value() );
       ++_ask_itr;
 
       return true;
@@ -0,0 +1,121 @@
+#include <bts/blockchain/order_book.hpp>
+
+#include <iterator>
+
+namespace bts { namespace blockchain {
+
+   market_index_key order_book_side::iterator::key()const
+   {
+      return market_index_key( price( _level->first, _side->_quote_id, _side->_base_id ), _order->first );
+   }
+
+   order_book_side::iterator& order_book_side::iterator::operator++()
+   {
+      if( !valid() ) return *this;
+
+      if( !_side->_highest_first )
+      {
+         if( ++_order != _level->second.orders.end() ) return *this;
+         if( ++_level == _side->_levels.end() )
+         {
+            _side = nullptr;
+            return *this;
+         }
+         _order = _level->second.orders.begin();
+      }
+      else
+      {
+         if( _order != _level->second.orders.begin() )
+         {
+            --_order;
+            return *this;
+         }
+         if( _level == _side->_levels.begin() )
+         {
+            _side = nullptr;
+            return *this;
+         }
+         --_level;
+         _order = std::prev( _level->second.orders.end() );
+      }
+      return *this;
+   }
+
+   order_book_side::order_book_side( const asset_id_type quote_id, const asset_id_type base_id, const bool highest_first )
+   :_quote_id( quote_id ),_base_id( base_id ),_highest_first( highest_first )
+   {
+   }
+
+   void order_book_side::store( const market_index_key& key, const order_record& order )
+   {
+      FC_ASSERT( key.order_price.quote_asset_id == _quote_id && key.order_price.base_asset_id == _base_id );
+
+      auto level_itr = _levels.find( key.order_price.ratio );
+      if( level_itr != _levels.end() )
+      {
+         price_level& level = level_itr->second;
+         const auto order_itr = level.orders.find( key.owner );
+         if( order_itr != level.orders.end() )
+         {
+            level.total_balance -= order_itr->second.balance;
+            if( order.is_null() )
+            {
+               level.orders.erase( order_itr );
+               --_order_count;
+               if( level.orders.empty() )
+                  _levels.erase( level_itr );
+            }
+            else
+            {
+               order_itr->second = order;
+               level.total_balance += order.balance;
+            }
+            return;
+         }
+      }
+
+      if( order.is_null() )
+         return;
+
+      if( level_itr == _levels.end() )
+         level_itr = _levels.emplace( key.order_price.ratio, price_level() ).first;
+
+      level_itr->second.orders.emplace( key.owner, order );
+      level_itr->second.total_balance += order.balance;
+      ++_order_count;
+   }
+
+   order_book_side::iterator order_book_side::begin()const
+   {
+      iterator itr;
+      if( _levels.empty() )
+         return itr;
+
+      itr._side = this;
+      if( _highest_first )
+      {
+         itr._level = std::prev( _levels.end() );
+         itr._order = std::prev( itr._level->second.orders.end() );
+      }
+      else
+      {
+         itr._level = _levels.begin();
+         itr._order = itr._level->second.orders.begin();
+      }
+      return itr;
+   }
+
+   oorder_record order_book_side::find( const market_index_key& key )const
+   {
+      const auto level_itr = _levels.find( key.order_price.ratio );
+      if( level_itr == _levels.end() )
+         return oorder_record();
+
+      const auto order_itr = level_itr->second.orders.find( key.owner );
+      if( order_itr == level_itr->second.orders.end() )
+         return oorder_record();
+
+      return order_itr->second;
+   }
+
+} } // bts::blockchain
@@ -181,6 +181,36 @@ namespace bts { namespace blockchain {
        return ogame_data_record();
    }
 
+   map<data_id_type, game_data_record> pending_chain_state::scan_game_data_records( const game_id_type& game_id, const data_id_type& first,
+                                                                                   const data_id_type& last, uint32_t limit )const
+   { try {
+       map<data_id_type, game_data_record> records;
+       if( limit == 0 || last < first ) return records;
+
+       const auto lower = game_datas.lower_bound( std::make_pair( game_id, first ) );
+       const auto upper = game_datas.upper_bound( std::make_pair( game_id, last ) );
+
+       // each record changed here hides at most one of the previous state's
+       chain_interface_ptr prev_state = _prev_state.lock();
+       if( prev_state )
+       {
+           const uint64_t prev_limit = uint64_t( limit ) + std::distance( lower, upper );
+           records = prev_state->scan_game_data_records( game_id, first, last, uint32_t( std::min<uint64_t>( prev_limit, uint32_t( -1 ) ) ) );
+       }
+
+       for( auto itr = lower; itr != upper; ++itr )
+       {
+           if( itr->second.is_null() )
+               records.erase( itr->first.second );
+           else
+               records[ itr->first.second ] = itr->second;
+       }
+
+       while( records.size() > limit )
+           records.erase( std::prev( records.end() ) );
+       return records;
+   } FC_CAPTURE_AND_RETHROW( (game_id)(first)(last)(limit) ) }
+
    void pending_chain_state::store_game_data_record( const game_id_type& game_id, const data_id_type& data_id, const game_data_record& r )
    {
        game_datas[std::make_pair(game_id, data_id)] = r;
@@ -43,6 +43,16 @@ namespace bts { namespace blockchain {
        return fc::ecc::public_key( signatures.at( sig_index ), this->digest( chain_id ), false );
    } FC_CAPTURE_AND_RETHROW( (sig_index)(chain_id) ) }
 
+   vector<public_key_type> signed_transaction::get_signing_keys( const digest_type& chain_id, const bool enforce_canonical )const
+   { try {
+       const digest_type trx_digest = this->digest( chain_id );
+       vector<public_key_type> keys;
+       keys.reserve( signatures.size() );
+       for( const auto& sig : signatures )
+           keys.push_back( fc::ecc::public_key( sig, trx_digest, enforce_canonical ) );
+       return keys;
+   } FC_CAPTURE_AND_RETHROW( (chain_id)(enforce_canonical) ) }
+
    void transaction::define_slate( const set<account_id_type>& slate )
    { try {
        define_slate_operation op;
@@ -1,4 +1,5 @@
 #include <bts/blockchain/balance_operations.hpp>
+#include <bts/blockchain/key_address_cache.hpp>
 #include <bts/blockchain/operation_factory.hpp>
 #include <bts/blockchain/pending_chain_state.hpp>
 #include <bts/blockchain/transaction_evaluation_state.hpp>
@@ -144,15 +145,14 @@ namespace bts { namespace blockchain {
 
         if( !_skip_signature_check )
         {
-           const auto trx_digest = trx_arg.digest( pending_state()->get_chain_id() );
-           for( const auto& sig : trx_arg.signatures )
+           if( !_signing_keys.valid() )
+              _signing_keys = trx_arg.get_signing_keys( pending_state()->get_chain_id(), _enforce_canonical_signatures );
+           FC_ASSERT( _signing_keys->size() == trx_arg.signatures.size() );
+
+           for( const public_key_type& key : *_signing_keys )
            {
-              const auto key = fc::ecc::public_key( sig, trx_digest, _enforce_canonical_signatures ).serialize();
-              signed_addresses.insert( address( key ) );
-              signed_addresses.insert( address( pts_address( key, false, 56 ) ) );
-              signed_addresses.insert( address( pts_address( key, true, 56 ) ) );
-              signed_addresses.insert( address( pts_address( key, false, 0 ) ) );
-              signed_addresses.insert( address( pts_address( key, true, 0 ) ) );
+              const key_addresses addresses = key_address_cache::instance().get_addresses( key );
+              signed_addresses.insert( addresses.begin(), addresses.end() );
            }
         }
 
@@ -663,6 +663,19 @@ market_history_points client_impl::blockchain_market_price_history( const std::s
                                                start_time, duration, granularity );
 }
 
+vector<market_candle> client_impl::blockchain_market_candles( const std::string& quote_symbol,
+                                                              const std::string& base_symbol,
+                                                              const candle_interval_enum& interval,
+                                                              const fc::time_point& start_time,
+                                                              const fc::microseconds& duration,
+                                                              uint32_t limit )const
+{
+   const time_point_sec start = start_time;
+   return _chain_db->get_market_candles( _chain_db->get_asset_id( quote_symbol ),
+                                         _chain_db->get_asset_id( base_symbol ),
+                                         interval, start, start + duration.to_seconds(), limit );
+}
+
 map<transaction_id_type, transaction_record> client_impl::blockchain_get_block_transactions( const string& block )const
 {
    vector<transaction_record> transactions;
@@ -74,6 +74,11 @@ std::vector<bts::blockchain::game_result_transaction> client_impl::game_list_res
     return _chain_db->get_game_result_transactions( block_number );
 }
 
+std::vector<bts::blockchain::game_execution_profile> client_impl::game_list_execution_profiles(uint32_t block_number) const
+{
+    return _game_client->get_execution_profiles( block_number );
+}
+
 uint64_t client_impl::game_util_cnr(uint16_t N, uint16_t r) const
 {
     return bts::utilities::cnr(N, r);
@@ -1,6 +1,7 @@
 #include <bts/blockchain/time.hpp>
 #include <bts/client/client.hpp>
 #include <bts/client/client_impl.hpp>
+#include <bts/rpc/api_trace.hpp>
 
 namespace bts { namespace client { namespace detail {
 
@@ -195,12 +196,7 @@ fc::variants client_impl::batch( const std::string& method_name,
 fc::variants client_impl::batch_authenticated( const std::string& method_name,
                                  const std::vector<fc::variants>& parameters_list) const
 {
-   fc::variants result;
-   for ( auto parameters : parameters_list )
-   {
-      result.push_back( _self->get_rpc_server()->direct_invoke_method( method_name, parameters) );
-   }
-   return result;
+   return _self->get_rpc_server()->batch_invoke_method( method_name, parameters_list );
 }
 
 wallet_transaction_record  client_impl::builder_finalize_and_sign( const transaction_builder& builder )const
@@ -311,4 +307,14 @@ variant detail::client_impl::disk_usage()const
    return usage;
 }
 
+variant detail::client_impl::rpc_cache_stats()const
+{
+   return variant( _rpc_server->get_response_cache_stats() );
+}
+
+variant detail::client_impl::rpc_trace_stats()const
+{
+   return variant( bts::rpc::api_tracer::instance().get_stats() );
+}
+
 } } } // namespace bts::client::detail
@@ -4,6 +4,7 @@
 #include <bts/blockchain/chain_database.hpp>
 #include <bts/client/seed_nodes.hpp>
 #include <bts/net/node.hpp>
+#include <bts/rpc/api_trace.hpp>
 #include <bts/rpc/rpc_client_api.hpp>
 #include <bts/rpc_stubs/common_api_client.hpp>
 #include <bts/wallet/wallet.hpp>
@@ -53,6 +54,11 @@ namespace bts { namespace client {
 
       bool             enable;
       bool             enable_cache = true;
+      uint64_t         cache_size = 64 * 1024 * 1024; // bytes of cached replies
+      uint32_t         reader_threads = 2; // run read only blockchain calls off the client thread; 0 disables
+      uint32_t         batch_max_size = 1000; // calls in one batch request
+      uint32_t         batch_max_parallel = 16; // calls of one batch queued on the reader threads at once
+      bts::rpc::api_trace_config trace; // per call latency and payload sizes, off unless a file or endpoint is set
       std::string      rpc_user;
       std::string      rpc_password;
       fc::ip::endpoint rpc_endpoint;
@@ -204,7 +210,7 @@ namespace bts { namespace client {
 extern const std::string BTS_MESSAGE_MAGIC;
 
 FC_REFLECT(bts::client::client_notification, (timestamp)(message)(signature) )
-FC_REFLECT( bts::client::rpc_server_config, (enable)(enable_cache)(rpc_user)(rpc_password)(rpc_endpoint)(httpd_endpoint)
+FC_REFLECT( bts::client::rpc_server_config, (enable)(enable_cache)(cache_size)(reader_threads)(batch_max_size)(batch_max_parallel)(trace)(rpc_user)(rpc_password)(rpc_endpoint)(httpd_endpoint)
             (encrypted_rpc_endpoint)(encrypted_rpc_wif_key)(htdocs) )
 FC_REFLECT( bts::client::chain_server_config, (enabled)(listen_port) )
 FC_REFLECT( bts::client::config,
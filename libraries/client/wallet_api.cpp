@@ -321,6 +321,28 @@ wallet_transaction_record detail::client_impl::wallet_transfer(
     return record;
 } FC_CAPTURE_AND_RETHROW( (amount_to_transfer)(asset_symbol)(from_account_name)(recipient)(memo_message)(strategy) ) }
 
+vector<wallet_transaction_record> detail::client_impl::wallet_batch_transfer(
+        const string& asset_symbol,
+        const string& from_account_name,
+        const vector<std::pair<string, string>>& payouts,
+        const string& memo_message,
+        const vote_strategy& strategy )
+{ try {
+    vector<std::pair<string, asset>> amounts;
+    amounts.reserve( payouts.size() );
+    for( const auto& payout : payouts )
+        amounts.emplace_back( payout.first, _chain_db->to_ugly_asset( payout.second, asset_symbol ) );
+
+    auto records = _wallet->batch_transfer( amounts, from_account_name, memo_message, strategy, true );
+    for( auto& record : records )
+    {
+        _wallet->cache_transaction( record );
+        network_broadcast_transaction( record.trx );
+    }
+
+    return records;
+} FC_CAPTURE_AND_RETHROW( (asset_symbol)(from_account_name)(memo_message)(strategy) ) }
+
 wallet_transaction_record detail::client_impl::wallet_burn(
         const string& amount_to_transfer,
         const string& asset_symbol,
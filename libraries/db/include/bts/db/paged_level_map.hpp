@@ -0,0 +1,202 @@
+#pragma once
+#include <bts/db/level_map.hpp>
+
+#include <list>
+#include <map>
+#include <mutex>
+
+namespace bts { namespace db {
+
+   /**
+    *  Like cached_level_map, but only the most recently used records are kept in memory;
+    *  the rest are read from leveldb when asked for. Ranges are scanned from leveldb without
+    *  disturbing the cache. Writes not yet flushed are kept in memory until they are.
+    *
+    *  Reads may come from several threads at once.
+    */
+   template<typename Key, typename Value>
+   class paged_level_map
+   {
+      public:
+        void open( const fc::path& dir, bool create = true, size_t leveldb_cache_size = 0, bool write_through = true, bool sync_on_write = false )
+        { try {
+            _db.open( dir, create, leveldb_cache_size );
+            _write_through = write_through;
+            _sync_on_write = sync_on_write;
+        } FC_CAPTURE_AND_RETHROW( (dir)(create)(leveldb_cache_size)(write_through)(sync_on_write) ) }
+
+        void close()
+        { try {
+            if( _db.is_open() ) flush();
+            _db.close();
+            std::lock_guard<std::mutex> lock( _mutex );
+            _cache.clear();
+            _lru.clear();
+        } FC_CAPTURE_AND_RETHROW() }
+
+        void set_write_through( bool write_through )
+        { try {
+            if( write_through == _write_through )
+                return;
+
+            if( write_through )
+                flush();
+
+            _write_through = write_through;
+        } FC_CAPTURE_AND_RETHROW( (write_through) ) }
+
+        /** records beyond this many are dropped from memory, least recently used first */
+        void set_max_cached( size_t max_cached )
+        {
+            std::lock_guard<std::mutex> lock( _mutex );
+            _max_cached = max_cached;
+            evict();
+        }
+
+        void flush()
+        { try {
+            std::lock_guard<std::mutex> lock( _mutex );
+            typename level_map<Key, Value>::write_batch batch = _db.create_batch( _sync_on_write );
+            for( const auto& item : _dirty )
+            {
+                if( item.second.valid() )
+                    batch.store( item.first, *item.second );
+                else
+                    batch.remove( item.first );
+            }
+            batch.commit();
+            _dirty.clear();
+        } FC_CAPTURE_AND_RETHROW() }
+
+        fc::optional<Value> fetch_optional( const Key& key )const
+        { try {
+            std::lock_guard<std::mutex> lock( _mutex );
+            const auto dirty_itr = _dirty.find( key );
+            if( dirty_itr != _dirty.end() )
+                return dirty_itr->second;
+
+            const auto itr = _cache.find( key );
+            if( itr != _cache.end() )
+            {
+                _lru.splice( _lru.begin(), _lru, itr->second.second );
+                return itr->second.first;
+            }
+
+            const fc::optional<Value> value = _db.fetch_optional( key );
+            if( value.valid() )
+                cache( key, *value );
+            return value;
+        } FC_CAPTURE_AND_RETHROW( (key) ) }
+
+        void store( const Key& key, const Value& value )
+        { try {
+            std::lock_guard<std::mutex> lock( _mutex );
+            cache( key, value );
+            if( _write_through )
+                _db.store( key, value, _sync_on_write );
+            else
+                _dirty[ key ] = value;
+        } FC_CAPTURE_AND_RETHROW( (key)(value) ) }
+
+        void remove( const Key& key )
+        { try {
+            std::lock_guard<std::mutex> lock( _mutex );
+            const auto itr = _cache.find( key );
+            if( itr != _cache.end() )
+            {
+                _lru.erase( itr->second.second );
+                _cache.erase( itr );
+            }
+            if( _write_through )
+                _db.remove( key, _sync_on_write );
+            else
+                _dirty[ key ] = fc::optional<Value>();
+        } FC_CAPTURE_AND_RETHROW( (key) ) }
+
+        /**
+         *  Calls callback( key, value ) for each record with lower <= key <= upper, in key order,
+         *  until it returns false.
+         */
+        template<typename Callback>
+        void scan( const Key& lower, const Key& upper, const Callback& callback )const
+        { try {
+            std::lock_guard<std::mutex> lock( _mutex );
+            auto itr = _db.lower_bound( lower );
+            auto dirty_itr = _dirty.lower_bound( lower );
+            while( true )
+            {
+                fc::optional<Key> db_key;
+                if( itr.valid() )
+                {
+                    db_key = itr.key();
+                    if( upper < *db_key ) db_key.reset();
+                }
+                const bool dirty_valid = dirty_itr != _dirty.end() && !( upper < dirty_itr->first );
+                if( !db_key.valid() && !dirty_valid )
+                    break;
+
+                if( dirty_valid && ( !db_key.valid() || !( *db_key < dirty_itr->first ) ) )
+                {
+                    // an unflushed write replaces what leveldb has for the key
+                    if( db_key.valid() && *db_key == dirty_itr->first ) ++itr;
+                    if( dirty_itr->second.valid() && !callback( dirty_itr->first, *dirty_itr->second ) )
+                        return;
+                    ++dirty_itr;
+                }
+                else
+                {
+                    if( !callback( *db_key, itr.value() ) )
+                        return;
+                    ++itr;
+                }
+            }
+        } FC_CAPTURE_AND_RETHROW( (lower)(upper) ) }
+
+        size_t cached_size()const
+        {
+            std::lock_guard<std::mutex> lock( _mutex );
+            return _cache.size();
+        }
+
+        void export_to_json( const fc::path& path )const
+        { try {
+            _db.export_to_json( path );
+        } FC_CAPTURE_AND_RETHROW( (path) ) }
+
+      private:
+        typedef std::list<Key>    lru_list;
+
+        void cache( const Key& key, const Value& value )const
+        {
+            const auto itr = _cache.find( key );
+            if( itr != _cache.end() )
+            {
+                itr->second.first = value;
+                _lru.splice( _lru.begin(), _lru, itr->second.second );
+                return;
+            }
+            _lru.push_front( key );
+            _cache.emplace( key, std::make_pair( value, _lru.begin() ) );
+            evict();
+        }
+
+        void evict()const
+        {
+            while( _cache.size() > _max_cached && !_lru.empty() )
+            {
+                _cache.erase( _lru.back() );
+                _lru.pop_back();
+            }
+        }
+
+        mutable level_map<Key, Value>                                             _db;
+        mutable std::mutex                                                        _mutex;
+        mutable std::map<Key, std::pair<Value, typename lru_list::iterator>>      _cache;
+        mutable lru_list                                                          _lru;
+        std::map<Key, fc::optional<Value>>                                        _dirty;
+        size_t                                                                    _max_cached = 1024 * 64;
+        bool                                                                      _write_through = true;
+        bool                                                                      _sync_on_write = false;
+   };
+
+} } // bts::db
@@ -1,4 +1,7 @@
+#include <bts/blockchain/config.hpp>
+#include <bts/blockchain/fork_blocks.hpp>
 #include <bts/blockchain/operation_factory.hpp>
+#include <bts/blockchain/pending_chain_state.hpp>
 
 #include <bts/game/rule_record.hpp>
 #include <bts/game/game_operations.hpp>
@@ -17,6 +20,18 @@
 
 #include <iostream>
 #include <fstream>
+#include <mutex>
+
+// heap limits of each game's isolate, in MB
+#define BTS_GAME_ISOLATE_MAX_SEMI_SPACE_SIZE   8
+#define BTS_GAME_ISOLATE_MAX_OLD_SPACE_SIZE    60
+#define BTS_GAME_ISOLATE_MAX_EXECUTABLE_SIZE   60
+
+// blocks whose game execution profiles are kept
+#define BTS_GAME_PROFILED_BLOCKS               200
+
+// how much of the stack of a chain worker's fiber, 2 MB in fc, V8 may use for an isolated game
+#define BTS_GAME_EXECUTE_V8_STACK_SIZE         (1024 * 1024)
 
 namespace bts { namespace game {
    using namespace bts::blockchain;
@@ -28,6 +43,14 @@ namespace bts { namespace game {
     client* client::current = nullptr;
    
    namespace detail {
+       /** one isolated game's execute for a block, against a state of its own */
+       struct game_execution
+       {
+           game_id_type                game_id;
+           v8_game_engine_ptr          engine;
+           pending_chain_state_ptr     state;
+       };
+       
        class ArrayBufferAllocator : public v8::ArrayBuffer::Allocator {
        public:
            virtual void* Allocate(size_t length) {
@@ -46,13 +69,10 @@ namespace bts { namespace game {
          
          v8::Platform*           _platform;
           
-          // For each game we should create a different isolate instance,
-          // and do exit/dispose operation for each of them
-          //
-          // Here I just fixed the process hang issue.
-          v8::Isolate* _isolate;
+          ArrayBufferAllocator*  _allocator = nullptr;
           
-          ArrayBufferAllocator*  _allocator;
+          // every game engine has an isolate of its own, all created with this stack limit
+          uint32_t*              _stack_limit = nullptr;
           
           exlib::Service*        _service;
          
@@ -60,25 +80,19 @@ namespace bts { namespace game {
           
          std::unordered_map<std::string, v8_game_engine_ptr > _engines;
          
+         // games are executed on several threads, and profiles read from RPC threads
+         mutable std::mutex      _profiles_mutex;
+         std::map<uint32_t, std::map<game_id_type, game_execution_profile>> _profiles;
+         
          boost::signals2::scoped_connection   _http_callback_signal_connection;
          
          client_impl(client* self)
          : self(self)
          {}
          ~client_impl(){
-             // explicitly release enginer obj here
-             // before we release isolate things.
-             
-             for(auto itr=_engines.begin(); itr!=_engines.end(); itr++)
-             //for(auto e: _engines) not work???
-             {
- 
-                 //int count = itr->second.use_count();
-                 itr->second.reset();
-             }
-             
-             _isolate->Exit();
-             _isolate->Dispose();
+             // explicitly release the engines, and with them their isolates,
+             // before we release the platform things.
+             _engines.clear();
              
              v8::V8::Dispose();
              v8::V8::ShutdownPlatform();
@@ -106,46 +120,15 @@ namespace bts { namespace game {
                v8::V8::Initialize();
                 
                
-               _isolate = v8::Isolate::GetCurrent();
-               if ( _isolate == NULL )
-               {
-                   /*
-                   ResourceConstraints rc;
-                   rc.set_max_old_space_size(10); //MB
-                   rc.set_max_executable_size(10); //MB
-                   
-                   params.constraints.set_stack_limit(reinterpret_cast<uint32_t*>((char*)&rc - 1024 * 512));
-                   https://github.com/v8/v8/blob/master/test/cctest/test-api.cc#L18724
-                    */
-                   _service = exlib::Service::current();
-                   _allocator = new ArrayBufferAllocator();
-                   Isolate::CreateParams create_params;
-                   create_params.array_buffer_allocator = _allocator;
-                   
-                   ResourceConstraints rc;
-                   rc.set_max_semi_space_size(40);
-                   rc.set_max_old_space_size(60); //MB
-                   rc.set_max_executable_size(60); //MB
-                   static const int stack_breathing_room = 1024 * 1024;
-//uint32_t* set_limit = ComputeStackLimit(stack_breathing_room);
-                   rc.set_stack_limit(reinterpret_cast<uint32_t*>((char*)&rc - stack_breathing_room));
-                   
-                   create_params.constraints = rc;
-                   
-                   _isolate = v8::Isolate::New(create_params);
-                   
-                   
-                   
-                   //_isolate->SetStackLimit(reinterpret_cast<uintptr_t>(set_limit));
-                   _isolate->Enter();
-               }
+               _service = exlib::Service::current();
+               _allocator = new ArrayBufferAllocator();
+               
+               static const int stack_breathing_room = 1024 * 1024;
+               uint32_t stack_position;
+               _stack_limit = reinterpret_cast<uint32_t*>((char*)&stack_position - stack_breathing_room);
                 
                v8::V8::SetCaptureStackTraceForUncaughtExceptions(true, 10, StackTrace::kDetailed);
-               
-               ilog("Init class templat for game client" );
-               
-               v8_api::init_class_template( _isolate );
-
+               v8::V8::SetAllowCodeGenerationFromStringsCallback( &v8_api::allow_code_generation );
                
                // TODO: each rule instance is supposed to have their own context
                // TODO: To check whether the wallet and blockchain object are the same with the ones that should be used in script.
@@ -168,6 +151,92 @@ namespace bts { namespace game {
             }
          }
           
+          /**
+           * Each game gets its own heap, so one game's garbage collection
+           * does not stall the others
+           */
+          v8::Isolate* create_isolate()
+          {
+              /*
+               https://github.com/v8/v8/blob/master/test/cctest/test-api.cc#L18724
+               */
+              Isolate::CreateParams create_params;
+              create_params.array_buffer_allocator = _allocator;
+              
+              ResourceConstraints rc;
+              rc.set_max_semi_space_size(BTS_GAME_ISOLATE_MAX_SEMI_SPACE_SIZE);
+              rc.set_max_old_space_size(BTS_GAME_ISOLATE_MAX_OLD_SPACE_SIZE); //MB
+              rc.set_max_executable_size(BTS_GAME_ISOLATE_MAX_EXECUTABLE_SIZE); //MB
+              rc.set_stack_limit(_stack_limit);
+              
+              create_params.constraints = rc;
+              
+              v8::Isolate* isolate = v8::Isolate::New(create_params);
+              {
+                  v8::Locker locker(isolate);
+                  Isolate::Scope isolate_scope(isolate);
+                  v8_api::init_class_template( isolate );
+              }
+              return isolate;
+          }
+          
+          void dispose_isolate(v8::Isolate* isolate)
+          {
+              {
+                  v8::Locker locker(isolate);
+                  Isolate::Scope isolate_scope(isolate);
+                  v8_api::release_class_template( isolate );
+              }
+              isolate->Dispose();
+          }
+          
+          /**
+           * Runs isolated games that follow one another in game order, each on a child state of
+           * pending_state, on the chain's worker threads, and merges them back in that order. None of
+           * them touches another's records, so this gives what running them one after another would.
+           * The chain thread only blocks on them; it must not yield while a block is being pushed.
+           */
+          void execute_isolated( std::vector<game_execution>& executions, const chain_database_ptr& blockchain,
+                                 uint32_t block_num, const pending_chain_state_ptr& pending_state )
+          {
+              if( executions.empty() )
+                  return;
+              if( executions.size() == 1 )
+              {
+                  executions.front().engine->execute( executions.front().game_id, blockchain, block_num, pending_state, true );
+                  executions.clear();
+                  return;
+              }
+              
+              blockchain->run_on_worker_threads( executions.size(), [&]( const size_t index )
+              {
+                  // the limit is an address on the stack of the fiber the game runs in, so it is taken for each game
+                  char stack_position;
+                  const uintptr_t stack_limit = reinterpret_cast<uintptr_t>( &stack_position ) - BTS_GAME_EXECUTE_V8_STACK_SIZE;
+                  
+                  game_execution& execution = executions[index];
+                  execution.state = std::make_shared<pending_chain_state>( pending_state );
+                  execution.engine->execute( execution.game_id, blockchain, block_num, execution.state, true, stack_limit );
+              } );
+              
+              // the script's own errors are recorded in the game status; anything else has failed the block by now
+              for( const auto& execution : executions )
+                  merge_game_state( *execution.state, pending_state );
+              executions.clear();
+          }
+          
+          /** An isolated game only changes its data, status, assets and their balances */
+          void merge_game_state( const pending_chain_state& game_state, const pending_chain_state_ptr& pending_state )
+          {
+              for( const auto& item : game_state._asset_id_to_record )   pending_state->store_asset_record( item.second );
+              for( const auto& item : game_state._balance_id_to_record ) pending_state->store_balance_record( item.second );
+              for( const auto& item : game_state.game_datas )            pending_state->store_game_data_record( item.first.first, item.first.second, item.second );
+              for( const auto& item : game_state.game_statuses )         pending_state->store_game_status( item.second );
+              
+              pending_state->game_result_transactions.insert( pending_state->game_result_transactions.end(),
+                                                              game_state.game_result_transactions.begin(), game_state.game_result_transactions.end() );
+          }
+          
           void   install_game_engine(const std::string& game_name, v8_game_engine_ptr engine_ptr )
           {
               FC_ASSERT( _engines.find( game_name ) == _engines.end(),
@@ -250,11 +319,23 @@ namespace bts { namespace game {
         wlog("Start executing in game client at block ${b}", ("b", block_num));
         auto games = blockchain->get_games("", -1);
         
+        // Games run in game order, every game once. Since the fork, games declaring PLAY.isolated are held to
+        // their own records, so isolated games next to each other run side by side; the others run alone.
+        std::vector<detail::game_execution> isolated_executions;
         for ( const auto& g : games)
         {
             try {
                 auto v8_game_engine = get_v8_engine( g.name );
-                wlog("Start execute the game ${g}", ("g", g.name));
+                if( block_num >= BTS_V0_GAME_ISOLATION_FORK_BLOCK_NUM && v8_game_engine->declares_isolated() )
+                {
+                    detail::game_execution execution;
+                    execution.game_id = g.id;
+                    execution.engine = v8_game_engine;
+                    isolated_executions.push_back( std::move( execution ) );
+                    continue;
+                }
+                
+                my->execute_isolated( isolated_executions, blockchain, block_num, pending_state );
                 v8_game_engine->execute( g.id, blockchain, block_num, pending_state );
             }
             catch (const game_engine_not_found& e)
@@ -262,6 +343,7 @@ namespace bts { namespace game {
                 wlog("game engine note found, failed to init for unknown reason during chain execution");
             }
         }
+        my->execute_isolated( isolated_executions, blockchain, block_num, pending_state );
     } FC_CAPTURE_AND_RETHROW( (block_num) ) }
     
     chain_database_ptr client::get_chain_database()
@@ -300,9 +382,68 @@ namespace bts { namespace game {
       
    }
     
-    void* client::get_isolate(/*const std::string& game_name*/)
+    void* client::create_isolate()
+    {
+        return my->create_isolate();
+    }
+    
+    void client::dispose_isolate(void* isolate)
+    {
+        my->dispose_isolate( (v8::Isolate*)isolate );
+    }
+    
+    uintptr_t client::get_stack_limit()const
+    {
+        return reinterpret_cast<uintptr_t>( my->_stack_limit );
+    }
+    
+    fc::path client::get_code_cache_dir()const
     {
-        return my->_isolate;
+        return my->_data_dir / "code_cache";
+    }
+    
+    void client::record_script_call( const game_script_call& call )
+    {
+        std::lock_guard<std::mutex> lock( my->_profiles_mutex );
+        
+        game_execution_profile& profile = my->_profiles[call.block_num][call.game_id];
+        profile.game_id = call.game_id;
+        profile.game_name = call.game_name;
+        profile.block_num = call.block_num;
+        if( call.type == game_script_call::execute_call )
+        {
+            ++profile.execute_count;
+            profile.execute_us += call.duration.count();
+        }
+        else
+        {
+            ++profile.evaluate_count;
+            profile.evaluate_us += call.duration.count();
+        }
+        profile.max_budget_used = std::max( profile.max_budget_used, call.budget_used );
+        profile.max_steps = std::max( profile.max_steps, call.steps );
+        if( call.budget_exceeded )
+            ++profile.budget_exceeded;
+        profile.used_heap_size = call.used_heap_size;
+        profile.total_heap_size = call.total_heap_size;
+        
+        while( my->_profiles.size() > BTS_GAME_PROFILED_BLOCKS )
+            my->_profiles.erase( my->_profiles.begin() );
+    }
+    
+    std::vector<game_execution_profile> client::get_execution_profiles( uint32_t block_num )const
+    {
+        std::lock_guard<std::mutex> lock( my->_profiles_mutex );
+        
+        std::vector<game_execution_profile> profiles;
+        for( const auto& block : my->_profiles )
+        {
+            if( block_num != 0 && block.first != block_num )
+                continue;
+            for( const auto& item : block.second )
+                profiles.push_back( item.second );
+        }
+        return profiles;
     }
     
     
@@ -21,6 +21,29 @@ namespace bts { namespace game {
    struct create_game_operation;
    namespace detail { class client_impl; }
     
+   /**
+    * One call into a game's script, as measured by its engine
+    */
+   struct game_script_call
+   {
+       enum call_type
+       {
+           execute_call,
+           evaluate_call
+       };
+       
+       call_type           type = execute_call;
+       game_id_type        game_id = 0;
+       std::string         game_name;
+       uint32_t            block_num = 0;
+       fc::microseconds    duration;
+       uint64_t            budget_used = 0;
+       uint64_t            steps = 0;
+       bool                budget_exceeded = false;
+       uint64_t            used_heap_size = 0;
+       uint64_t            total_heap_size = 0;
+   };
+    
    class client : public game_interface
    {
    public:
@@ -42,7 +65,25 @@ namespace bts { namespace game {
        void execute( chain_database_ptr blockchain, uint32_t block_num, const pending_chain_state_ptr& pending_state );
       
        
-       void* get_isolate(/*const std::string& game_name*/);
+       /**
+        * A new v8::Isolate with the per game heap limits and class templates,
+        * to be released with dispose_isolate
+        */
+       void* create_isolate();
+       
+       void  dispose_isolate(void* isolate);
+       
+       /** The V8 stack limit game isolates are created with, for the thread the client was opened on */
+       uintptr_t get_stack_limit()const;
+       
+       /** compiled game scripts, by script hash */
+       fc::path get_code_cache_dir()const;
+       
+       /** Adds the call to the profile of its game in its block; may be called from any thread */
+       void record_script_call( const game_script_call& call );
+       
+       /** The profiles of the given block, or of every block still kept when block_num is 0 */
+       std::vector<game_execution_profile> get_execution_profiles( uint32_t block_num )const;
        
        static client& get_current();
        
@@ -22,14 +22,80 @@ namespace bts { namespace game {
    using namespace bts::blockchain;
    using namespace bts::wallet;
    
+   /**
+    * The class templates of one isolate; every game runs in its own isolate
+    */
+   struct v8_class_templates
+   {
+      Persistent<FunctionTemplate> blockchain_templ;
+      
+      Persistent<FunctionTemplate> wallet_templ;
+      
+      Persistent<FunctionTemplate> pendingstate_templ;
+      
+      Persistent<FunctionTemplate> eval_state_templ;
+   };
+   
+   /**
+    * What one call into a script may ask of the chain. Each call the script makes back
+    * through the API, and each record it hands back, costs a unit. Plain javascript is
+    * counted in steps, one for each loop iteration and function call v8_helper::meter_steps
+    * instrumented; time is never counted, so every node stops a script at the same point.
+    */
+   struct v8_call_budget
+   {
+      v8_call_budget( uint64_t limit, uint64_t step_limit ):limit(limit),step_limit(step_limit){}
+      
+      bool charge( uint64_t units ) { used += units; return used <= limit; }
+      bool step()                   { return ++steps <= step_limit; }
+      bool exceeded()const          { return used > limit || steps > step_limit; }
+      
+      uint64_t limit;
+      uint64_t used = 0;
+      uint64_t step_limit;
+      uint64_t steps = 0;
+   };
+   
    class v8_api
    {
    public:
       /**
-       * init the javascript classes
+       * init the javascript classes of the isolate, kept in its data slot
        */
       static bool init_class_template(v8::Isolate* isolate);
       
+      /**
+       * release the class templates, before the isolate is disposed
+       */
+      static void release_class_template(v8::Isolate* isolate);
+      
+      static v8_class_templates& class_templates(v8::Isolate* isolate);
+      
+      /**
+       * the budget of the call into a script in progress on the isolate, nullptr when there is none
+       */
+      static void set_call_budget(v8::Isolate* isolate, v8_call_budget* budget);
+      
+      /**
+       * false when the call in progress has run out of budget, after throwing an exception into the script
+       */
+      static bool charge_call_budget(v8::Isolate* isolate, uint64_t units = 1);
+      
+      /**
+       * false when an isolated game reached for another game's records, after throwing an exception into the script
+       */
+      static bool check_isolation(v8::Isolate* isolate, bool allowed);
+      
+      /**
+       * the global a metered script calls on every step, it throws once the call in progress is out of steps
+       */
+      static void V8_Global_Step(const v8::FunctionCallbackInfo<Value>& args);
+      
+      /**
+       * eval and new Function would run code meter_steps never saw, so they are refused in calls held to their budget
+       */
+      static bool allow_code_generation(Local<Context> context);
+      
       /**
        * @brief Global method for create balance id for the owner of balance
        *
@@ -41,16 +107,6 @@ namespace bts { namespace game {
        *
        */
       static void V8_Block_Get_Transactions(const v8::FunctionCallbackInfo<Value>& args);
-      
-      static Persistent<ObjectTemplate> global;
-      
-      static Persistent<FunctionTemplate> blockchain_templ;
-       
-      static Persistent<FunctionTemplate> wallet_templ;
-      
-      static Persistent<FunctionTemplate> pendingstate_templ;
-      
-      static Persistent<FunctionTemplate> eval_state_templ;
    };
    
     /**
@@ -76,6 +132,8 @@ namespace bts { namespace game {
         
         static void Get_Game_Data_Record(const v8::FunctionCallbackInfo<Value>& args);
         
+        static void Scan_Game_Data_Records(const v8::FunctionCallbackInfo<Value>& args);
+        
         static void Get_Account_Record_By_Name(const v8::FunctionCallbackInfo<Value>& args);
         
         /*
@@ -116,10 +174,47 @@ namespace bts { namespace game {
     class v8_chainstate
     {
     public:
-        v8_chainstate(chain_interface_ptr chain_state): _chain_state(chain_state){}
+        v8_chainstate(chain_interface_ptr chain_state, game_id_type game_id = 0, bool isolated = false)
+        : _chain_state(chain_state), _game_id(game_id), _isolated(isolated){}
         
         chain_interface_ptr _chain_state;
         
+        /**
+         * The game whose script uses this state. An isolated game, which may run beside
+         * other isolated games, only touches its own records: its game data, the assets
+         * it issued and their balances. It may still read other assets and balances,
+         * as long as no other game issued them.
+         */
+        game_id_type        _game_id;
+        bool                _isolated;
+        
+        bool owns_asset( const asset_record& asset_rec )const
+        {
+            return asset_rec.is_game_issued() && asset_rec.issuer.issuer_id == _game_id;
+        }
+        bool may_access_game_data( game_id_type game_id )const
+        {
+            return !_isolated || game_id == _game_id;
+        }
+        bool may_read_asset( const oasset_record& asset_rec )const
+        {
+            return !_isolated || !asset_rec.valid() || !asset_rec->is_game_issued() || owns_asset( *asset_rec );
+        }
+        bool may_write_asset( const asset_record& asset_rec )const
+        {
+            return !_isolated || ( owns_asset( asset_rec ) && may_read_asset( _chain_state->get_asset_record( asset_rec.id ) ) );
+        }
+        bool may_read_balance( const obalance_record& balance_rec )const
+        {
+            return !_isolated || !balance_rec.valid() || may_read_asset( _chain_state->get_asset_record( balance_rec->asset_id() ) );
+        }
+        bool may_write_balance( const balance_record& balance_rec )const
+        {
+            if( !_isolated ) return true;
+            const oasset_record asset_rec = _chain_state->get_asset_record( balance_rec.asset_id() );
+            return asset_rec.valid() && owns_asset( *asset_rec );
+        }
+        
         static Local<Object> New(v8::Isolate* isolate, v8_chainstate* v8_pendingstate);
         
         static void Get_Blance_Record(const v8::FunctionCallbackInfo<Value>& args);
@@ -128,6 +223,10 @@ namespace bts { namespace game {
         
         static void Get_Game_Data_Record(const v8::FunctionCallbackInfo<Value>& args);
         
+        static void Get_Game_Data_Records(const v8::FunctionCallbackInfo<Value>& args);
+        
+        static void Scan_Game_Data_Records(const v8::FunctionCallbackInfo<Value>& args);
+        
         static void Get_Account_Record_By_Name(const v8::FunctionCallbackInfo<Value>& args);
         
         static void Store_Blance_Record(const v8::FunctionCallbackInfo<Value>& args);
@@ -135,6 +234,8 @@ namespace bts { namespace game {
         static void Store_Asset_Record(const v8::FunctionCallbackInfo<Value>& args);
         
         static void Store_Game_Data_Record(const v8::FunctionCallbackInfo<Value>& args);
+        
+        static void Store_Game_Data_Records(const v8::FunctionCallbackInfo<Value>& args);
     };
     
     /**
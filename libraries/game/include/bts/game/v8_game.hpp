@@ -49,10 +49,31 @@ namespace bts { namespace game {
                                const time_point_sec& block_time,
                                const uint32_t trx_index, bts::wallet::wallet_ptr w);
       
+      /**
+       * Scans a block's results of this game in one call of PLAY.scan_results( results, trx_indexes,
+       * block_num, block_time, wallet ), where trx_indexes is a Uint32Array of each result's index in
+       * the block. Scripts without it have PLAY.scan_result called for each result, still entering the
+       * isolate once.
+       */
+      void scan_results( const vector<game_result_transaction>& rtrxs,
+                         const vector<uint32_t>& trx_indexes,
+                         uint32_t block_num,
+                         const time_point_sec& block_time, bts::wallet::wallet_ptr w);
+      
       /**
        * wrapper to call the javascript stub defined by game developers
+       *
+       * @param isolated when the script may only touch the game's own records, see v8_chainstate
+       * @param stack_limit for V8 on the calling thread, when it is not the thread the client was opened on; 0 for that thread
+       */
+      void execute( game_id_type game_id, chain_database_ptr blockchain, uint32_t block_num, const pending_chain_state_ptr& pending_state,
+                    bool isolated = false, uintptr_t stack_limit = 0 );
+      
+      /**
+       * true when the script set PLAY.isolated when it was loaded, declaring that PLAY.execute keeps to
+       * the game's own records, so it can run beside other such games
        */
-      void execute( game_id_type game_id, chain_database_ptr blockchain, uint32_t block_num, const pending_chain_state_ptr& pending_state );
+      bool declares_isolated()const;
    private:
       std::shared_ptr<detail::v8_game_engine_impl> my;
    };
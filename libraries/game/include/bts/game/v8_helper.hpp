@@ -23,27 +23,50 @@ namespace bts { namespace game {
        
        static void public_key_to_address(const v8::FunctionCallbackInfo<v8::Value>& args );
        
+       /**
+        * Builds the V8 value directly from the fc::variant of v, without going through JSON text
+        */
        template<typename T>
        static Handle<Value> cpp_to_json(Isolate* isolate, const T& v )
        {
            EscapableHandleScope handle_scope(isolate);
-           auto json_str = fc::json::to_string(v);
-           
-           return handle_scope.Escape( parseJson( isolate, String::NewFromUtf8(isolate, json_str.c_str() )) );
+           return handle_scope.Escape( variant_to_v8( isolate, fc::variant( v ) ) );
        }
        
        template<typename T>
        static T json_to_cpp(Isolate* isolate, Handle<Value> object )
        {
-           EscapableHandleScope handle_scope(isolate);
-           Local<String> v8_string = toJson( isolate, object );
-           std::string str = *v8::String::Utf8Value(v8_string);
-           
-           auto v = fc::json::from_string( str );
-           
-           return v.as<T>();
+           HandleScope handle_scope(isolate);
+           return v8_to_variant( isolate, object ).as<T>();
        }
        
+       /**
+        * Builds the V8 value JSON.parse would give for fc::json::to_string of v
+        */
+       static Local<Value> variant_to_v8(Isolate* isolate, const fc::variant& v );
+       
+       /**
+        * Reads a V8 value into the variant fc::json::from_string would give for
+        * JSON.stringify of it
+        */
+       static fc::variant v8_to_variant(Isolate* isolate, Handle<Value> value );
+       
+       /**
+        * The name of the global meter_steps calls, which game scripts may not use themselves
+        */
+       static const char* const step_function_name;
+       
+       /**
+        * Rewrites a game script so that every loop iteration and every function call first calls
+        * step_function_name, which counts a step against the budget of the call in progress.
+        * Loop conditions become step() && (condition), function bodies start with step();
+        * the rest of the script is left as it was. Scripts are ES5: arrow functions are not metered.
+        *
+        * Throws when the script uses step_function_name or `with`, either of which could stand
+        * a function of the script's own in for the step.
+        */
+       static std::string meter_steps( const std::string& source );
+       
       // Creates a new execution environment containing the built-in
       // functions.
       static v8::Handle<v8::Context> CreateShellContext(v8::Isolate* isolate);
@@ -1,15 +1,39 @@
 #include <bts/game/v8_api.hpp>
 
+#include <limits>
+
 namespace bts { namespace game {
-   Persistent<ObjectTemplate> v8_api::global;
-   
-   Persistent<FunctionTemplate> v8_api::blockchain_templ;
-    
-   Persistent<FunctionTemplate> v8_api::wallet_templ;
+   // isolate data slot holding the v8_class_templates
+   static const uint32_t class_templates_slot = 0;
+   // and the v8_call_budget of the call in progress
+   static const uint32_t call_budget_slot = 1;
    
-   Persistent<FunctionTemplate> v8_api::pendingstate_templ;
+   /**
+    * The most records a scan needs to read: what the script asked for, or all of them, but no more
+    * than one past what the call has budget left to pay for. A scan finding more records than the
+    * budget covers then fails charging for them, as any other call would, instead of being cut short.
+    */
+   static uint32_t scan_limit( Isolate* isolate, Local<Value> requested )
+   {
+      uint64_t limit = requested->IsUndefined() ? uint32_t( -1 ) : requested->Uint32Value();
+      auto budget = static_cast<v8_call_budget*>( isolate->GetData( call_budget_slot ) );
+      if ( budget != nullptr )
+      {
+         const uint64_t remaining = budget->limit > budget->used ? budget->limit - budget->used : 0;
+         if ( remaining < limit )
+            limit = remaining + 1;
+      }
+      return uint32_t( limit );
+   }
    
-   Persistent<FunctionTemplate> v8_api::eval_state_templ;
+   static Local<Value> game_data_records_to_v8( Isolate* isolate, const map<data_id_type, game_data_record>& records )
+   {
+      vector<game_data_record> result;
+      result.reserve( records.size() );
+      for ( const auto& item : records )
+         result.push_back( item.second );
+      return v8_helper::cpp_to_json( isolate, result );
+   }
    
    Handle<FunctionTemplate> MakeBlockChainTemplate( Isolate* isolate) {
       EscapableHandleScope handle_scope(isolate);
@@ -36,6 +60,8 @@ namespace bts { namespace game {
        
        proto->Set(isolate, "get_game_data_record", FunctionTemplate::New(isolate, v8_blockchain::Get_Game_Data_Record));
        
+       proto->Set(isolate, "scan_game_data_records", FunctionTemplate::New(isolate, v8_blockchain::Scan_Game_Data_Records));
+       
        proto->Set(isolate, "get_account_record_by_name", FunctionTemplate::New(isolate, v8_blockchain::Get_Account_Record_By_Name));
       
       //access the instance pointer of our new class template
@@ -88,11 +114,14 @@ namespace bts { namespace game {
       pendingstate_proto->Set(isolate, "get_balance_record", FunctionTemplate::New(isolate, v8_chainstate::Get_Blance_Record));
       pendingstate_proto->Set(isolate, "get_asset_record", FunctionTemplate::New(isolate, v8_chainstate::Get_Asset_Record));
       pendingstate_proto->Set(isolate, "get_game_data_record", FunctionTemplate::New(isolate, v8_chainstate::Get_Game_Data_Record));
+      pendingstate_proto->Set(isolate, "get_game_data_records", FunctionTemplate::New(isolate, v8_chainstate::Get_Game_Data_Records));
+      pendingstate_proto->Set(isolate, "scan_game_data_records", FunctionTemplate::New(isolate, v8_chainstate::Scan_Game_Data_Records));
       pendingstate_proto->Set(isolate, "get_account_record_by_name", FunctionTemplate::New(isolate, v8_chainstate::Get_Account_Record_By_Name));
       
       pendingstate_proto->Set(isolate, "set_balance_record", FunctionTemplate::New(isolate, v8_chainstate::Store_Blance_Record));
       pendingstate_proto->Set(isolate, "set_asset_record", FunctionTemplate::New(isolate, v8_chainstate::Store_Asset_Record));
       pendingstate_proto->Set(isolate, "set_game_data_record", FunctionTemplate::New(isolate, v8_chainstate::Store_Game_Data_Record));
+      pendingstate_proto->Set(isolate, "set_game_data_records", FunctionTemplate::New(isolate, v8_chainstate::Store_Game_Data_Records));
       
        
        //access the instance pointer of our new class template
@@ -133,6 +162,15 @@ namespace bts { namespace game {
    bool v8_api::init_class_template(v8::Isolate* isolate)
    {
       HandleScope handle_scope(isolate);
+      if ( isolate->GetData( class_templates_slot ) == nullptr )
+         isolate->SetData( class_templates_slot, new v8_class_templates() );
+      
+      v8_class_templates& templates = class_templates( isolate );
+      Persistent<FunctionTemplate>& blockchain_templ = templates.blockchain_templ;
+      Persistent<FunctionTemplate>& wallet_templ = templates.wallet_templ;
+      Persistent<FunctionTemplate>& pendingstate_templ = templates.pendingstate_templ;
+      Persistent<FunctionTemplate>& eval_state_templ = templates.eval_state_templ;
+      
       if ( blockchain_templ.IsEmpty() )
       {
          Handle<FunctionTemplate> raw_template = MakeBlockChainTemplate(isolate);
@@ -160,6 +198,71 @@ namespace bts { namespace game {
       return true;
    }
    
+   void v8_api::release_class_template(v8::Isolate* isolate)
+   {
+      auto templates = static_cast<v8_class_templates*>( isolate->GetData( class_templates_slot ) );
+      if ( templates == nullptr )
+         return;
+      
+      templates->blockchain_templ.Reset();
+      templates->wallet_templ.Reset();
+      templates->pendingstate_templ.Reset();
+      templates->eval_state_templ.Reset();
+      isolate->SetData( class_templates_slot, nullptr );
+      delete templates;
+   }
+   
+   v8_class_templates& v8_api::class_templates(v8::Isolate* isolate)
+   {
+      auto templates = static_cast<v8_class_templates*>( isolate->GetData( class_templates_slot ) );
+      FC_ASSERT( templates != nullptr, "class templates are not initialized for this isolate" );
+      return *templates;
+   }
+   
+   void v8_api::set_call_budget(v8::Isolate* isolate, v8_call_budget* budget)
+   {
+      isolate->SetData( call_budget_slot, budget );
+   }
+   
+   bool v8_api::charge_call_budget(v8::Isolate* isolate, uint64_t units)
+   {
+      auto budget = static_cast<v8_call_budget*>( isolate->GetData( call_budget_slot ) );
+      if ( budget == nullptr || budget->charge( units ) )
+         return true;
+      
+      isolate->ThrowException( v8::Exception::RangeError( String::NewFromUtf8( isolate, "Game script execution budget exceeded" ) ) );
+      return false;
+   }
+   
+   void v8_api::V8_Global_Step(const v8::FunctionCallbackInfo<Value>& args)
+   {
+      auto isolate = args.GetIsolate();
+      auto budget = static_cast<v8_call_budget*>( isolate->GetData( call_budget_slot ) );
+      if ( budget == nullptr || budget->step() )
+      {
+         // the step is and-ed into loop conditions
+         args.GetReturnValue().Set( true );
+         return;
+      }
+      
+      isolate->ThrowException( v8::Exception::RangeError( String::NewFromUtf8( isolate, "Game script execution budget exceeded" ) ) );
+   }
+   
+   bool v8_api::allow_code_generation(Local<Context> context)
+   {
+      auto budget = static_cast<v8_call_budget*>( context->GetIsolate()->GetData( call_budget_slot ) );
+      return budget == nullptr || budget->step_limit == std::numeric_limits<uint64_t>::max();
+   }
+   
+   bool v8_api::check_isolation(v8::Isolate* isolate, bool allowed)
+   {
+      if ( allowed )
+         return true;
+      
+      isolate->ThrowException( v8::Exception::Error( String::NewFromUtf8( isolate, "An isolated game may only touch its own records" ) ) );
+      return false;
+   }
+   
    /**
     * @brief Global method for create balance id for the owner of balance
     *
@@ -167,6 +270,7 @@ namespace bts { namespace game {
    void v8_api::V8_Global_Get_Balance_ID_For_Owner(const v8::FunctionCallbackInfo<Value>& args)
    {
        EscapableHandleScope handle_scope(args.GetIsolate());
+       if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
        
       auto owner = * static_cast<address*> (Local<External>::Cast(args[0])->Value());
       
@@ -182,7 +286,7 @@ namespace bts { namespace game {
       EscapableHandleScope handle_scope(isolate);
 
       //get class template
-      Handle<FunctionTemplate> templ = Local<FunctionTemplate>::New(isolate, v8_api::blockchain_templ);
+      Handle<FunctionTemplate> templ = Local<FunctionTemplate>::New(isolate, v8_api::class_templates(isolate).blockchain_templ);
       Handle<Function> blockchain_ctor = templ->GetFunction();
       
       //get class instance
@@ -222,6 +326,7 @@ namespace bts { namespace game {
     void v8_blockchain::Get_Block_Digest(const v8::FunctionCallbackInfo<Value>& args)
     {
         EscapableHandleScope handle_scope(args.GetIsolate());
+        if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
         Local<Object> self = args.Holder();
         Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
         void* ptr = wrap->Value();
@@ -257,6 +362,7 @@ namespace bts { namespace game {
    void v8_blockchain::Get_Block(const v8::FunctionCallbackInfo<Value>& args)
    {
       EscapableHandleScope handle_scope(args.GetIsolate());
+      if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
       Local<Object> self = args.Holder();
       Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
       void* ptr = wrap->Value();
@@ -278,6 +384,7 @@ namespace bts { namespace game {
     void v8_blockchain::Get_Transaction(const v8::FunctionCallbackInfo<Value>& args)
     {
         EscapableHandleScope handle_scope(args.GetIsolate());
+        if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
         Local<Object> self = args.Holder();
         Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
         void* ptr = wrap->Value();
@@ -307,6 +414,7 @@ namespace bts { namespace game {
    void v8_blockchain::Get_Current_Random_Seed(const v8::FunctionCallbackInfo<Value>& args)
    {
        EscapableHandleScope handle_scope(args.GetIsolate());
+       if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
        
       Local<Object> self = args.Holder();
       Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -320,6 +428,7 @@ namespace bts { namespace game {
     void v8_blockchain::Get_Asset_Record(const v8::FunctionCallbackInfo<Value>& args)
     {
         EscapableHandleScope handle_scope(args.GetIsolate());
+        if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
         Local<Object> self = args.Holder();
         Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
         void* ptr = wrap->Value();
@@ -345,6 +454,7 @@ namespace bts { namespace game {
     void v8_blockchain::Get_Account_Record_By_Name(const v8::FunctionCallbackInfo<Value>& args)
     {
         EscapableHandleScope handle_scope(args.GetIsolate());
+        if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
         
         Local<Object> self = args.Holder();
         Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -382,7 +492,7 @@ namespace bts { namespace game {
         EscapableHandleScope handle_scope(isolate);
         
         //get class template
-        Handle<FunctionTemplate> templ = Local<FunctionTemplate>::New(isolate, v8_api::wallet_templ);
+        Handle<FunctionTemplate> templ = Local<FunctionTemplate>::New(isolate, v8_api::class_templates(isolate).wallet_templ);
         Handle<Function> wallet_ctor = templ->GetFunction();
         
         //get class instance
@@ -414,6 +524,7 @@ namespace bts { namespace game {
     void v8_wallet::Get_Wallet_Key_For_Address(const v8::FunctionCallbackInfo<Value>& args)
     {
         EscapableHandleScope handle_scope(args.GetIsolate());
+        if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
         
         Local<Object> self = args.Holder();
         Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -439,6 +550,7 @@ namespace bts { namespace game {
     void v8_wallet::Store_Transaction(const v8::FunctionCallbackInfo<Value>& args)
     {
         EscapableHandleScope handle_scope(args.GetIsolate());
+        if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
         
         Local<Object> self = args.Holder();
         Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -460,7 +572,7 @@ namespace bts { namespace game {
       
       
       
-      Handle<FunctionTemplate> templ = Local<FunctionTemplate>::New(isolate, v8_api::pendingstate_templ);
+      Handle<FunctionTemplate> templ = Local<FunctionTemplate>::New(isolate, v8_api::class_templates(isolate).pendingstate_templ);
       
       Handle<Function> pendingstate_ctor = templ->GetFunction();
       Local<Object> g_pendingstate = pendingstate_ctor->NewInstance();
@@ -475,6 +587,7 @@ namespace bts { namespace game {
    void v8_chainstate::Get_Blance_Record(const v8::FunctionCallbackInfo<Value>& args)
    {
        EscapableHandleScope handle_scope(args.GetIsolate());
+       if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
        
       Local<Object> self = args.Holder();
       Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -483,6 +596,7 @@ namespace bts { namespace game {
       Local<External> wrap_addr = Local<External>::Cast(args[0]);
       
       auto balance_record = static_cast<v8_chainstate*>(ptr)->_chain_state->get_balance_record(* static_cast<address*>(wrap_addr->Value()));
+      if ( !v8_api::check_isolation( args.GetIsolate(), static_cast<v8_chainstate*>(ptr)->may_read_balance( balance_record ) ) ) return;
       
       args.GetReturnValue().Set( External::New(args.GetIsolate(), &balance_record) );
    }
@@ -490,6 +604,7 @@ namespace bts { namespace game {
    void v8_chainstate::Get_Asset_Record(const v8::FunctionCallbackInfo<Value>& args)
    {
        EscapableHandleScope handle_scope(args.GetIsolate());
+       if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
        
        Local<Object> self = args.Holder();
        Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -503,6 +618,7 @@ namespace bts { namespace game {
        {
            asset_rec = static_cast<v8_chainstate*>(ptr)->_chain_state->get_asset_record( v8_helper::ToCString(String::Utf8Value( args[0]->ToInt32() )) );
        }
+       if ( !v8_api::check_isolation( args.GetIsolate(), static_cast<v8_chainstate*>(ptr)->may_read_asset( asset_rec ) ) ) return;
       
       if ( asset_rec.valid() )
       {
@@ -516,6 +632,7 @@ namespace bts { namespace game {
    void v8_chainstate::Get_Game_Data_Record(const v8::FunctionCallbackInfo<Value>& args)
    {
        EscapableHandleScope handle_scope(args.GetIsolate());
+       if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
        
       Local<Object> self = args.Holder();
       Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -524,6 +641,7 @@ namespace bts { namespace game {
       Local<Integer> wrapper_type = Local<Integer>::Cast(args[0]);
       Local<Integer> wrapper_id = Local<Integer>::Cast(args[1]);
       
+      if ( !v8_api::check_isolation( args.GetIsolate(), static_cast<v8_chainstate*>(ptr)->may_access_game_data( wrapper_type->Int32Value() ) ) ) return;
       auto game_data_record = static_cast<v8_chainstate*>(ptr)->_chain_state->get_game_data_record(wrapper_type->Int32Value(), wrapper_id->Int32Value() );
        
        if ( game_data_record.valid() )
@@ -538,6 +656,7 @@ namespace bts { namespace game {
     void v8_chainstate::Get_Account_Record_By_Name(const v8::FunctionCallbackInfo<Value>& args)
     {
         EscapableHandleScope handle_scope(args.GetIsolate());
+        if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
         
         Local<Object> self = args.Holder();
         Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -573,6 +692,7 @@ namespace bts { namespace game {
     void v8_blockchain::Get_Game_Data_Record(const v8::FunctionCallbackInfo<Value>& args)
     {
         EscapableHandleScope handle_scope(args.GetIsolate());
+        if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
         
         Local<Object> self = args.Holder();
         Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -600,6 +720,7 @@ namespace bts { namespace game {
    void v8_chainstate::Store_Blance_Record(const v8::FunctionCallbackInfo<Value>& args)
    {
        EscapableHandleScope handle_scope(args.GetIsolate());
+       if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
       Local<Object> self = args.Holder();
       Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
       void* ptr = wrap->Value();
@@ -607,12 +728,15 @@ namespace bts { namespace game {
       Local<External> wrap_addr = Local<External>::Cast(args[0]);
       
       // TODO: parse json to C++ struct, from variant
-      static_cast<v8_chainstate*>(ptr)->_chain_state->store_balance_record(* static_cast<blockchain::balance_record*>(wrap_addr->Value()));
+      const auto& balance_rec = * static_cast<blockchain::balance_record*>(wrap_addr->Value());
+      if ( !v8_api::check_isolation( args.GetIsolate(), static_cast<v8_chainstate*>(ptr)->may_write_balance( balance_rec ) ) ) return;
+      static_cast<v8_chainstate*>(ptr)->_chain_state->store_balance_record( balance_rec );
    }
    
    void v8_chainstate::Store_Asset_Record(const v8::FunctionCallbackInfo<Value>& args)
    {
       EscapableHandleScope handle_scope(args.GetIsolate());
+      if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
       Local<Object> self = args.Holder();
       Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
       void* ptr = wrap->Value();
@@ -620,7 +744,9 @@ namespace bts { namespace game {
       Local<External> wrapper_asset = Local<External>::Cast(args[0]);
       
       // TODO: parse json to C++ struct, from variant
-      static_cast<v8_chainstate*>(ptr)->_chain_state->store_asset_record(* static_cast<blockchain::asset_record*>(wrapper_asset->Value()));
+      const auto& asset_rec = * static_cast<blockchain::asset_record*>(wrapper_asset->Value());
+      if ( !v8_api::check_isolation( args.GetIsolate(), static_cast<v8_chainstate*>(ptr)->may_write_asset( asset_rec ) ) ) return;
+      static_cast<v8_chainstate*>(ptr)->_chain_state->store_asset_record( asset_rec );
    }
    
    /**
@@ -631,6 +757,7 @@ namespace bts { namespace game {
    void v8_chainstate::Store_Game_Data_Record(const v8::FunctionCallbackInfo<Value>& args)
    {
        EscapableHandleScope handle_scope(args.GetIsolate());
+       if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
        
       Local<Object> self = args.Holder();
       Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -641,14 +768,118 @@ namespace bts { namespace game {
       Local<Object> wrap_game_data = Local<Object>::Cast(args[2]);
       
       // TODO: parse json to C++ struct, from variant
+       if ( !v8_api::check_isolation( args.GetIsolate(), static_cast<v8_chainstate*>(ptr)->may_access_game_data( wrapper_type->Int32Value() ) ) ) return;
        static_cast<v8_chainstate*>(ptr)->_chain_state->store_game_data_record(wrapper_type->Int32Value(), wrapper_id->Int32Value(), v8_helper::json_to_cpp<game_data_record>(args.GetIsolate(), wrap_game_data ) );
    }
    
+   /**
+    * get_game_data_records(game_id, data_ids): the records, or null for those not found, in the order asked for
+    */
+   void v8_chainstate::Get_Game_Data_Records(const v8::FunctionCallbackInfo<Value>& args)
+   {
+      EscapableHandleScope handle_scope(args.GetIsolate());
+      if ( !args[1]->IsArray() )
+      {
+         args.GetIsolate()->ThrowException( v8::Exception::TypeError( String::NewFromUtf8( args.GetIsolate(), "data_ids must be an array" ) ) );
+         return;
+      }
+      Local<Array> data_ids = Local<Array>::Cast(args[1]);
+      if ( !v8_api::charge_call_budget( args.GetIsolate(), 1 + data_ids->Length() ) ) return;
+      
+      auto state = static_cast<v8_chainstate*>( Local<External>::Cast(args.Holder()->GetInternalField(0))->Value() );
+      const game_id_type game_id = args[0]->Int32Value();
+      if ( !v8_api::check_isolation( args.GetIsolate(), state->may_access_game_data( game_id ) ) ) return;
+      
+      try {
+         Local<Array> result = Array::New( args.GetIsolate(), data_ids->Length() );
+         for ( uint32_t i = 0; i < data_ids->Length(); ++i )
+         {
+            auto record = state->_chain_state->get_game_data_record( game_id, data_ids->Get(i)->Int32Value() );
+            if ( record.valid() && !record->is_null() )
+               result->Set( i, v8_helper::cpp_to_json(args.GetIsolate(), *record) );
+            else
+               result->Set( i, v8::Null( args.GetIsolate() ) );
+         }
+         args.GetReturnValue().Set( handle_scope.Escape( result ) );
+      } catch ( const fc::exception& e )
+      {
+         args.GetIsolate()->ThrowException( String::NewFromUtf8( args.GetIsolate(), e.to_string().c_str() ) );
+      }
+   }
+   
+   /**
+    * scan_game_data_records(game_id, first, last, limit): the records with first <= index <= last, in index order
+    */
+   void v8_chainstate::Scan_Game_Data_Records(const v8::FunctionCallbackInfo<Value>& args)
+   {
+      EscapableHandleScope handle_scope(args.GetIsolate());
+      if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
+      
+      auto state = static_cast<v8_chainstate*>( Local<External>::Cast(args.Holder()->GetInternalField(0))->Value() );
+      const game_id_type game_id = args[0]->Int32Value();
+      if ( !v8_api::check_isolation( args.GetIsolate(), state->may_access_game_data( game_id ) ) ) return;
+      
+      try {
+         const auto records = state->_chain_state->scan_game_data_records( game_id, args[1]->Int32Value(), args[2]->Int32Value(),
+                                                                           scan_limit( args.GetIsolate(), args[3] ) );
+         if ( !v8_api::charge_call_budget( args.GetIsolate(), records.size() ) ) return;
+         args.GetReturnValue().Set( handle_scope.Escape( game_data_records_to_v8( args.GetIsolate(), records ) ) );
+      } catch ( const fc::exception& e )
+      {
+         args.GetIsolate()->ThrowException( String::NewFromUtf8( args.GetIsolate(), e.to_string().c_str() ) );
+      }
+   }
+   
+   /**
+    * set_game_data_records(game_id, records): each record is stored under its data.index;
+    * a record whose game_id is 0 removes it
+    */
+   void v8_chainstate::Store_Game_Data_Records(const v8::FunctionCallbackInfo<Value>& args)
+   {
+      EscapableHandleScope handle_scope(args.GetIsolate());
+      if ( !args[1]->IsArray() )
+      {
+         args.GetIsolate()->ThrowException( v8::Exception::TypeError( String::NewFromUtf8( args.GetIsolate(), "records must be an array" ) ) );
+         return;
+      }
+      if ( !v8_api::charge_call_budget( args.GetIsolate(), 1 + Local<Array>::Cast(args[1])->Length() ) ) return;
+      
+      auto state = static_cast<v8_chainstate*>( Local<External>::Cast(args.Holder()->GetInternalField(0))->Value() );
+      const game_id_type game_id = args[0]->Int32Value();
+      if ( !v8_api::check_isolation( args.GetIsolate(), state->may_access_game_data( game_id ) ) ) return;
+      
+      try {
+         for ( const auto& record : v8_helper::json_to_cpp<vector<game_data_record>>( args.GetIsolate(), args[1] ) )
+            state->_chain_state->store_game_data_record( game_id, record.get_game_data_index(), record );
+      } catch ( const fc::exception& e )
+      {
+         args.GetIsolate()->ThrowException( String::NewFromUtf8( args.GetIsolate(), e.to_string().c_str() ) );
+      }
+   }
+   
+   void v8_blockchain::Scan_Game_Data_Records(const v8::FunctionCallbackInfo<Value>& args)
+   {
+      EscapableHandleScope handle_scope(args.GetIsolate());
+      if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
+      
+      auto blockchain = static_cast<v8_blockchain*>( Local<External>::Cast(args.Holder()->GetInternalField(0))->Value() );
+      
+      try {
+         const auto records = blockchain->_blockchain->scan_game_data_records( args[0]->Int32Value(), args[1]->Int32Value(), args[2]->Int32Value(),
+                                                                               scan_limit( args.GetIsolate(), args[3] ) );
+         if ( !v8_api::charge_call_budget( args.GetIsolate(), records.size() ) ) return;
+         args.GetReturnValue().Set( handle_scope.Escape( game_data_records_to_v8( args.GetIsolate(), records ) ) );
+      } catch ( const fc::exception& e )
+      {
+         args.GetIsolate()->ThrowException( String::NewFromUtf8( args.GetIsolate(), e.to_string().c_str() ) );
+      }
+   }
+   
    Local<Object> v8_evalstate::New(v8::Isolate* isolate, v8_evalstate* local_v8_evalstate)
    {
       EscapableHandleScope handle_scope(isolate);
       
-      Handle<FunctionTemplate> templ = Local<FunctionTemplate>::New(isolate, v8_api::eval_state_templ);
+      Handle<FunctionTemplate> templ = Local<FunctionTemplate>::New(isolate, v8_api::class_templates(isolate).eval_state_templ);
       Handle<Function> evalstate_ctor = templ->GetFunction();
       Local<Object> g_evalstate = evalstate_ctor->NewInstance();
       g_evalstate->SetInternalField(0, External::New(isolate, local_v8_evalstate));
@@ -664,6 +895,7 @@ namespace bts { namespace game {
    void v8_evalstate::Sub_Balance(const v8::FunctionCallbackInfo<Value>& args)
    {
        EscapableHandleScope handle_scope(args.GetIsolate());
+       if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
        
       Local<Object> self = args.Holder();
       Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
@@ -678,6 +910,7 @@ namespace bts { namespace game {
     void v8_evalstate::Get_Transaction_Id(const v8::FunctionCallbackInfo<Value>& args)
     {
         EscapableHandleScope handle_scope(args.GetIsolate());
+        if ( !v8_api::charge_call_budget( args.GetIsolate() ) ) return;
         
         Local<Object> self = args.Holder();
         Local<External> wrap = Local<External>::Cast(self->GetInternalField(0));
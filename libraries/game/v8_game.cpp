@@ -1,3 +1,5 @@
+#include <bts/blockchain/config.hpp>
+#include <bts/blockchain/fork_blocks.hpp>
 #include <bts/blockchain/time.hpp>
 
 #include <bts/game/v8_helper.hpp>
@@ -6,19 +8,157 @@
 #include <bts/game/client.hpp>
 #include <bts/game/game_operations.hpp>
 
+#include <fc/crypto/sha256.hpp>
+#include <fc/filesystem.hpp>
 #include <fc/log/logger.hpp>
 
+#include <fstream>
+#include <iterator>
+#include <limits>
+
+// units of v8_call_budget one call into a game script may use, PLAY's also bound the wallet's scans
+#define BTS_GAME_EXECUTE_CALL_BUDGET    100000
+#define BTS_GAME_EVALUATE_CALL_BUDGET   1000
+#define BTS_GAME_PLAY_CALL_BUDGET       10000
+
+// loop iterations and function calls one call into a game script may make
+#define BTS_GAME_EXECUTE_STEP_BUDGET    10000000
+#define BTS_GAME_EVALUATE_STEP_BUDGET   100000
+#define BTS_GAME_PLAY_STEP_BUDGET       1000000
+
 namespace bts { namespace game {
    
    namespace detail {
+      /**
+       * Holds one call into the script to its budget for as long as it is in scope, and
+       * reports the call to the client when it is made for a block. The isolate must be locked.
+       *
+       * A call that is not enforced, because its block is before BTS_V0_GAME_EXECUTION_LIMITS_FORK_BLOCK_NUM,
+       * is only measured.
+       */
+      class script_call
+      {
+      public:
+         script_call( Isolate* isolate, uint64_t budget_limit, uint64_t step_limit, bool enforced = true )
+         : budget( enforced ? budget_limit : std::numeric_limits<uint64_t>::max(),
+                   enforced ? step_limit : std::numeric_limits<uint64_t>::max() ),
+           enforced( enforced ), _isolate( isolate ), _start_time( fc::time_point::now() )
+         {
+            v8_api::set_call_budget( _isolate, &budget );
+         }
+         
+         ~script_call()
+         {
+            v8_api::set_call_budget( _isolate, nullptr );
+            if( _client == nullptr )
+               return;
+            
+            try
+            {
+               HeapStatistics heap;
+               _isolate->GetHeapStatistics( &heap );
+               
+               _call.duration = fc::time_point::now() - _start_time;
+               _call.budget_used = budget.used;
+               _call.steps = budget.steps;
+               _call.budget_exceeded = budget.exceeded();
+               _call.used_heap_size = heap.used_heap_size();
+               _call.total_heap_size = heap.total_heap_size();
+               _client->record_script_call( _call );
+            }
+            catch( ... )
+            {
+            }
+         }
+         
+         void profile( bts::game::client* client, game_script_call::call_type type, game_id_type game_id,
+                       const std::string& game_name, uint32_t block_num )
+         {
+            _client = client;
+            _call.type = type;
+            _call.game_id = game_id;
+            _call.game_name = game_name;
+            _call.block_num = block_num;
+         }
+         
+         /** the records a script hands back cost a unit each */
+         void charge_result( uint64_t records )
+         {
+            FC_ASSERT( budget.charge( records ), "Game script execution budget exceeded: ${used} of ${limit}",
+                       ("used", budget.used)("limit", budget.limit) );
+         }
+         
+         v8_call_budget            budget;
+         const bool                enforced;
+         
+      private:
+         Isolate*                  _isolate;
+         fc::time_point            _start_time;
+         bts::game::client*        _client = nullptr;
+         game_script_call          _call;
+      };
+      
+      /**
+       * What PLAY.scan_result and PLAY.scan_results are called in: the locked and entered isolate
+       * and context, and the arguments after the results, which both take in the same order.
+       */
+      struct scan_scope
+      {
+         scan_scope( Isolate* isolate, const v8::Persistent<Context>& persistent_context, bts::wallet::wallet_ptr w,
+                     uint32_t block_num, const time_point_sec& block_time )
+         : isolate( isolate ), locker( isolate ), call( isolate, BTS_GAME_PLAY_CALL_BUDGET, BTS_GAME_PLAY_STEP_BUDGET ),
+           isolate_scope( isolate ), handle_scope( isolate ),
+           context( v8::Local<v8::Context>::New( isolate, persistent_context ) ), context_scope( context ),
+           try_catch( isolate ), wallet( w )
+         {
+            play = context->Global()->Get( String::NewFromUtf8( isolate, "PLAY" ) );
+            FC_ASSERT( play->IsObject() );
+            
+            block_num_value = Integer::New( isolate, block_num );
+            block_time_value = String::NewFromUtf8( isolate, fc::variant( block_time ).as_string().c_str() );
+            wallet_value = v8_wallet::New( isolate, &wallet );
+         }
+         
+         /** the function PLAY has under name, or an empty handle */
+         Local<Function> play_function( const char* name )const
+         {
+            auto function = play->ToObject()->Get( String::NewFromUtf8( isolate, name ) );
+            return function->IsFunction() ? Handle<Function>::Cast( function ) : Local<Function>();
+         }
+         
+         /** PLAY.scan_result( result, block_num, block_time, trx_index, wallet ) */
+         Local<Value> call_scan_result( Local<Function> scan_result, const game_result_transaction& rtrx, uint32_t trx_index )
+         {
+            Local<Value> argv[5] = { v8_helper::cpp_to_json( isolate, rtrx ), block_num_value, block_time_value,
+                                     Integer::New( isolate, trx_index ), wallet_value };
+            return scan_result->Call( context->Global(), 5, argv );
+         }
+         
+         Isolate*                  isolate;
+         v8::Locker                locker;
+         script_call               call;
+         Isolate::Scope            isolate_scope;
+         v8::HandleScope           handle_scope;
+         v8::Local<v8::Context>    context;
+         v8::Context::Scope        context_scope;
+         v8::TryCatch              try_catch;
+         v8_wallet                 wallet;
+         Local<Value>              play;
+         Local<Value>              block_num_value;
+         Local<Value>              block_time_value;
+         Local<Value>              wallet_value;
+      };
+      
       class v8_game_engine_impl {
          
       public:
          bts::game::v8_game_engine*         self;
          bts::game::client*                 _client;
          std::string                        _game_name;
-         Isolate*                           _isolate;
+         Isolate*                           _isolate = nullptr;
          v8::Persistent<Context>            _context;
+         // PLAY.isolated as the script set it when it was run
+         bool                               _isolated = false;
          
          v8_game_engine_impl(v8_game_engine* self, bts::game::client* client)
          : self(self), _client(client)
@@ -28,6 +168,8 @@ namespace bts { namespace game {
          
          ~v8_game_engine_impl(){
             _context.Reset();
+            if( _isolate != nullptr )
+               _client->dispose_isolate( _isolate );
          }
          
          void init()
@@ -35,8 +177,7 @@ namespace bts { namespace game {
             // Refer http://v8.googlecode.com/svn/trunk/samples/process.cc
             // Deprecated: fc::path script_path( _client->get_data_dir() / (_game_name + ".js") );
             
-            //_isolate = v8::Isolate::GetCurrent();
-            _isolate = (Isolate*)_client->get_isolate();
+            _isolate = (Isolate*)_client->create_isolate();
              
             v8::Locker locker(_isolate);
             Isolate::Scope isolate_scope(_isolate);
@@ -52,13 +193,16 @@ namespace bts { namespace game {
             
             Context::Scope context_scope(context);
             
+            // what the metered script calls on every step, which it must not be able to replace
+            context->Global()->ForceSet( String::NewFromUtf8( _isolate, v8_helper::step_function_name ),
+                                         FunctionTemplate::New( _isolate, v8_api::V8_Global_Step )->GetFunction(),
+                                         PropertyAttribute( ReadOnly | DontDelete | DontEnum ) );
+            
             //ilog("The game is ${s}", ("s", _game_name ));
             
              auto ogame_rec = _client->get_chain_database()->get_game_record( _game_name );
              FC_ASSERT( ogame_rec.valid() );
              
-             v8::Handle<v8::String> source = v8::String::NewFromUtf8( GetIsolate(), ogame_rec->script_code.c_str() );
-            
              if (ogame_rec->script_code.empty()) {
                  //wlog("The souce is empty, error loading script code");
                  GetIsolate()->ThrowException( v8::String::NewFromUtf8(GetIsolate(), "Error loading file" ) );
@@ -66,13 +210,12 @@ namespace bts { namespace game {
                  FC_CAPTURE_AND_THROW(failed_loading_source_file, (_game_name)(*error));
              }
              
-            String::Utf8Value utf8_source(source);
-            Handle<Script> script = Script::Compile(source);
+            Handle<Script> script = compile( v8_helper::meter_steps( ogame_rec->script_code ) );
             
             if ( script.IsEmpty() )
             {
                 // The TryCatch above is still in effect and will have caught the error.
-                FC_CAPTURE_AND_THROW(failed_compile_script, (*utf8_source)(v8_helper::ReportException(GetIsolate(), &try_catch)));
+                FC_CAPTURE_AND_THROW(failed_compile_script, (ogame_rec->script_code)(v8_helper::ReportException(GetIsolate(), &try_catch)));
             } else
             {
                 // Run the script to get the result.
@@ -87,6 +230,76 @@ namespace bts { namespace game {
                     wlog("Script init result is ${s}", ( "s",  v8_helper::ToCString(String::Utf8Value(result)) ));
                 }
             }
+            
+            _isolated = read_isolated( context );
+         }
+         
+         /**
+          * Reads PLAY.isolated once, under PLAY.evaluate's budget: a getter that throws or runs out of
+          * budget, or a PLAY that is not an object, leaves the game not isolated.
+          */
+         bool read_isolated( Local<Context> context )
+         {
+            script_call call( _isolate, BTS_GAME_EVALUATE_CALL_BUDGET, BTS_GAME_EVALUATE_STEP_BUDGET );
+            v8::TryCatch try_catch( _isolate );
+            
+            Local<Value> play = context->Global()->Get( String::NewFromUtf8( _isolate, "PLAY" ) );
+            if( play.IsEmpty() || !play->IsObject() )
+               return false;
+            
+            Local<Value> isolated = play.As<Object>()->Get( String::NewFromUtf8( _isolate, "isolated" ) );
+            return !isolated.IsEmpty() && isolated->IsTrue() && !call.budget.exceeded();
+         }
+         
+         /**
+          * Compiles the metered script with the code cache V8 produced the first time it was compiled,
+          * kept under the game client's data dir by the hash of the script. A cache V8
+          * rejects, as one from another V8 version, is removed and made again next time.
+          */
+         Handle<Script> compile( const std::string& script_code )
+         {
+            Handle<v8::String> source = v8::String::NewFromUtf8( GetIsolate(), script_code.c_str() );
+            const fc::path cache_dir = _client->get_code_cache_dir();
+            const fc::path cache_file = cache_dir / ( fc::sha256::hash( script_code ).str() + ".bin" );
+            
+            std::vector<char> cache_data;
+            if( fc::exists( cache_file ) )
+            {
+               std::ifstream in( cache_file.string(), std::ios::binary );
+               cache_data.assign( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+            }
+            
+            if( !cache_data.empty() )
+            {
+               // owned by script_source, which does not copy the data
+               auto cached = new ScriptCompiler::CachedData( (const uint8_t*)cache_data.data(), int( cache_data.size() ) );
+               ScriptCompiler::Source script_source( source, cached );
+               Local<Script> script = ScriptCompiler::Compile( GetIsolate(), &script_source, ScriptCompiler::kConsumeCodeCache );
+               if( cached->rejected )
+               {
+                  wlog( "code cache of game ${name} was rejected", ("name", _game_name) );
+                  fc::remove( cache_file );
+               }
+               return script;
+            }
+            
+            ScriptCompiler::Source script_source( source );
+            Local<Script> script = ScriptCompiler::Compile( GetIsolate(), &script_source, ScriptCompiler::kProduceCodeCache );
+            const ScriptCompiler::CachedData* produced = script_source.GetCachedData();
+            if( !script.IsEmpty() && produced != nullptr && produced->length > 0 )
+            {
+               try
+               {
+                  fc::create_directories( cache_dir );
+                  std::ofstream out( cache_file.string(), std::ios::binary | std::ios::trunc );
+                  out.write( (const char*)produced->data, produced->length );
+               }
+               catch( const fc::exception& e )
+               {
+                  wlog( "unable to store the code cache of game ${name}: ${e}", ("name", _game_name)("e", e.to_string()) );
+               }
+            }
+            return script;
          }
          
          Isolate* GetIsolate() { return _isolate; }
@@ -105,6 +318,11 @@ namespace bts { namespace game {
        
       global(ogame_rec->id, game_assets);
    }
+   
+   bool v8_game_engine::declares_isolated()const
+   {
+      return my->_isolated;
+   }
     
    bool v8_game_engine::global( game_id_type game_id, vector<asset_record> game_assets)
    {
@@ -151,6 +369,10 @@ namespace bts { namespace game {
    {
        auto isolate = my->GetIsolate();
        v8::Locker locker( isolate );
+       const uint32_t block_num = eval_state.pending_state()->get_head_block_num() + 1;
+       detail::script_call call( isolate, BTS_GAME_EVALUATE_CALL_BUDGET, BTS_GAME_EVALUATE_STEP_BUDGET,
+                                 block_num >= BTS_V0_GAME_EXECUTION_LIMITS_FORK_BLOCK_NUM );
+       call.profile( my->_client, game_script_call::evaluate_call, game_id, my->_game_name, block_num );
        Isolate::Scope isolate_scope(my->GetIsolate());
        v8::HandleScope handle_scope( isolate );
        v8::Local<v8::Context> context = v8::Local<v8::Context>::New(my->GetIsolate(), my->_context);
@@ -197,6 +419,11 @@ namespace bts { namespace game {
                FC_ASSERT( result_obj.get_object().contains( "datas" ) );
                auto to_balances_var = result_obj.get_object()["to_balances"];
                FC_ASSERT( to_balances_var.is_array() );
+               if( call.enforced )
+               {
+                   FC_ASSERT( result_obj.get_object()["datas"].is_array() );
+                   call.charge_result( to_balances_var.get_array().size() + result_obj.get_object()["datas"].get_array().size() );
+               }
                
                for ( auto to_balance : to_balances_var.get_array() )
                {
@@ -288,6 +515,7 @@ namespace bts { namespace game {
       
        auto isolate = my->GetIsolate();
        v8::Locker locker(isolate);
+       detail::script_call call( isolate, BTS_GAME_PLAY_CALL_BUDGET, BTS_GAME_PLAY_STEP_BUDGET );
        
        // crash when using game_play #162
        // https://github.com/bitsuperlab/cpp-play/issues/162#issuecomment-14764010
@@ -438,6 +666,7 @@ namespace bts { namespace game {
    {
        auto isolate = my->GetIsolate();
        v8::Locker locker(isolate);
+       detail::script_call call( isolate, BTS_GAME_PLAY_CALL_BUDGET, BTS_GAME_PLAY_STEP_BUDGET );
        Isolate::Scope isolate_scope(my->GetIsolate());
        v8::HandleScope handle_scope( isolate );
        v8::Local<v8::Context> context = v8::Local<v8::Context>::New(isolate, my->_context);
@@ -497,55 +726,74 @@ namespace bts { namespace game {
                     const time_point_sec& block_time,
                     const uint32_t trx_index, bts::wallet::wallet_ptr w)
    {
-       auto isolate = my->GetIsolate();
-       v8::Locker locker(isolate);
-       Isolate::Scope isolate_scope(isolate);
-       v8::HandleScope handle_scope(isolate);
-       v8::Local<v8::Context> context = v8::Local<v8::Context>::New(isolate, my->_context);
-       v8::Context::Scope context_scope(context);
+       detail::scan_scope scope( my->GetIsolate(), my->_context, w, block_num, block_time );
        
-       v8::TryCatch try_catch(my->GetIsolate());
+       Local<Function> scan_result_func = scope.play_function( "scan_result" );
+       if ( scan_result_func.IsEmpty() )
+           FC_CAPTURE_AND_THROW( failed_compile_script );
        
-       Local<Function> scan_result_func;
-       Local<Value>  argv[5] ;
+       Local<Value> result = scope.call_scan_result( scan_result_func, rtrx, trx_index );
+       if ( result.IsEmpty() )
+           FC_CAPTURE_AND_THROW(failed_run_script, ( v8_helper::ReportException( scope.isolate, &scope.try_catch) ));
        
-       auto play = context->Global()->Get( String::NewFromUtf8( my->GetIsolate(), "PLAY") );
+       variant v = v8_helper::json_to_cpp<variant>( scope.isolate, result );
+       //wlog("The result of the running of script is ${s}", ( "s",  v) );
+       return v.as_bool();
+   }
+   
+   void v8_game_engine::scan_results( const vector<game_result_transaction>& rtrxs,
+                                      const vector<uint32_t>& trx_indexes,
+                                      uint32_t block_num,
+                                      const time_point_sec& block_time, bts::wallet::wallet_ptr w)
+   {
+       FC_ASSERT( rtrxs.size() == trx_indexes.size() );
        
-       auto scan_result = play->ToObject()->Get( String::NewFromUtf8( my->GetIsolate(), "scan_result") );
+       detail::scan_scope scope( my->GetIsolate(), my->_context, w, block_num, block_time );
+       auto isolate = scope.isolate;
        
-       if(!scan_result->IsFunction()) {
-           FC_CAPTURE_AND_THROW( failed_compile_script );
-       } else {
-           v8_wallet local_v8_wallet(w);
-           
-           scan_result_func = Handle<Function>::Cast(scan_result);
-           argv[0] = v8_helper::cpp_to_json(isolate, rtrx);
-           argv[1] = Integer::New(my->GetIsolate(), block_num);
-           argv[2] = String::NewFromUtf8(my->GetIsolate(), fc::variant(block_time).as_string().c_str() );
-           argv[3] = Integer::New(my->GetIsolate(), trx_index);
-           argv[4] = v8_wallet::New(isolate, &local_v8_wallet);
-           
-           Local<Value> result = scan_result_func->Call(context->Global(), 5, argv);
+       Local<Function> scan_results_func = scope.play_function( "scan_results" );
+       if ( !scan_results_func.IsEmpty() )
+       {
+           Local<ArrayBuffer> index_buffer = ArrayBuffer::New( isolate, trx_indexes.size() * sizeof(uint32_t) );
+           Local<Uint32Array> indexes = Uint32Array::New( index_buffer, 0, trx_indexes.size() );
+           for ( uint32_t i = 0; i < trx_indexes.size(); ++i )
+               indexes->Set( i, Integer::NewFromUnsigned(isolate, trx_indexes[i]) );
            
+           Local<Value> argv[5] = { v8_helper::cpp_to_json(isolate, rtrxs), indexes, scope.block_num_value, scope.block_time_value,
+                                    scope.wallet_value };
+           Local<Value> result = scan_results_func->Call(scope.context->Global(), 5, argv);
            if ( result.IsEmpty() )
+               FC_CAPTURE_AND_THROW(failed_run_script, ( v8_helper::ReportException(isolate, &scope.try_catch) ));
+           return;
+       }
+       
+       Local<Function> scan_result_func = scope.play_function( "scan_result" );
+       if ( scan_result_func.IsEmpty() )
+           FC_CAPTURE_AND_THROW( failed_compile_script );
+       
+       for ( uint32_t i = 0; i < rtrxs.size(); ++i )
+       {
+           v8::HandleScope result_scope(isolate);
+           // as when each result was scanned on its own, one failing does not stop the others
+           if ( scope.call_scan_result( scan_result_func, rtrxs[i], trx_indexes[i] ).IsEmpty() )
            {
-               FC_CAPTURE_AND_THROW(failed_run_script, ( v8_helper::ReportException( my->GetIsolate(), &try_catch) ));
-           } else
-           {
-               variant v = v8_helper::json_to_cpp<variant>(isolate, result);
-               //wlog("The result of the running of script is ${s}", ( "s",  v) );
-               return v.as_bool();
+               wlog( "scan_result of game ${name} failed: ${e}", ("name", my->_game_name)("e", v8_helper::ReportException(isolate, &scope.try_catch)) );
+               scope.try_catch.Reset();
            }
        }
-      
-      return false;
    }
    
-   void v8_game_engine::execute( game_id_type game_id, chain_database_ptr blockchain, uint32_t block_num, const pending_chain_state_ptr& pending_state )
+   void v8_game_engine::execute( game_id_type game_id, chain_database_ptr blockchain, uint32_t block_num, const pending_chain_state_ptr& pending_state,
+                                 bool isolated, uintptr_t stack_limit )
    {
        try {
            //wlog("Start execute in game engine...");
            v8::Locker locker(my->GetIsolate());
+           // the limit is an address on the stack of the thread we run on, so it is set on every execute
+           my->GetIsolate()->SetStackLimit( stack_limit != 0 ? stack_limit : my->_client->get_stack_limit() );
+           detail::script_call call( my->GetIsolate(), BTS_GAME_EXECUTE_CALL_BUDGET, BTS_GAME_EXECUTE_STEP_BUDGET,
+                                     block_num >= BTS_V0_GAME_EXECUTION_LIMITS_FORK_BLOCK_NUM );
+           call.profile( my->_client, game_script_call::execute_call, game_id, my->_game_name, block_num );
            Isolate::Scope isolate_scope(my->GetIsolate());
            v8::HandleScope handle_scope(my->GetIsolate());
            v8::Local<v8::Context> context = v8::Local<v8::Context>::New(my->GetIsolate(), my->_context);
@@ -565,7 +813,7 @@ namespace bts { namespace game {
                execute_func = Handle<Function>::Cast(execute);
                
                v8_blockchain local_v8_blockchain(blockchain, block_num);
-               v8_chainstate v8_pendingstate(pending_state);
+               v8_chainstate v8_pendingstate(pending_state, game_id, isolated);
                
                argv[0] = v8_blockchain::New(my->GetIsolate(), &local_v8_blockchain);
                argv[1] = Integer::New(my->GetIsolate(), block_num);
@@ -598,6 +846,12 @@ namespace bts { namespace game {
                        auto diff_supply = v.get_object()["diff_supply"];
                    
                        FC_ASSERT( execute_results.is_array() );
+                       if( call.enforced )
+                       {
+                           FC_ASSERT( game_datas.is_array() && diff_balances.is_array() && diff_supply.is_array() );
+                           call.charge_result( execute_results.get_array().size() + game_datas.get_array().size()
+                                               + diff_balances.get_array().size() + diff_supply.get_array().size() );
+                       }
 
                        if (execute_results.get_array().size())
                        {
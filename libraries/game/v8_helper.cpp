@@ -4,6 +4,12 @@
 
 #include <boost/format.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <set>
+
 namespace bts { namespace game {
     Local<Value> v8_helper::parseJson(Isolate* isolate, Handle<String> jsonString) {
         EscapableHandleScope handle_scope(isolate);
@@ -41,6 +47,117 @@ namespace bts { namespace game {
         return handle_scope.Escape(JSON_stringify->Call(JSON, 1, &object)->ToString());
     }
     
+    Local<Value> v8_helper::variant_to_v8(Isolate* isolate, const fc::variant& v)
+    {
+        EscapableHandleScope handle_scope(isolate);
+        
+        switch( v.get_type() )
+        {
+            case fc::variant::null_type:
+                return handle_scope.Escape( Local<Value>( v8::Null(isolate) ) );
+            case fc::variant::int64_type:
+                if( v.as_int64() >= std::numeric_limits<int32_t>::min() && v.as_int64() <= std::numeric_limits<int32_t>::max() )
+                    return handle_scope.Escape( Integer::New(isolate, int32_t( v.as_int64() )) );
+                break;
+            case fc::variant::uint64_type:
+                if( v.as_uint64() <= uint64_t( std::numeric_limits<int32_t>::max() ) )
+                    return handle_scope.Escape( Integer::New(isolate, int32_t( v.as_uint64() )) );
+                break;
+            case fc::variant::bool_type:
+                return handle_scope.Escape( Local<Value>( v8::Boolean::New(isolate, v.as_bool()) ) );
+            case fc::variant::string_type:
+            {
+                const std::string& str = v.get_string();
+                return handle_scope.Escape( String::NewFromUtf8(isolate, str.data(), String::kNormalString, int( str.size() )) );
+            }
+            case fc::variant::array_type:
+            {
+                const fc::variants& items = v.get_array();
+                Local<Array> array = Array::New(isolate, int( items.size() ));
+                for( uint32_t i = 0; i < items.size(); ++i )
+                    array->Set( i, variant_to_v8(isolate, items[i]) );
+                return handle_scope.Escape( array );
+            }
+            case fc::variant::object_type:
+            {
+                const fc::variant_object& fields = v.get_object();
+                Local<Object> object = Object::New(isolate);
+                for( const auto& field : fields )
+                {
+                    const std::string& key = field.key();
+                    object->Set( String::NewFromUtf8(isolate, key.data(), String::kNormalString, int( key.size() )),
+                                 variant_to_v8(isolate, field.value()) );
+                }
+                return handle_scope.Escape( object );
+            }
+            default:
+                break;
+        }
+        
+        // integers past 32 bits, doubles, blobs and anything newer are parsed from the text fc::json writes,
+        // so scripts see exactly what they saw when every value took that way
+        return handle_scope.Escape( parseJson( isolate, String::NewFromUtf8(isolate, fc::json::to_string(v).c_str()) ) );
+    }
+    
+    fc::variant v8_helper::v8_to_variant(Isolate* isolate, Handle<Value> value)
+    {
+        HandleScope handle_scope(isolate);
+        
+        if( value.IsEmpty() || value->IsUndefined() || value->IsNull() || value->IsFunction() )
+            return fc::variant();
+        if( value->IsBoolean() )
+            return fc::variant( value->BooleanValue() );
+        if( value->IsNumber() )
+        {
+            // JSON writes NaN and Infinity as null
+            if( !std::isfinite( value->NumberValue() ) )
+                return fc::variant();
+            // any other number is read from the text JSON.stringify writes for it, so fc::json picks its type and value
+            if( value->IsInt32() )
+                return fc::json::from_string( std::to_string( value->Int32Value() ) );
+            return fc::json::from_string( *String::Utf8Value( value ) );
+        }
+        if( value->IsString() )
+        {
+            String::Utf8Value utf8( value );
+            return fc::variant( std::string( *utf8, utf8.length() ) );
+        }
+        if( value->IsArray() )
+        {
+            Local<Array> array = Local<Array>::Cast( value );
+            fc::variants items;
+            items.reserve( array->Length() );
+            for( uint32_t i = 0; i < array->Length(); ++i )
+                items.push_back( v8_to_variant(isolate, array->Get(i)) );
+            return fc::variant( std::move( items ) );
+        }
+        if( value->IsObject() && !value->IsDate() && !value->IsRegExp() && !value->IsNumberObject()
+            && !value->IsStringObject() && !value->IsBooleanObject() )
+        {
+            Local<Object> object = value->ToObject();
+            if( !object->Has( String::NewFromUtf8(isolate, "toJSON") ) )
+            {
+                fc::mutable_variant_object fields;
+                Local<Array> names = object->GetOwnPropertyNames();
+                for( uint32_t i = 0; i < names->Length(); ++i )
+                {
+                    Local<Value> name = names->Get(i);
+                    Local<Value> field = object->Get(name);
+                    // JSON leaves out fields it cannot write
+                    if( field->IsUndefined() || field->IsFunction() )
+                        continue;
+                    String::Utf8Value utf8_name( name );
+                    fields( std::string( *utf8_name, utf8_name.length() ), v8_to_variant(isolate, field) );
+                }
+                return fc::variant( fields );
+            }
+        }
+        
+        // dates and other objects that write themselves
+        Local<String> v8_string = toJson( isolate, value );
+        return fc::json::from_string( *v8::String::Utf8Value(v8_string) );
+    }
+    
     void v8_helper::fc_ripemd160_hash(const v8::FunctionCallbackInfo<v8::Value>& args )
     {
         try {
@@ -339,4 +456,300 @@ namespace bts { namespace game {
    const char* v8_helper::ToCString(const v8::String::Utf8Value& value) {
       return *value ? *value : "<v8_helper::ToCString string conversion failed>";
    }
+   
+   namespace {
+      /** a token of a game script, told apart only as far as meter_steps needs */
+      struct script_token
+      {
+         enum token_type { identifier, number, string, template_head, regex, punctuator };
+         
+         token_type   type;
+         size_t       begin;
+         size_t       end;
+         bool         newline_before;
+      };
+      
+      bool is_identifier_char( char c )
+      {
+         return std::isalnum( (unsigned char)c ) || c == '_' || c == '$' || (unsigned char)c >= 0x80;
+      }
+      
+      std::string token_text( const std::string& source, const script_token& token )
+      {
+         return source.substr( token.begin, token.end - token.begin );
+      }
+      
+      /** whether a '/' after the tokens so far starts a regular expression rather than a division */
+      bool regex_allowed( const std::string& source, const std::vector<script_token>& tokens )
+      {
+         static const std::set<std::string> keywords = { "return", "typeof", "instanceof", "in", "new", "delete",
+                                                          "void", "throw", "case", "do", "else" };
+         if( tokens.empty() )
+            return true;
+         
+         const std::string text = token_text( source, tokens.back() );
+         switch( tokens.back().type )
+         {
+            case script_token::template_head:
+               return true;
+            case script_token::punctuator:
+               return text != ")" && text != "]" && text != "}" && text != "++" && text != "--";
+            case script_token::identifier:
+               return keywords.count( text ) > 0;
+            default:
+               return false;
+         }
+      }
+      
+      std::vector<script_token> tokenize_script( const std::string& source )
+      {
+         std::vector<script_token> tokens;
+         // the brace depths at which the substitutions of open template literals end
+         std::vector<int> template_depths;
+         int brace_depth = 0;
+         bool newline = false;
+         const size_t n = source.size();
+         size_t i = 0;
+         
+         // the rest of a template literal from i, up to its closing '`' or its next "${"
+         auto scan_template = [&]( size_t begin )
+         {
+            while( i < n && source[i] != '`' && !( source[i] == '$' && i + 1 < n && source[i + 1] == '{' ) )
+               i += source[i] == '\\' ? 2 : 1;
+            if( i < n && source[i] == '$' )
+            {
+               i += 2;
+               template_depths.push_back( ++brace_depth );
+               tokens.push_back( { script_token::template_head, begin, i, newline } );
+            }
+            else
+            {
+               i = std::min( i + 1, n );
+               tokens.push_back( { script_token::string, begin, i, newline } );
+            }
+         };
+         
+         while( i < n )
+         {
+            const char c = source[i];
+            const size_t begin = i;
+            if( c == '\n' || c == '\r' )
+            {
+               newline = true;
+               ++i;
+               continue;
+            }
+            else if( std::isspace( (unsigned char)c ) )
+            {
+               ++i;
+               continue;
+            }
+            else if( c == '/' && i + 1 < n && source[i + 1] == '/' )
+            {
+               i = std::min( source.find( '\n', i ), n );
+               continue;
+            }
+            else if( c == '/' && i + 1 < n && source[i + 1] == '*' )
+            {
+               const size_t end = std::min( source.find( "*/", i + 2 ), n - 2 ) + 2;
+               newline = newline || source.find( '\n', i ) < end;
+               i = end;
+               continue;
+            }
+            else if( is_identifier_char( c ) && !std::isdigit( (unsigned char)c ) )
+            {
+               while( i < n && is_identifier_char( source[i] ) )
+                  ++i;
+               tokens.push_back( { script_token::identifier, begin, i, newline } );
+            }
+            else if( std::isdigit( (unsigned char)c ) || ( c == '.' && i + 1 < n && std::isdigit( (unsigned char)source[i + 1] ) ) )
+            {
+               const bool hex = c == '0' && i + 1 < n && ( source[i + 1] == 'x' || source[i + 1] == 'X' );
+               for( ++i; i < n; ++i )
+               {
+                  const bool exponent_sign = !hex && ( source[i] == '+' || source[i] == '-' )
+                                             && ( source[i - 1] == 'e' || source[i - 1] == 'E' );
+                  if( !is_identifier_char( source[i] ) && source[i] != '.' && !exponent_sign )
+                     break;
+               }
+               tokens.push_back( { script_token::number, begin, i, newline } );
+            }
+            else if( c == '"' || c == '\'' )
+            {
+               for( ++i; i < n && source[i] != c && source[i] != '\n'; )
+                  i += source[i] == '\\' ? 2 : 1;
+               i = std::min( i + 1, n );
+               tokens.push_back( { script_token::string, begin, i, newline } );
+            }
+            else if( c == '`' )
+            {
+               ++i;
+               scan_template( begin );
+            }
+            else if( c == '}' && !template_depths.empty() && template_depths.back() == brace_depth )
+            {
+               template_depths.pop_back();
+               --brace_depth;
+               ++i;
+               scan_template( begin );
+            }
+            else if( c == '/' && regex_allowed( source, tokens ) )
+            {
+               bool in_class = false;
+               for( ++i; i < n && source[i] != '\n' && ( in_class || source[i] != '/' ); ++i )
+               {
+                  if( source[i] == '\\' )
+                     ++i;
+                  else if( source[i] == '[' )
+                     in_class = true;
+                  else if( source[i] == ']' )
+                     in_class = false;
+               }
+               for( i = std::min( i + 1, n ); i < n && is_identifier_char( source[i] ); )
+                  ++i;
+               tokens.push_back( { script_token::regex, begin, i, newline } );
+            }
+            else
+            {
+               // ++ and -- are kept whole, a '/' after them is a division
+               i += ( c == '+' || c == '-' ) && i + 1 < n && source[i + 1] == c ? 2 : 1;
+               if( c == '{' )
+                  ++brace_depth;
+               else if( c == '}' )
+                  --brace_depth;
+               tokens.push_back( { script_token::punctuator, begin, i, newline } );
+            }
+            newline = false;
+         }
+         return tokens;
+      }
+   }
+   
+   const char* const v8_helper::step_function_name = "__bts_step";
+   
+   std::string v8_helper::meter_steps( const std::string& source )
+   {
+      const std::string step = std::string( step_function_name ) + "()";
+      const std::vector<script_token> tokens = tokenize_script( source );
+      auto is = [&]( size_t k, const char* text ) { return k < tokens.size() && token_text( source, tokens[k] ) == text; };
+      
+      for( size_t k = 0; k < tokens.size(); ++k )
+      {
+         const std::string text = token_text( source, tokens[k] );
+         if( tokens[k].type == script_token::identifier )
+         {
+            FC_ASSERT( text != step_function_name, "Game scripts may not use the name ${name}", ("name", step_function_name) );
+            FC_ASSERT( text != "with" || ( k > 0 && is( k - 1, "." ) ), "Game scripts may not use with statements" );
+         }
+         else if( tokens[k].type == script_token::string || tokens[k].type == script_token::template_head )
+         {
+            FC_ASSERT( text.find( step_function_name ) == std::string::npos,
+                       "Game scripts may not use the name ${name}", ("name", step_function_name) );
+         }
+      }
+      
+      // what each open bracket belongs to
+      enum bracket_kind { plain, loop_condition, for_header, control };
+      struct bracket
+      {
+         bracket_kind   kind;
+         int            semicolons;
+         bool           condition_open;
+      };
+      std::vector<bracket> brackets;
+      bracket_kind last_closed = plain;
+      
+      // a function body is metered after its directive prologue, so "use strict" keeps its meaning
+      auto after_directives = [&]( size_t k )
+      {
+         size_t position = tokens[k].end;
+         for( size_t d = k + 1; d < tokens.size() && tokens[d].type == script_token::string; )
+         {
+            if( is( d + 1, ";" ) )
+               position = tokens[++d].end;
+            else if( is( d + 1, "}" ) || ( d + 1 < tokens.size() && tokens[d + 1].newline_before ) )
+               position = tokens[d].end;
+            else
+               break;
+            ++d;
+         }
+         return position;
+      };
+      
+      std::vector<std::pair<size_t, std::string>> inserts;
+      for( size_t k = 0; k < tokens.size(); ++k )
+      {
+         if( tokens[k].type != script_token::punctuator )
+            continue;
+         
+         const std::string text = token_text( source, tokens[k] );
+         if( text == "(" )
+         {
+            bracket_kind kind = plain;
+            if( k > 0 && tokens[k - 1].type == script_token::identifier )
+            {
+               const std::string keyword = token_text( source, tokens[k - 1] );
+               if( keyword == "while" )
+                  kind = loop_condition;
+               else if( keyword == "for" )
+                  kind = for_header;
+               else if( keyword == "if" || keyword == "switch" || keyword == "catch" )
+                  kind = control;
+            }
+            if( kind == loop_condition )
+               inserts.emplace_back( tokens[k].end, step + " && (" );
+            brackets.push_back( { kind, 0, false } );
+         }
+         else if( text == "[" || text == "{" )
+         {
+            // ") {" opens a function body, unless the parenthesis held a loop, if, switch or catch
+            if( text == "{" && k > 0 && is( k - 1, ")" ) && last_closed == plain )
+               inserts.emplace_back( after_directives( k ), ";" + step + ";" );
+            brackets.push_back( { plain, 0, false } );
+         }
+         else if( text == ")" || text == "]" || text == "}" )
+         {
+            // unbalanced brackets fail to compile anyway
+            if( brackets.empty() )
+               continue;
+            const bracket closed = brackets.back();
+            brackets.pop_back();
+            if( text == ")" )
+            {
+               if( closed.kind == loop_condition || closed.condition_open )
+                  inserts.emplace_back( tokens[k].begin, ")" );
+               last_closed = closed.kind;
+            }
+         }
+         else if( text == ";" && !brackets.empty() && brackets.back().kind == for_header )
+         {
+            bracket& header = brackets.back();
+            if( ++header.semicolons == 1 )
+            {
+               header.condition_open = !is( k + 1, ";" );
+               inserts.emplace_back( tokens[k].end, header.condition_open ? step + " && (" : step );
+            }
+            else if( header.condition_open )
+            {
+               inserts.emplace_back( tokens[k].begin, ")" );
+               header.condition_open = false;
+            }
+         }
+      }
+      
+      std::stable_sort( inserts.begin(), inserts.end(),
+                        []( const std::pair<size_t, std::string>& a, const std::pair<size_t, std::string>& b ) { return a.first < b.first; } );
+      
+      std::string metered;
+      metered.reserve( source.size() + inserts.size() * ( step.size() + 5 ) );
+      size_t copied = 0;
+      for( const auto& insert : inserts )
+      {
+         metered.append( source, copied, insert.first - copied );
+         metered += insert.second;
+         copied = insert.first;
+      }
+      metered.append( source, copied, std::string::npos );
+      return metered;
+   }
 }}
\ No newline at end of file
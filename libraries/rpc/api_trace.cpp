@@ -0,0 +1,288 @@
+#include <bts/rpc/api_trace.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/network/ip.hpp>
+#include <fc/network/tcp_socket.hpp>
+#include <fc/reflect/variant.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/thread/tss.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace bts { namespace rpc {
+
+   namespace detail
+   {
+      /** Written only by the thread that owns it and read only by the exporter */
+      class trace_ring
+      {
+         public:
+            explicit trace_ring( const uint32_t size )
+            :_slots( std::max<uint32_t>( size, 1 ) ){}
+
+            bool push( api_trace_record&& record )
+            {
+               const uint64_t head = _head.load( std::memory_order_relaxed );
+               if( head - _tail.load( std::memory_order_acquire ) >= _slots.size() )
+                  return false;
+               _slots[ head % _slots.size() ] = std::move( record );
+               _head.store( head + 1, std::memory_order_release );
+               return true;
+            }
+
+            template<typename Callback>
+            uint64_t drain( const Callback& callback )
+            {
+               const uint64_t head = _head.load( std::memory_order_acquire );
+               uint64_t tail = _tail.load( std::memory_order_relaxed );
+               const uint64_t count = head - tail;
+               for( ; tail != head; ++tail )
+                  callback( std::move( _slots[ tail % _slots.size() ] ) );
+               _tail.store( tail, std::memory_order_release );
+               return count;
+            }
+
+            bool empty()const
+            {
+               return _head.load( std::memory_order_acquire ) == _tail.load( std::memory_order_acquire );
+            }
+
+         private:
+            std::vector<api_trace_record>    _slots;
+            std::atomic<uint64_t>            _head{ 0 };
+            std::atomic<uint64_t>            _tail{ 0 };
+      };
+      typedef std::shared_ptr<trace_ring> trace_ring_ptr;
+
+      class api_tracer_impl
+      {
+         public:
+            std::atomic<bool>                            _enabled{ false };
+            std::atomic<uint64_t>                        _next_call_id{ 1 };
+            std::atomic<uint32_t>                        _sample_interval{ 0 };
+            std::atomic<uint64_t>                        _recorded{ 0 };
+            std::atomic<uint64_t>                        _dropped{ 0 };
+            std::atomic<uint64_t>                        _exported{ 0 };
+            api_trace_config                             _config;
+
+            /** each thread's ring, also held by _rings until the exporter has emptied it */
+            boost::thread_specific_ptr<trace_ring_ptr>   _thread_ring;
+            std::mutex                                   _rings_mutex;
+            std::vector<trace_ring_ptr>                  _rings;
+
+            std::mutex                                   _methods_mutex;
+            std::unordered_map<std::string, uint32_t>    _method_ids;
+            std::vector<std::string>                     _method_names;
+
+            std::unique_ptr<fc::thread>                  _export_thread;
+            fc::future<void>                             _export_loop_done;
+            std::atomic<bool>                            _stopping{ false };
+            std::ofstream                                _file;
+            std::unique_ptr<fc::tcp_socket>              _socket;
+
+            trace_ring& thread_ring()
+            {
+               trace_ring_ptr* ring = _thread_ring.get();
+               if( ring == nullptr )
+               {
+                  ring = new trace_ring_ptr( std::make_shared<trace_ring>( _config.ring_size ) );
+                  _thread_ring.reset( ring );
+                  std::lock_guard<std::mutex> lock( _rings_mutex );
+                  _rings.push_back( *ring );
+               }
+               return **ring;
+            }
+
+            void export_loop()
+            {
+               while( !_stopping.load() )
+               {
+                  export_pending();
+                  fc::usleep( fc::milliseconds( 100 ) );
+               }
+               export_pending();
+            }
+
+            void export_pending()
+            {
+               std::vector<trace_ring_ptr> rings;
+               {
+                  std::lock_guard<std::mutex> lock( _rings_mutex );
+                  // a ring only held here belongs to a thread that has exited
+                  _rings.erase( std::remove_if( _rings.begin(), _rings.end(), []( const trace_ring_ptr& ring )
+                                { return ring.use_count() == 1 && ring->empty(); } ), _rings.end() );
+                  rings = _rings;
+               }
+
+               std::string lines;
+               for( const trace_ring_ptr& ring : rings )
+               {
+                  _exported += ring->drain( [&]( api_trace_record&& record )
+                  {
+                     lines += fc::json::to_string( to_variant( record ) );
+                     lines += '\n';
+                  } );
+               }
+               if( !lines.empty() )
+                  write( lines );
+            }
+
+            fc::variant to_variant( const api_trace_record& record )
+            {
+               fc::mutable_variant_object object;
+               object( "call_id", record.call_id )
+                     ( "method", method_name( record.method_id ) )
+                     ( "start_time", record.start_time )
+                     ( "latency_us", record.latency_us )
+                     ( "args_size", record.args_size )
+                     ( "result_size", record.result_size )
+                     ( "error_code", record.error_code );
+               if( record.args.valid() )
+                  object( "args", *record.args );
+               if( record.result.valid() )
+                  object( "result", *record.result );
+               return fc::variant( object );
+            }
+
+            std::string method_name( const uint32_t method_id )
+            {
+               std::lock_guard<std::mutex> lock( _methods_mutex );
+               return method_id < _method_names.size() ? _method_names[method_id] : std::string();
+            }
+
+            void write( const std::string& lines )
+            {
+               if( _file.is_open() )
+               {
+                  _file << lines;
+                  _file.flush();
+               }
+               if( _config.endpoint.empty() )
+                  return;
+
+               try
+               {
+                  if( !_socket )
+                  {
+                     std::unique_ptr<fc::tcp_socket> socket( new fc::tcp_socket );
+                     socket->connect_to( fc::ip::endpoint::from_string( _config.endpoint ) );
+                     _socket = std::move( socket );
+                  }
+                  _socket->write( lines.data(), lines.size() );
+               }
+               catch( const fc::exception& e )
+               {
+                  // the records are lost; reconnect with the next batch
+                  wlog( "unable to send API trace to ${endpoint}: ${e}", ("endpoint",_config.endpoint)("e",e.to_string()) );
+                  _socket.reset();
+               }
+            }
+      };
+   } // detail
+
+   api_tracer& api_tracer::instance()
+   {
+      static api_tracer tracer;
+      return tracer;
+   }
+
+   api_tracer::api_tracer()
+   :my( new detail::api_tracer_impl() )
+   {
+   }
+
+   api_tracer::~api_tracer()
+   {
+   }
+
+   void api_tracer::start( const api_trace_config& config )
+   {
+      stop();
+      if( !config.enabled() )
+         return;
+
+      my->_config = config;
+      my->_sample_interval = config.sample_interval;
+      if( !config.file.string().empty() )
+         my->_file.open( config.file.string(), std::ios::out | std::ios::app );
+
+      my->_stopping = false;
+      my->_export_thread.reset( new fc::thread( "api_trace" ) );
+      detail::api_tracer_impl* impl = my.get();
+      my->_export_loop_done = my->_export_thread->async( [impl](){ impl->export_loop(); }, "api_trace_export" );
+      my->_enabled = true;
+   }
+
+   void api_tracer::stop()
+   {
+      if( !my->_export_thread )
+         return;
+
+      my->_enabled = false;
+      my->_stopping = true;
+      try
+      {
+         my->_export_loop_done.wait();
+      }
+      catch( const fc::exception& e )
+      {
+         wlog( "API trace exporter failed: ${e}", ("e",e.to_detail_string()) );
+      }
+      my->_export_thread->async( [this](){ my->_socket.reset(); }, "api_trace_close" ).wait();
+      my->_export_thread->quit();
+      my->_export_thread.reset();
+      if( my->_file.is_open() )
+         my->_file.close();
+   }
+
+   bool api_tracer::is_enabled()const
+   {
+      return my->_enabled.load( std::memory_order_relaxed );
+   }
+
+   uint32_t api_tracer::register_method( const std::string& method_name )
+   {
+      std::lock_guard<std::mutex> lock( my->_methods_mutex );
+      const auto iter = my->_method_ids.find( method_name );
+      if( iter != my->_method_ids.end() )
+         return iter->second;
+      const uint32_t method_id = uint32_t( my->_method_names.size() );
+      my->_method_names.push_back( method_name );
+      my->_method_ids[ method_name ] = method_id;
+      return method_id;
+   }
+
+   uint64_t api_tracer::next_call_id( bool& sampled )
+   {
+      const uint64_t call_id = my->_next_call_id.fetch_add( 1, std::memory_order_relaxed );
+      const uint32_t interval = my->_sample_interval.load( std::memory_order_relaxed );
+      sampled = interval != 0 && call_id % interval == 0;
+      return call_id;
+   }
+
+   void api_tracer::record( api_trace_record&& record )
+   {
+      if( my->thread_ring().push( std::move( record ) ) )
+         ++my->_recorded;
+      else
+         ++my->_dropped;
+   }
+
+   api_trace_stats api_tracer::get_stats()const
+   {
+      api_trace_stats stats;
+      stats.recorded = my->_recorded;
+      stats.dropped = my->_dropped;
+      stats.exported = my->_exported;
+      return stats;
+   }
+
+} } // bts::rpc
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <fc/filesystem.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/time.hpp>
+#include <fc/variant.hpp>
+
+#include <memory>
+#include <string>
+
+namespace bts { namespace rpc {
+
+   namespace detail { class api_tracer_impl; }
+
+   struct api_trace_config
+   {
+      fc::path       file;                   // records are appended here as JSON lines
+      std::string    endpoint;               // and/or sent to this local TCP endpoint, e.g. 127.0.0.1:8800
+      uint32_t       sample_interval = 0;    // keep the arguments and result of every Nth call; 0 for none
+      uint32_t       ring_size = 4096;       // records buffered per thread; more are dropped until exported
+
+      bool           enabled()const { return !file.string().empty() || !endpoint.empty(); }
+   };
+
+   struct api_trace_record
+   {
+      uint64_t                     call_id = 0;
+      uint32_t                     method_id = 0;
+      fc::time_point               start_time;
+      uint32_t                     latency_us = 0;
+      uint32_t                     args_size = 0;      // fc::raw size of the arguments
+      uint32_t                     result_size = 0;
+      int64_t                      error_code = 0;     // fc exception code, 0 if the call succeeded
+      fc::optional<fc::variants>   args;               // sampled calls only
+      fc::optional<fc::variant>    result;
+   };
+
+   struct api_trace_stats
+   {
+      uint64_t    recorded = 0;
+      uint64_t    dropped = 0;    // found a full ring
+      uint64_t    exported = 0;
+   };
+
+   /**
+    * @class api_tracer
+    *
+    *  Records one api_trace_record per RPC call in a ring buffer owned by the calling thread,
+    *  without taking a lock. A separate thread drains the rings and writes the records out
+    *  as JSON lines, so a call only pays for timing and measuring its payload. Arguments and
+    *  results are kept only for sampled calls.
+    */
+   class api_tracer
+   {
+      public:
+         static api_tracer&    instance();
+
+         void                  start( const api_trace_config& config );
+         /** Writes out what is still buffered and stops exporting */
+         void                  stop();
+         bool                  is_enabled()const;
+
+         /** Ids are assigned once per method name and never reused */
+         uint32_t              register_method( const std::string& method_name );
+
+         /** The id for a new call; sampled is set when its payload should be recorded */
+         uint64_t              next_call_id( bool& sampled );
+         void                  record( api_trace_record&& record );
+
+         api_trace_stats       get_stats()const;
+
+      private:
+         api_tracer();
+         ~api_tracer();
+
+         std::unique_ptr<detail::api_tracer_impl> my;
+   };
+
+} } // bts::rpc
+
+FC_REFLECT( bts::rpc::api_trace_config, (file)(endpoint)(sample_interval)(ring_size) )
+FC_REFLECT( bts::rpc::api_trace_stats, (recorded)(dropped)(exported) )
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <bts/blockchain/chain_database.hpp>
+
+#include <functional>
+
+namespace bts { namespace rpc {
+
+   using bts::blockchain::asset_id_type;
+   using bts::blockchain::chain_database_ptr;
+   using bts::blockchain::full_block;
+   using bts::blockchain::market_order;
+   using bts::blockchain::market_transaction;
+   using bts::blockchain::pending_chain_state_ptr;
+
+   /**
+    *  What changed in one market in one block. Order changes carry the new state of each
+    *  order; a zero balance means the order was removed. Sequence numbers count up by one
+    *  per subscription starting from the snapshot at 0, so a client that sees a gap has
+    *  missed an update and should resubscribe.
+    */
+   struct market_feed_update
+   {
+      asset_id_type                     quote_id;
+      asset_id_type                     base_id;
+      uint64_t                          sequence = 0;
+      uint32_t                          block_num = 0;
+      bool                              snapshot = false; // orders is the whole book; replace any local copy
+      bool                              undo = false;     // block_num was popped and these changes revert it
+      std::vector<market_order>         orders;
+      std::vector<market_transaction>   fills;
+   };
+
+   /**
+    * @class market_feed
+    *
+    *  Pushes order book changes and fills to subscribers of individual markets as blocks
+    *  are pushed and popped, so clients do not need to poll the full book every block.
+    *  Subscribers are opaque keys; updates are delivered through the sink given when
+    *  subscribing.
+    */
+   class market_feed : public bts::blockchain::chain_observer
+   {
+      public:
+         typedef std::function<void( const market_feed_update& )> sink_type;
+
+         market_feed( const chain_database_ptr& chain );
+         virtual ~market_feed()override;
+
+         /**
+          * Returns the current book as a snapshot with sequence 0, at the chain's head block. Changes of
+          * blocks up to that one that are still queued are in the snapshot and are not sent again.
+          */
+         market_feed_update   subscribe( const void* subscriber, const asset_id_type quote_id,
+                                         const asset_id_type base_id, const sink_type& sink );
+         bool                 unsubscribe( const void* subscriber, const asset_id_type quote_id,
+                                           const asset_id_type base_id );
+         void                 unsubscribe_all( const void* subscriber );
+
+         virtual void         block_pushed( const full_block& block_data )override;
+         virtual void         block_popped( const pending_chain_state_ptr& undo_state )override;
+         virtual void         state_changed( const pending_chain_state_ptr& state )override;
+
+      private:
+         struct subscription
+         {
+            sink_type   sink;
+            uint64_t    sequence = 0;
+            uint32_t    snapshot_block_num = 0;
+            bool        behind_snapshot = false; // Until the tracked head reaches snapshot_block_num
+         };
+         typedef std::pair<asset_id_type, asset_id_type> market_key;
+
+         chain_database_ptr                                          _chain;
+         std::map<market_key, std::map<const void*, subscription>>   _subscriptions;
+
+         /*
+          * block_pushed is skipped while syncing, but every pushed or popped block gets exactly one
+          * state_changed, queued after its block_popped, so the head is tracked by counting them
+          */
+         uint32_t                                                    _block_num = 0;
+         bool                                                        _undo = false;
+   };
+
+} } // bts::rpc
+
+FC_REFLECT( bts::rpc::market_feed_update, (quote_id)(base_id)(sequence)(block_num)(snapshot)(undo)(orders)(fills) )
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <fc/variant.hpp>
+
+#include <string>
+#include <vector>
+
+namespace bts { namespace rpc {
+
+   /**
+    *  How a JSON-RPC reply is serialized. Requests are always JSON; only replies, which can
+    *  be large, may use a binary encoding.
+    *
+    *  raw_rpc_encoding packs the reply with fc::raw as a variant object, the form
+    *  fc::raw::unpack into an fc::variant reads back. msgpack_rpc_encoding writes the
+    *  same object as MessagePack, with integers in native width instead of the strings
+    *  JSON uses for large values.
+    */
+   enum rpc_encoding
+   {
+      json_rpc_encoding    = 0,
+      raw_rpc_encoding     = 1,
+      msgpack_rpc_encoding = 2
+   };
+
+   /** The first byte a client sends on a TCP RPC connection to switch it to framed binary replies */
+   const char binary_rpc_connection_magic = '\x01';
+   const uint32_t max_binary_rpc_request_size = 16 * 1024 * 1024;
+
+   /** The best encoding listed in an HTTP Accept header, JSON if none is supported */
+   rpc_encoding         rpc_encoding_from_accept_header( const std::string& accept );
+   const char*          rpc_encoding_content_type( const rpc_encoding encoding );
+
+   /**
+    *  A reply serialized on both sides of its id. Every encoding writes the id first, so
+    *  a reply that is reused for another request only needs the new id written between
+    *  head and tail.
+    */
+   struct encoded_rpc_reply
+   {
+      std::vector<char>    head;
+      std::vector<char>    tail;
+
+      std::vector<char>    with_id( const rpc_encoding encoding, const fc::variant& id )const;
+      size_t               size()const { return head.size() + tail.size(); }
+   };
+
+   encoded_rpc_reply    encode_rpc_reply_without_id( const rpc_encoding encoding, const fc::variant& result,
+                                                     const fc::variant* error = nullptr );
+
+   /** Serializes {"id":id,"result":result}, or {"id":id,"error":error} when error is given */
+   std::vector<char>    encode_rpc_reply( const rpc_encoding encoding, const fc::variant& id,
+                                          const fc::variant& result, const fc::variant* error = nullptr );
+
+   void                 msgpack_pack( std::vector<char>& out, const fc::variant& value );
+
+} } // bts::rpc
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <bts/api/api_metadata.hpp>
+#include <bts/blockchain/chain_database.hpp>
+#include <bts/rpc/rpc_encoding.hpp>
+
+#include <list>
+#include <unordered_map>
+
+namespace bts { namespace rpc {
+
+   struct rpc_response_cache_stats
+   {
+      uint64_t    hits = 0;
+      uint64_t    misses = 0;
+      uint64_t    evictions = 0;
+      uint64_t    invalidations = 0;  // times the cache was emptied because the head block changed
+      uint64_t    entries = 0;
+      uint64_t    size = 0;           // bytes held by keys and replies
+      uint64_t    max_size = 0;
+   };
+
+   /**
+    * @class rpc_response_cache
+    *
+    *  Serialized replies of read only calls, valid until the head block changes. Replies are
+    *  kept without their id (see encoded_rpc_reply) so a hit only writes the id of the new
+    *  request; nothing is parsed or re-encoded. The least recently used replies are dropped
+    *  once the keys and replies held exceed max_size bytes.
+    */
+   class rpc_response_cache : public bts::blockchain::chain_observer
+   {
+      public:
+         rpc_response_cache( const bts::blockchain::chain_database_ptr& chain, const uint64_t max_size );
+         virtual ~rpc_response_cache()override;
+
+         /** Methods flagged cached in the API description that only read the chain */
+         static bool                is_cacheable( const bts::api::method_data& method );
+
+         /** Incremented every time the cache is invalidated */
+         uint64_t                   generation()const { return _generation; }
+
+         /** Sets reply to the cached reply with id spliced in; false on a miss */
+         bool                       lookup( const rpc_encoding encoding, const std::string& key, const fc::variant& id,
+                                            std::vector<char>& reply );
+
+         /** Ignored if the cache was invalidated since generation, as reply may be stale */
+         void                       store( const rpc_encoding encoding, const std::string& key,
+                                           const encoded_rpc_reply& reply, const uint64_t generation );
+
+         void                       clear();
+         void                       set_max_size( const uint64_t max_size );
+         rpc_response_cache_stats   get_stats()const;
+
+         virtual void               block_pushed( const bts::blockchain::full_block& )override;
+         virtual void               block_popped( const bts::blockchain::pending_chain_state_ptr& )override;
+         virtual void               state_changed( const bts::blockchain::pending_chain_state_ptr& )override;
+
+      private:
+         struct entry
+         {
+            std::string          key;
+            encoded_rpc_reply    reply;
+
+            uint64_t             size()const { return key.size() + reply.size(); }
+         };
+         typedef std::list<entry> entry_list;
+
+         void                       invalidate();
+         void                       evict_to( const uint64_t max_size );
+
+         bts::blockchain::chain_database_ptr                       _chain;
+         entry_list                                                _entries; // most recently used first
+         std::unordered_map<std::string, entry_list::iterator>     _index;
+         uint64_t                                                  _generation = 0;
+         rpc_response_cache_stats                                  _stats;
+   };
+
+} } // bts::rpc
+
+FC_REFLECT( bts::rpc::rpc_response_cache_stats, (hits)(misses)(evictions)(invalidations)(entries)(size)(max_size) )
@@ -5,6 +5,7 @@
 #include <fc/log/log_message.hpp>
 #include <bts/api/api_metadata.hpp>
 #include <bts/rpc_stubs/common_api_rpc_server.hpp>
+#include <bts/rpc/rpc_response_cache.hpp>
 #include <bts/client/client.hpp>
 #include <fc/network/http/server.hpp>
 
@@ -17,6 +18,7 @@ namespace bts { namespace rpc {
 
   typedef std::map<std::string, bts::api::method_data> method_map_type;
   typedef std::function<void( const fc::path& filename, const fc::http::server::response&)> http_callback_type; 
+  typedef std::function<void( size_t index, const fc::variant& result )> batch_result_callback;
   /**
   *  @class rpc_server
   *  @brief provides a json-rpc interface to the bts client
@@ -34,6 +36,12 @@ namespace bts { namespace rpc {
        /// used to invoke json methods from the cli without going over the network
        fc::variant direct_invoke_method(const std::string& method_name, const fc::variants& arguments);
 
+       /// calls method_name once per entry of parameters_list, read only blockchain calls in parallel;
+       /// on_result, if given, gets each result in order as soon as it is ready
+       fc::variants batch_invoke_method( const std::string& method_name,
+                                         const std::vector<fc::variants>& parameters_list,
+                                         const batch_result_callback& on_result = batch_result_callback() );
+
        const bts::api::method_data& get_method_data(const std::string& method_name);
        std::vector<bts::api::method_data> get_all_method_data() const;
 
@@ -44,6 +52,8 @@ namespace bts { namespace rpc {
 
        method_map_type meta_help()const;
 
+       rpc_response_cache_stats get_response_cache_stats()const;
+
        void set_http_file_callback(  const http_callback_type& );
 
        fc::optional<fc::ip::endpoint> get_rpc_endpoint() const;
@@ -0,0 +1,146 @@
+#include <bts/rpc/market_feed.hpp>
+
+namespace bts { namespace rpc {
+
+   market_feed::market_feed( const chain_database_ptr& chain )
+   :_chain( chain ),_block_num( chain->get_head_block_num() )
+   {
+      _chain->add_observer( this );
+   }
+
+   market_feed::~market_feed()
+   {
+      _chain->remove_observer( this );
+   }
+
+   market_feed_update market_feed::subscribe( const void* subscriber, const asset_id_type quote_id,
+                                              const asset_id_type base_id, const sink_type& sink )
+   { try {
+      FC_ASSERT( quote_id > base_id, "the quote asset id must be greater than the base asset id" );
+
+      const std::string quote_symbol = _chain->get_asset_symbol( quote_id );
+      const std::string base_symbol = _chain->get_asset_symbol( base_id );
+
+      market_feed_update update;
+      update.quote_id = quote_id;
+      update.base_id = base_id;
+      update.block_num = _chain->get_head_block_num();
+      update.snapshot = true;
+      update.orders = _chain->get_market_bids( quote_symbol, base_symbol );
+      const std::vector<market_order> asks = _chain->get_market_asks( quote_symbol, base_symbol );
+      update.orders.insert( update.orders.end(), asks.begin(), asks.end() );
+
+      subscription& sub = _subscriptions[ market_key( quote_id, base_id ) ][ subscriber ];
+      sub.sink = sink;
+      sub.sequence = 0;
+      sub.snapshot_block_num = update.block_num;
+      // The book already has the changes of blocks whose state_changed is still queued
+      sub.behind_snapshot = _block_num != update.block_num;
+      return update;
+   } FC_CAPTURE_AND_RETHROW( (quote_id)(base_id) ) }
+
+   bool market_feed::unsubscribe( const void* subscriber, const asset_id_type quote_id, const asset_id_type base_id )
+   {
+      const auto iter = _subscriptions.find( market_key( quote_id, base_id ) );
+      if( iter == _subscriptions.end() || iter->second.erase( subscriber ) == 0 )
+         return false;
+      if( iter->second.empty() )
+         _subscriptions.erase( iter );
+      return true;
+   }
+
+   void market_feed::unsubscribe_all( const void* subscriber )
+   {
+      for( auto iter = _subscriptions.begin(); iter != _subscriptions.end(); )
+      {
+         iter->second.erase( subscriber );
+         if( iter->second.empty() )
+            iter = _subscriptions.erase( iter );
+         else
+            ++iter;
+      }
+   }
+
+   void market_feed::block_pushed( const full_block& )
+   {
+   }
+
+   void market_feed::block_popped( const pending_chain_state_ptr& )
+   {
+      _undo = true;
+   }
+
+   void market_feed::state_changed( const pending_chain_state_ptr& state )
+   { try {
+      const bool undo = _undo;
+      const uint32_t block_num = undo ? _block_num-- : ++_block_num;
+      const uint32_t head_block_num = _block_num;
+      _undo = false;
+      if( _subscriptions.empty() ) return;
+
+      std::map<market_key, market_feed_update> updates;
+      const auto update_for = [&]( const asset_id_type quote_id, const asset_id_type base_id ) -> market_feed_update*
+      {
+         const market_key key( quote_id, base_id );
+         if( _subscriptions.count( key ) == 0 ) return nullptr;
+         market_feed_update& update = updates[ key ];
+         update.quote_id = quote_id;
+         update.base_id = base_id;
+         return &update;
+      };
+
+      for( const auto& item : state->bids )
+      {
+         if( market_feed_update* update = update_for( item.first.order_price.quote_asset_id, item.first.order_price.base_asset_id ) )
+            update->orders.emplace_back( bts::blockchain::bid_order, item.first, item.second );
+      }
+      for( const auto& item : state->asks )
+      {
+         if( market_feed_update* update = update_for( item.first.order_price.quote_asset_id, item.first.order_price.base_asset_id ) )
+            update->orders.emplace_back( bts::blockchain::ask_order, item.first, item.second );
+      }
+      for( const market_transaction& fill : state->market_transactions )
+      {
+         if( market_feed_update* update = update_for( fill.bid_price.quote_asset_id, fill.bid_price.base_asset_id ) )
+            update->fills.push_back( fill );
+      }
+
+      // Sinks may yield and let subscriptions change, so number every update before sending any
+      std::vector<std::pair<sink_type, market_feed_update>> deliveries;
+      for( auto& item : updates )
+      {
+         market_feed_update& update = item.second;
+         update.block_num = block_num;
+         update.undo = undo;
+         for( auto& sub : _subscriptions[ item.first ] )
+         {
+            if( sub.second.behind_snapshot ) continue;
+            update.sequence = ++sub.second.sequence;
+            deliveries.emplace_back( sub.second.sink, update );
+         }
+      }
+
+      // Changes up to the snapshot's block were dropped above; the ones after it are new to the subscriber
+      for( auto& market : _subscriptions )
+      {
+         for( auto& sub : market.second )
+         {
+            if( sub.second.behind_snapshot && head_block_num == sub.second.snapshot_block_num )
+               sub.second.behind_snapshot = false;
+         }
+      }
+
+      for( const auto& delivery : deliveries )
+      {
+         try
+         {
+            delivery.first( delivery.second );
+         }
+         catch( const fc::exception& e )
+         {
+            wlog( "failed to deliver market update: ${e}", ("e",e.to_detail_string()) );
+         }
+      }
+   } FC_CAPTURE_AND_RETHROW() }
+
+} } // bts::rpc
@@ -0,0 +1,269 @@
+#include <bts/rpc/rpc_encoding.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/iostream.hpp>
+#include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/raw_variant.hpp>
+#include <fc/io/varint.hpp>
+
+#include <cstring>
+
+namespace bts { namespace rpc {
+
+   namespace
+   {
+      const char* const raw_content_type = "application/x-fc-raw";
+      const char* const msgpack_content_type = "application/x-msgpack";
+
+      void put_byte( std::vector<char>& out, const uint8_t byte )
+      {
+         out.push_back( char( byte ) );
+      }
+
+      /** MessagePack stores every multi-byte number big-endian */
+      template<typename T>
+      void put_big_endian( std::vector<char>& out, const uint8_t tag, const T value )
+      {
+         put_byte( out, tag );
+         for( int shift = int( sizeof( T ) * 8 ) - 8; shift >= 0; shift -= 8 )
+            put_byte( out, uint8_t( uint64_t( value ) >> shift ) );
+      }
+
+      void put_length( std::vector<char>& out, const size_t length, const uint8_t fix_tag, const size_t fix_limit,
+                       const uint8_t tag8, const uint8_t tag16, const uint8_t tag32 )
+      {
+         if( length < fix_limit )
+            put_byte( out, uint8_t( fix_tag | length ) );
+         else if( tag8 != 0 && length <= 0xff )
+            put_big_endian( out, tag8, uint8_t( length ) );
+         else if( length <= 0xffff )
+            put_big_endian( out, tag16, uint16_t( length ) );
+         else
+         {
+            FC_ASSERT( length <= 0xffffffff, "value too large for MessagePack" );
+            put_big_endian( out, tag32, uint32_t( length ) );
+         }
+      }
+
+      void put_bytes( std::vector<char>& out, const char* data, const size_t length )
+      {
+         out.insert( out.end(), data, data + length );
+      }
+
+      void put_string( std::vector<char>& out, const std::string& value )
+      {
+         put_length( out, value.size(), 0xa0, 32, 0xd9, 0xda, 0xdb );
+         put_bytes( out, value.data(), value.size() );
+      }
+
+      void put_uint( std::vector<char>& out, const uint64_t value )
+      {
+         if( value < 0x80 )              put_byte( out, uint8_t( value ) );
+         else if( value <= 0xff )        put_big_endian( out, 0xcc, uint8_t( value ) );
+         else if( value <= 0xffff )      put_big_endian( out, 0xcd, uint16_t( value ) );
+         else if( value <= 0xffffffff )  put_big_endian( out, 0xce, uint32_t( value ) );
+         else                            put_big_endian( out, 0xcf, value );
+      }
+
+      void put_int( std::vector<char>& out, const int64_t value )
+      {
+         if( value >= 0 )                put_uint( out, uint64_t( value ) );
+         else if( value >= -32 )         put_byte( out, uint8_t( value ) );
+         else if( value >= INT8_MIN )    put_big_endian( out, 0xd0, uint8_t( value ) );
+         else if( value >= INT16_MIN )   put_big_endian( out, 0xd1, uint16_t( value ) );
+         else if( value >= INT32_MIN )   put_big_endian( out, 0xd2, uint32_t( value ) );
+         else                            put_big_endian( out, 0xd3, uint64_t( value ) );
+      }
+
+      void put_double( std::vector<char>& out, const double value )
+      {
+         uint64_t bits;
+         static_assert( sizeof( bits ) == sizeof( value ), "unexpected double size" );
+         std::memcpy( &bits, &value, sizeof( bits ) );
+         put_big_endian( out, 0xcb, bits );
+      }
+
+      /** Lets fc::json::to_stream write straight into a reply buffer */
+      class vector_ostream : public fc::ostream
+      {
+         public:
+            explicit vector_ostream( std::vector<char>& out ) : _out( out ) {}
+
+            virtual size_t writesome( const char* buffer, size_t len )
+            {
+               put_bytes( _out, buffer, len );
+               return len;
+            }
+            virtual size_t writesome( const std::shared_ptr<const char>& buf, size_t len, size_t offset )
+            {
+               return writesome( buf.get() + offset, len );
+            }
+            virtual void close() {}
+            virtual void flush() {}
+
+         private:
+            std::vector<char>& _out;
+      };
+
+      void put_json( std::vector<char>& out, const fc::variant& value )
+      {
+         vector_ostream stream( out );
+         fc::json::to_stream( stream, value );
+      }
+
+      template<typename T>
+      void put_raw( std::vector<char>& out, const T& value )
+      {
+         const std::vector<char> packed = fc::raw::pack( value );
+         put_bytes( out, packed.data(), packed.size() );
+      }
+   }
+
+   rpc_encoding rpc_encoding_from_accept_header( const std::string& accept )
+   {
+      // Binary types are only used when asked for by name; */* and anything else mean JSON
+      const bool wants_msgpack = accept.find( msgpack_content_type ) != std::string::npos
+                                 || accept.find( "application/msgpack" ) != std::string::npos;
+      const bool wants_raw = accept.find( raw_content_type ) != std::string::npos;
+      if( wants_msgpack && wants_raw )
+         return accept.find( raw_content_type ) < accept.find( "msgpack" ) ? raw_rpc_encoding : msgpack_rpc_encoding;
+      if( wants_raw ) return raw_rpc_encoding;
+      if( wants_msgpack ) return msgpack_rpc_encoding;
+      return json_rpc_encoding;
+   }
+
+   const char* rpc_encoding_content_type( const rpc_encoding encoding )
+   {
+      switch( encoding )
+      {
+         case raw_rpc_encoding:     return raw_content_type;
+         case msgpack_rpc_encoding: return msgpack_content_type;
+         default:                   return "application/json";
+      }
+   }
+
+   std::vector<char> encoded_rpc_reply::with_id( const rpc_encoding encoding, const fc::variant& id )const
+   {
+      std::vector<char> out;
+      out.reserve( size() + 16 );
+      put_bytes( out, head.data(), head.size() );
+      switch( encoding )
+      {
+         case raw_rpc_encoding:
+            put_raw( out, id );
+            break;
+         case msgpack_rpc_encoding:
+            msgpack_pack( out, id );
+            break;
+         default:
+            put_json( out, id );
+            break;
+      }
+      put_bytes( out, tail.data(), tail.size() );
+      return out;
+   }
+
+   encoded_rpc_reply encode_rpc_reply_without_id( const rpc_encoding encoding, const fc::variant& result,
+                                                  const fc::variant* error )
+   {
+      const fc::variant& value = error != nullptr ? *error : result;
+      const std::string value_name = error != nullptr ? "error" : "result";
+
+      encoded_rpc_reply reply;
+      switch( encoding )
+      {
+         case raw_rpc_encoding:
+         {
+            // Laid out exactly as fc::raw::pack of a variant holding the object
+            put_raw( reply.head, uint8_t( fc::variant::object_type ) );
+            put_raw( reply.head, fc::unsigned_int( 2 ) );
+            put_raw( reply.head, std::string( "id" ) );
+            put_raw( reply.tail, value_name );
+            put_raw( reply.tail, value );
+            break;
+         }
+         case msgpack_rpc_encoding:
+         {
+            put_byte( reply.head, 0x82 );
+            put_string( reply.head, "id" );
+            put_string( reply.tail, value_name );
+            msgpack_pack( reply.tail, value );
+            break;
+         }
+         default:
+         {
+            // Write the envelope around the serialized value instead of copying the value into an object first
+            static const char id_prefix[] = "{\"id\":";
+            put_bytes( reply.head, id_prefix, sizeof( id_prefix ) - 1 );
+            put_bytes( reply.tail, ",\"", 2 );
+            put_bytes( reply.tail, value_name.data(), value_name.size() );
+            put_bytes( reply.tail, "\":", 2 );
+            put_json( reply.tail, value );
+            put_byte( reply.tail, '}' );
+            break;
+         }
+      }
+      return reply;
+   }
+
+   std::vector<char> encode_rpc_reply( const rpc_encoding encoding, const fc::variant& id,
+                                       const fc::variant& result, const fc::variant* error )
+   {
+      return encode_rpc_reply_without_id( encoding, result, error ).with_id( encoding, id );
+   }
+
+   void msgpack_pack( std::vector<char>& out, const fc::variant& value )
+   {
+      switch( value.get_type() )
+      {
+         case fc::variant::null_type:
+            put_byte( out, 0xc0 );
+            break;
+         case fc::variant::int64_type:
+            put_int( out, value.as_int64() );
+            break;
+         case fc::variant::uint64_type:
+            put_uint( out, value.as_uint64() );
+            break;
+         case fc::variant::double_type:
+            put_double( out, value.as_double() );
+            break;
+         case fc::variant::bool_type:
+            put_byte( out, value.as_bool() ? 0xc3 : 0xc2 );
+            break;
+         case fc::variant::string_type:
+            put_string( out, value.get_string() );
+            break;
+         case fc::variant::array_type:
+         {
+            const fc::variants& items = value.get_array();
+            put_length( out, items.size(), 0x90, 16, 0, 0xdc, 0xdd );
+            for( const fc::variant& item : items )
+               msgpack_pack( out, item );
+            break;
+         }
+         case fc::variant::object_type:
+         {
+            const fc::variant_object& object = value.get_object();
+            put_length( out, object.size(), 0x80, 16, 0, 0xde, 0xdf );
+            for( const auto& entry : object )
+            {
+               put_string( out, entry.key() );
+               msgpack_pack( out, entry.value() );
+            }
+            break;
+         }
+         case fc::variant::blob_type:
+         {
+            const fc::blob blob = value.as_blob();
+            put_length( out, blob.data.size(), 0, 0, 0xc4, 0xc5, 0xc6 );
+            put_bytes( out, blob.data.data(), blob.data.size() );
+            break;
+         }
+         default:
+            FC_THROW_EXCEPTION( fc::invalid_arg_exception, "cannot encode variant type ${t}", ("t",int( value.get_type() )) );
+      }
+   }
+
+} } // bts::rpc
@@ -0,0 +1,129 @@
+#include <bts/rpc/rpc_response_cache.hpp>
+
+namespace bts { namespace rpc {
+
+   namespace
+   {
+      /** The same call is cached separately for each encoding it was asked for in */
+      std::string entry_key( const rpc_encoding encoding, const std::string& key )
+      {
+         std::string result;
+         result.reserve( key.size() + 1 );
+         result.push_back( char( '0' + encoding ) );
+         result += key;
+         return result;
+      }
+   }
+
+   rpc_response_cache::rpc_response_cache( const bts::blockchain::chain_database_ptr& chain, const uint64_t max_size )
+   :_chain( chain )
+   {
+      _stats.max_size = max_size;
+      _chain->add_observer( this );
+   }
+
+   rpc_response_cache::~rpc_response_cache()
+   {
+      _chain->remove_observer( this );
+   }
+
+   bool rpc_response_cache::is_cacheable( const bts::api::method_data& method )
+   {
+      // Wallet state can change without a new block, so nothing that needs the wallet is cached
+      return method.cached && method.is_const
+             && (method.prerequisites & (bts::api::wallet_open | bts::api::wallet_unlocked)) == 0;
+   }
+
+   bool rpc_response_cache::lookup( const rpc_encoding encoding, const std::string& key, const fc::variant& id,
+                                    std::vector<char>& reply )
+   {
+      const auto iter = _index.find( entry_key( encoding, key ) );
+      if( iter == _index.end() )
+      {
+         ++_stats.misses;
+         return false;
+      }
+      ++_stats.hits;
+      _entries.splice( _entries.begin(), _entries, iter->second );
+      reply = iter->second->reply.with_id( encoding, id );
+      return true;
+   }
+
+   void rpc_response_cache::store( const rpc_encoding encoding, const std::string& key,
+                                   const encoded_rpc_reply& reply, const uint64_t generation )
+   {
+      if( generation != _generation ) return;
+
+      entry new_entry{ entry_key( encoding, key ), reply };
+      if( new_entry.size() > _stats.max_size ) return;
+
+      const auto iter = _index.find( new_entry.key );
+      if( iter != _index.end() )
+      {
+         _stats.size -= iter->second->size();
+         _entries.erase( iter->second );
+         _index.erase( iter );
+      }
+
+      evict_to( _stats.max_size - new_entry.size() );
+      _stats.size += new_entry.size();
+      _entries.push_front( std::move( new_entry ) );
+      _index[ _entries.front().key ] = _entries.begin();
+   }
+
+   void rpc_response_cache::clear()
+   {
+      _entries.clear();
+      _index.clear();
+      _stats.size = 0;
+   }
+
+   void rpc_response_cache::set_max_size( const uint64_t max_size )
+   {
+      _stats.max_size = max_size;
+      evict_to( max_size );
+   }
+
+   rpc_response_cache_stats rpc_response_cache::get_stats()const
+   {
+      rpc_response_cache_stats stats = _stats;
+      stats.entries = _entries.size();
+      return stats;
+   }
+
+   void rpc_response_cache::block_pushed( const bts::blockchain::full_block& )
+   {
+      invalidate();
+   }
+
+   void rpc_response_cache::block_popped( const bts::blockchain::pending_chain_state_ptr& )
+   {
+      invalidate();
+   }
+
+   /** block_pushed is skipped while syncing, but every pushed or popped block also reaches here */
+   void rpc_response_cache::state_changed( const bts::blockchain::pending_chain_state_ptr& )
+   {
+      invalidate();
+   }
+
+   void rpc_response_cache::invalidate()
+   {
+      ++_generation;
+      if( _entries.empty() ) return;
+      ++_stats.invalidations;
+      clear();
+   }
+
+   void rpc_response_cache::evict_to( const uint64_t max_size )
+   {
+      while( _stats.size > max_size && !_entries.empty() )
+      {
+         _stats.size -= _entries.back().size();
+         _index.erase( _entries.back().key );
+         _entries.pop_back();
+         ++_stats.evictions;
+      }
+   }
+
+} } // bts::rpc
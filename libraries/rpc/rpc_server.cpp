@@ -1,10 +1,13 @@
 #define DEFAULT_LOGGER "rpc"
 
 #include <bts/wallet/exceptions.hpp>
+#include <bts/rpc/api_trace.hpp>
 #include <bts/rpc/exceptions.hpp>
+#include <bts/rpc/market_feed.hpp>
+#include <bts/rpc/rpc_encoding.hpp>
+#include <bts/rpc/rpc_response_cache.hpp>
 #include <bts/rpc/rpc_server.hpp>
 #include <bts/blockchain/config.hpp>
-#include <bts/blockchain/time.hpp>
 #include <bts/utilities/git_revision.hpp>
 #include <bts/utilities/key_conversion.hpp>
 #include <bts/utilities/padding_ostream.hpp>
@@ -17,6 +20,8 @@
 
 #include <fc/interprocess/file_mapping.hpp>
 #include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/raw_variant.hpp>
 #include <fc/network/http/server.hpp>
 #include <fc/network/tcp_socket.hpp>
 #include <fc/crypto/digest.hpp>
@@ -28,6 +33,7 @@
 #include <fc/thread/mutex.hpp>
 #include <fc/thread/scoped_lock.hpp>
 
+#include <deque>
 #include <iomanip>
 #include <limits>
 #include <sstream>
@@ -55,11 +61,22 @@ namespace bts { namespace rpc {
          fc::thread*                                       _thread;
          http_callback_type                                _http_file_callback;
          std::unordered_set<fc::rpc::json_connection_ptr>  _open_json_connections;
-         fc::mutex                                         _rpc_mutex; // locked to prevent executing two rpc calls at once
+
+         /** a TCP connection that asked for framed binary replies, see binary_connection_loop() */
+         struct binary_connection
+         {
+            std::shared_ptr<fc::buffered_istream>          in;
+            std::shared_ptr<fc::buffered_ostream>          out;
+            std::function<void()>                          close_socket;
+            bool                                           authenticated = false;
+         };
+         typedef std::shared_ptr<binary_connection>       binary_connection_ptr;
+         std::unordered_set<binary_connection_ptr>         _open_binary_connections;
+         fc::mutex                                         _rpc_mutex; // locked to prevent executing two rpc calls at once on the client thread
 
          bool                                              _cache_enabled = true;
-         fc::time_point                                    _last_cache_clear_time;
-         std::unordered_map<string,string>                 _call_cache;
+         uint64_t                                          _cache_max_size = 0;
+         std::unique_ptr<rpc_response_cache>               _response_cache; // created with the first cacheable call
 
          typedef std::map<std::string, bts::api::method_data> method_map_type;
          method_map_type _method_map;
@@ -70,6 +87,17 @@ namespace bts { namespace rpc {
          /** the set of connections that have successfully logged in */
          std::unordered_set<fc::rpc::json_connection*> _authenticated_connection_set;
 
+         /** pushes market updates to json connections; created with the first connection */
+         std::unique_ptr<market_feed>                      _market_feed;
+
+         /** api_tracer ids of the registered methods, by name */
+         std::unordered_map<std::string, uint32_t>         _trace_method_ids;
+         bool                                              _started_trace = false;
+
+         /** run read only blockchain calls against a chain snapshot, see is_concurrent_read() */
+         std::vector<std::unique_ptr<fc::thread>>          _reader_threads;
+         uint32_t                                          _next_reader_thread = 0;
+
          rpc_server_impl(bts::client::client* client) :
            _client(client),
            _on_quit_promise(new fc::promise<void>("rpc_quit"))
@@ -116,7 +144,7 @@ namespace bts { namespace rpc {
            return help_string;
          }
 
-        void add_content_type_header(const fc::string& path, const fc::http::server::response& s ) {
+        void add_content_type_header(const fc::string& path, const fc::http::server::response& s, const fc::string& accept ) {
             static map<string, string> mime_types
             {   {"png", "image/png"},
                 {"jpg", "image/jpeg"},
@@ -131,7 +159,7 @@ namespace bts { namespace rpc {
             };
 
             if( path == "/rpc") {
-                s.add_header("Content-Type",  "application/json");
+                s.add_header("Content-Type",  rpc_encoding_content_type( rpc_encoding_from_accept_header( accept ) ));
                 s.add_header("Cache-Control",  "no-cache, no-store, must-revalidate");
                 s.add_header("Pragma", "no-cache");
                 s.add_header("Expires","0");
@@ -208,7 +236,7 @@ namespace bts { namespace rpc {
                 FC_ASSERT( pos == std::string::npos );
 
                 if( path == "/" ) path = "/index.html";
-                 add_content_type_header(path,s);
+                 add_content_type_header(path,s,r.get_header("Accept"));
 
                 auto filename = _config.htdocs / path.substr(1,std::string::npos);
                 if( r.path == fc::path("/rpc")
@@ -324,19 +352,78 @@ namespace bts { namespace rpc {
              }
          }
 
-         static string send_and_log_reply( const fc::http::server::response& s,
-                                           const fc::http::reply::status_code status,
-                                           const fc::path& path,
-                                           const string& method,
-                                           const fc::mutable_variant_object& json)
+         static void send_reply_bytes( const fc::http::server::response& s,
+                                       const fc::http::reply::status_code status,
+                                       const fc::path& path,
+                                       const string& method,
+                                       const rpc_encoding encoding,
+                                       const std::vector<char>& reply )
          {
              s.set_status( status );
-             auto reply = fc::json::to_string( json );
              s.set_length( reply.size() );
-             s.write( reply.c_str(), reply.size() );
-             auto reply_log = reply.size() > 253 ? reply.substr(0,253) + ".." :  reply;
+             s.write( reply.data(), reply.size() );
+             string reply_log;
+             if( encoding == json_rpc_encoding )
+                 reply_log = reply.size() > 253 ? string( reply.data(), 253 ) + ".." : string( reply.begin(), reply.end() );
+             else
+                 reply_log = fc::to_string( uint64_t( reply.size() ) ) + " bytes";
              fc_ilog( fc::logger::get("rpc"), "Result ${path} ${method}: ${reply}", ("path",path)("method",method)("reply",reply_log));
-             return reply;
+         }
+
+         static void send_encoded_reply( const fc::http::server::response& s,
+                                         const fc::http::reply::status_code status,
+                                         const fc::path& path,
+                                         const string& method,
+                                         const rpc_encoding encoding,
+                                         const fc::variant& id,
+                                         const fc::variant& result,
+                                         const fc::variant* error = nullptr )
+         {
+             send_reply_bytes( s, status, path, method, encoding, encode_rpc_reply( encoding, id, result, error ) );
+         }
+
+         void configure_cache( const rpc_server_config& cfg )
+         {
+             _cache_enabled = cfg.enable_cache;
+             _cache_max_size = cfg.cache_size;
+             if( _response_cache )
+             {
+                 _response_cache->set_max_size( _cache_max_size );
+                 if( !_cache_enabled )
+                     _response_cache->clear();
+             }
+         }
+
+         void configure_trace( const rpc_server_config& cfg )
+         {
+             if( !cfg.trace.enabled() || _started_trace )
+                 return;
+             api_tracer::instance().start( cfg.trace );
+             _started_trace = true;
+         }
+
+         void start_reader_threads( const rpc_server_config& cfg )
+         {
+             while( _reader_threads.size() < cfg.reader_threads )
+                 _reader_threads.emplace_back( new fc::thread( "rpc_reader_" + std::to_string( _reader_threads.size() ) ) );
+         }
+
+         /**
+          *  Blockchain calls that do not change anything or need the wallet or network only read
+          *  the chain database, so they can run on a reader thread while holding a snapshot
+          */
+         static bool is_concurrent_read( const bts::api::method_data& method )
+         {
+             return method.is_const && method.name.compare( 0, 11, "blockchain_" ) == 0
+                    && (method.prerequisites & (bts::api::wallet_open | bts::api::wallet_unlocked
+                                                | bts::api::connected_to_network)) == 0;
+         }
+
+         rpc_response_cache& response_cache()
+         {
+             if( !_response_cache )
+                 _response_cache.reset( new rpc_response_cache( _client->get_chain(), _cache_max_size ) );
+             return *_response_cache;
          }
 
          fc::http::reply::status_code handle_http_rpc(const fc::http::request& r, const fc::http::server::response& s )
@@ -347,49 +434,48 @@ namespace bts { namespace rpc {
                 fc::string method_name;
 
                 fc::optional<std::string> invalid_rpc_request_message;
+                const rpc_encoding encoding = rpc_encoding_from_accept_header( r.get_header( "Accept" ) );
 
                 try {
                    auto rpc_call = fc::json::from_string( str ).get_object();
                    method_name = rpc_call["method"].as_string();
-                   auto params = rpc_call["params"].get_array();
+                   const fc::variants& params = rpc_call["params"].get_array();
                    validate_request_path( r.path, method_name, params );
 
-                   auto request_key = method_name + "=" + fc::json::to_string(rpc_call["params"]);
+                   auto call_itr = _alias_map.find( method_name );
+                   const bool cacheable = _cache_enabled && call_itr != _alias_map.end()
+                                          && rpc_response_cache::is_cacheable( _method_map[call_itr->second] );
 
+                   const string params_json = fc::json::to_string( rpc_call["params"] );
 
-                   if( fc::time_point(bts::blockchain::now()) - _last_cache_clear_time  > fc::seconds(BTS_BLOCKCHAIN_BLOCK_INTERVAL_SEC) )
-                   {
-                      _last_cache_clear_time = bts::blockchain::now();
-                      _call_cache.clear();
-                   }
-                   else if( _cache_enabled )
+                   // Aliases share the entries of the method they name
+                   string request_key;
+                   if( cacheable )
                    {
-                      auto cache_itr = _call_cache.find(request_key);
-                      if( cache_itr != _call_cache.end() )
+                      request_key = call_itr->second + "=" + params_json;
+                      std::vector<char> reply;
+                      if( response_cache().lookup( encoding, request_key, rpc_call["id"], reply ) )
                       {
                          status = fc::http::reply::OK;
-                         fc::mutable_variant_object json( fc::json::from_string( cache_itr->second ) );
-                         json["id"] =  rpc_call["id"];
-                         send_and_log_reply( s, status, r.path, method_name, json );
+                         send_reply_bytes( s, status, r.path, method_name, encoding, reply );
                          return status;
                       }
                    }
 
-
-                   auto params_log = fc::json::to_string(rpc_call["params"]);
+                   auto params_log = params_json;
                    if(method_name.find("wallet") != std::string::npos || method_name.find("priv") != std::string::npos)
                        params_log = "***";
                    fc_ilog( fc::logger::get("rpc"), "Processing ${path} ${method} (${params})", ("path",r.path)("method",method_name)("params",params_log));
 
-                   auto call_itr = _alias_map.find( method_name );
                    if( call_itr != _alias_map.end() )
                    {
-                      fc::mutable_variant_object  result;
-                      result["id"]     =  rpc_call["id"];
+                      // A block pushed while the call yields makes its result stale
+                      const uint64_t cache_generation = cacheable ? response_cache().generation() : 0;
+                      fc::variant result;
+                      fc::optional<fc::variant> error;
                       try
                       {
-                         result["result"] = dispatch_authenticated_method(_method_map[call_itr->second], params);
-                      //   auto reply = fc::json::to_string( result );
+                         result = dispatch_authenticated_method(_method_map[call_itr->second], params);
                          status = fc::http::reply::OK;
                       }
                       catch ( const fc::canceled_exception& )
@@ -399,12 +485,12 @@ namespace bts { namespace rpc {
                       catch ( const fc::exception& e )
                       {
                           status = fc::http::reply::InternalServerError;
-                          result["error"] = fc::mutable_variant_object("message",e.to_string())( "detail",e.to_detail_string() )("code",e.code());
+                          error = fc::variant( fc::mutable_variant_object("message",e.to_string())( "detail",e.to_detail_string() )("code",e.code()) );
                       }
-                      //ilog( "${e}", ("e",result) );
-                      auto reply = send_and_log_reply( s, status, r.path, method_name, result );
-                      if( _method_map[method_name].cached )
-                         _call_cache[request_key] = std::move( reply );
+                      const encoded_rpc_reply reply = encode_rpc_reply_without_id( encoding, result, error ? &*error : nullptr );
+                      send_reply_bytes( s, status, r.path, method_name, encoding, reply.with_id( encoding, rpc_call["id"] ) );
+                      if( cacheable && !error )
+                         response_cache().store( encoding, request_key, reply, cache_generation );
 
                       return status;
                    }
@@ -413,14 +499,9 @@ namespace bts { namespace rpc {
                        fc_ilog( fc::logger::get("rpc"), "Invalid Method ${path} ${method}", ("path",r.path)("method",method_name));
                        elog( "Invalid Method ${path} ${method}", ("path",r.path)("method",method_name));
                        std::string message = "Invalid Method: " + method_name;
-                       fc::mutable_variant_object  result;
-                       result["id"]     =  rpc_call["id"];
                        status = fc::http::reply::NotFound;
-                       s.set_status( status );
-                       result["error"] = fc::mutable_variant_object( "message", message );
-                       auto reply = fc::json::to_string( result );
-                       s.set_length( reply.size() );
-                       s.write( reply.c_str(), reply.size() );
+                       const fc::variant error( fc::mutable_variant_object( "message", message ) );
+                       send_encoded_reply( s, status, r.path, method_name, encoding, rpc_call["id"], fc::variant(), &error );
                        return status;
                    }
                 }
@@ -477,18 +558,7 @@ namespace bts { namespace rpc {
               auto buf_istream = std::make_shared<fc::buffered_istream>( sock );
               auto buf_ostream = std::make_shared<fc::buffered_ostream>( sock );
 
-              auto json_con = std::make_shared<fc::rpc::json_connection>( std::move(buf_istream),
-                                                                          std::move(buf_ostream) );
-              register_methods( json_con );
-              auto receipt = _open_json_connections.insert(json_con);
-
-              json_con->exec().on_complete([this,receipt,sock](fc::exception_ptr e){
-                  ilog("json_con exited");
-                  sock->close();
-                  _open_json_connections.erase(receipt.first);
-                  if( e )
-                    elog("Connection exited with error: ${error}", ("error", e->what()));
-              });
+              serve_connection( buf_istream, buf_ostream, [sock]{ sock->close(); } );
            }
          }
 
@@ -520,18 +590,141 @@ namespace bts { namespace rpc {
               auto buf_istream = std::make_shared<fc::buffered_istream>( sock );
               auto buf_ostream = std::make_shared<utilities::padding_ostream<>>( sock );
 
-              auto json_con = std::make_shared<fc::rpc::json_connection>( std::move(buf_istream),
-                                                                          std::move(buf_ostream) );
-              register_methods( json_con );
-              auto receipt = _open_json_connections.insert(json_con);
-
-              json_con->exec().on_complete([this,receipt,sock](fc::exception_ptr e){
-                  ilog("json_con exited");
-                  sock->close();
-                  _open_json_connections.erase(receipt.first);
-                  if( e )
-                    elog("Connection exited with error: ${error}", ("error", e->what()));
-              });
+              serve_connection( buf_istream, buf_ostream, [sock]{ sock->close(); } );
+           }
+         }
+
+         /** Connections opening with binary_rpc_connection_magic get framed binary replies, all others json_connection */
+         void serve_connection( const std::shared_ptr<fc::buffered_istream>& in,
+                                const std::shared_ptr<fc::buffered_ostream>& out,
+                                const std::function<void()>& close_socket )
+         {
+           fc::async( [=]{
+              try
+              {
+                if( in->peek() != binary_rpc_connection_magic )
+                {
+                  start_json_connection( in, out, close_socket );
+                  return;
+                }
+                auto binary_con = std::make_shared<binary_connection>();
+                binary_con->in = in;
+                binary_con->out = out;
+                binary_con->close_socket = close_socket;
+                auto receipt = _open_binary_connections.insert( binary_con );
+                try
+                {
+                  binary_connection_loop( *binary_con );
+                }
+                catch ( ... )
+                {
+                  _open_binary_connections.erase( receipt.first );
+                  throw;
+                }
+                _open_binary_connections.erase( receipt.first );
+              }
+              catch ( const fc::canceled_exception& )
+              {
+                close_socket();
+                throw;
+              }
+              catch ( const fc::eof_exception& )
+              {
+              }
+              catch ( const fc::exception& e )
+              {
+                elog( "Connection exited with error: ${error}", ("error", e.to_detail_string()) );
+              }
+              close_socket();
+           }, "rpc_server serve_connection" );
+         }
+
+         void start_json_connection( const std::shared_ptr<fc::buffered_istream>& in,
+                                     const std::shared_ptr<fc::buffered_ostream>& out,
+                                     const std::function<void()>& close_socket )
+         {
+           auto json_con = std::make_shared<fc::rpc::json_connection>( in, out );
+           register_methods( json_con );
+           auto receipt = _open_json_connections.insert(json_con);
+           fc::rpc::json_connection* capture_con = json_con.get();
+
+           json_con->exec().on_complete([this,receipt,close_socket,capture_con](fc::exception_ptr e){
+               ilog("json_con exited");
+               close_socket();
+               if( _market_feed )
+                 _market_feed->unsubscribe_all( capture_con );
+               _open_json_connections.erase(receipt.first);
+               if( e )
+                 elog("Connection exited with error: ${error}", ("error", e->what()));
+           });
+         }
+
+         /**
+          *  After the magic byte the client sends one rpc_encoding byte. Then each request is a
+          *  little-endian uint32 length followed by a JSON-RPC request object, and each reply the
+          *  same length prefix followed by the reply in the chosen encoding. Requests are served
+          *  in order.
+          */
+         void binary_connection_loop( binary_connection& con )
+         {
+           fc::buffered_istream& in = *con.in;
+           fc::buffered_ostream& out = *con.out;
+           in.get();
+           const uint8_t encoding_byte = uint8_t( in.get() );
+           FC_ASSERT( encoding_byte <= msgpack_rpc_encoding, "unknown RPC encoding ${e}", ("e",encoding_byte) );
+           const rpc_encoding encoding = rpc_encoding( encoding_byte );
+
+           std::string request;
+           while( true )
+           {
+             uint32_t request_size = 0;
+             fc::raw::unpack( in, request_size );
+             FC_ASSERT( request_size <= max_binary_rpc_request_size, "RPC request too large" );
+             request.resize( request_size );
+             in.read( &request[0], request_size );
+
+             fc::variant id;
+             fc::variant result;
+             fc::optional<fc::variant> error;
+             try
+             {
+               const fc::variant_object rpc_call = fc::json::from_string( request ).get_object();
+               if( rpc_call.contains( "id" ) )
+                 id = rpc_call["id"];
+               const std::string method_name = rpc_call["method"].as_string();
+               static const fc::variants no_params;
+               const fc::variants& params = rpc_call.contains( "params" ) ? rpc_call["params"].get_array() : no_params;
+
+               if( method_name == "login" )
+               {
+                 verify_login( params );
+                 con.authenticated = true;
+                 result = fc::variant( true );
+               }
+               else
+               {
+                 auto call_itr = _alias_map.find( method_name );
+                 if( call_itr == _alias_map.end() )
+                   FC_THROW_EXCEPTION( unknown_method, "Invalid Method: ${method}", ("method",method_name) );
+                 const bts::api::method_data& method_data = _method_map[call_itr->second];
+                 if( (method_data.prerequisites & bts::api::json_authenticated) && !con.authenticated )
+                   FC_THROW_EXCEPTION( login_required, "not logged in" );
+                 result = dispatch_authenticated_method( method_data, params );
+               }
+             }
+             catch ( const fc::canceled_exception& )
+             {
+               throw;
+             }
+             catch ( const fc::exception& e )
+             {
+               error = fc::variant( fc::mutable_variant_object( "message", e.to_string() )( "detail", e.to_detail_string() )( "code", e.code() ) );
+             }
+
+             const std::vector<char> reply = encode_rpc_reply( encoding, id, result, error ? &*error : nullptr );
+             fc::raw::pack( out, uint32_t( reply.size() ) );
+             out.write( reply.data(), reply.size() );
+             out.flush();
            }
          }
 
@@ -543,6 +736,18 @@ namespace bts { namespace rpc {
             // the login method is a special case that is only used for raw json connections
             // (not for the CLI or HTTP(s) json rpc)
             con->add_method("login", boost::bind(&rpc_server_impl::login, this, capture_con, _1));
+
+            // market data is pushed as "market_update" notifications, so it needs a raw json connection too
+            std::weak_ptr<fc::rpc::json_connection> weak_con = con;
+            con->add_method("market_subscribe", [this, capture_con, weak_con]( const fc::variants& params )
+            {
+              return market_subscribe( capture_con, weak_con, params );
+            });
+            con->add_method("market_unsubscribe", boost::bind(&rpc_server_impl::market_unsubscribe, this, capture_con, _1));
+            con->add_method("batch_stream", [this, capture_con, weak_con]( const fc::variants& params )
+            {
+              return batch_stream( capture_con, weak_con, params );
+            });
             for (const method_map_type::value_type& method : _method_map)
             {
               if (method.second.method)
@@ -573,8 +778,177 @@ namespace bts { namespace rpc {
         fc::variant dispatch_authenticated_method(const bts::api::method_data& method_data,
                                                   const fc::variants& arguments_from_caller)
         {
+          fc::optional<call_trace> trace = start_trace( method_data, arguments_from_caller );
+          return run_traced( trace, [&]() { return dispatch_untraced_method( method_data, arguments_from_caller ); } );
+        }
+
+        struct call_trace
+        {
+          api_trace_record record;
+          bool             trace_result = false;
+        };
+
+        /** Starts the api_tracer record of one call, or returns nothing when tracing is off */
+        fc::optional<call_trace> start_trace( const bts::api::method_data& method_data, const fc::variants& arguments_from_caller )
+        {
+          api_tracer& tracer = api_tracer::instance();
+          if( !tracer.is_enabled() )
+            return fc::optional<call_trace>();
+
+          call_trace trace;
+          bool sampled = false;
+          trace.record.call_id = tracer.next_call_id( sampled );
+          trace.record.method_id = _trace_method_ids[ method_data.name ];
+          trace.record.start_time = fc::time_point::now();
+          trace.record.args_size = uint32_t( fc::raw::pack_size( arguments_from_caller ) );
+          if( sampled )
+            trace.record.args = traced_arguments( method_data, arguments_from_caller );
+          // whatever needs an unlocked wallet may return keys
+          trace.trace_result = sampled && !(method_data.prerequisites & bts::api::wallet_unlocked);
+          return trace;
+        }
+
+        /** Runs call and completes its trace, if any, with the result or the error code */
+        template<typename Call>
+        static fc::variant run_traced( fc::optional<call_trace>& trace, const Call& call )
+        {
+          if( !trace )
+            return call();
+
+          api_tracer& tracer = api_tracer::instance();
+          api_trace_record& record = trace->record;
+          const auto finish = [&]( const int64_t error_code )
+          {
+            record.latency_us = uint32_t( (fc::time_point::now() - record.start_time).count() );
+            record.error_code = error_code;
+            tracer.record( std::move( record ) );
+          };
+          try
+          {
+            fc::variant result = call();
+            record.result_size = uint32_t( fc::raw::pack_size( result ) );
+            if( trace->trace_result )
+              record.result = result;
+            finish( 0 );
+            return result;
+          }
+          catch( const fc::exception& e )
+          {
+            finish( e.code() );
+            throw;
+          }
+          catch( const std::exception& )
+          {
+            finish( fc::std_exception_code );
+            throw;
+          }
+        }
+
+        /** The arguments as they may be written out, with passphrases and keys masked as in the log */
+        static fc::variants traced_arguments( const bts::api::method_data& method_data, const fc::variants& arguments_from_caller )
+        {
+          fc::variants arguments = arguments_from_caller;
+          for( size_t i = 0; i < arguments.size() && i < method_data.parameters.size(); ++i )
+          {
+            if( method_data.parameters[ i ].obscure_in_log_files )
+              arguments[ i ] = "*********";
+          }
+          return arguments;
+        }
+
+        fc::variant dispatch_untraced_method(const bts::api::method_data& method_data,
+                                             const fc::variants& arguments_from_caller)
+        {
+          if( !_reader_threads.empty() && is_concurrent_read( method_data ) )
+            return dispatch_on_reader_thread( method_data, arguments_from_caller );
+
           fc::scoped_lock<fc::mutex> lock(_rpc_mutex);
+          return invoke_method( method_data, arguments_from_caller );
+        }
+
+        /**
+         *  The calling fiber yields until the reader is done, so the client thread keeps pushing
+         *  blocks; a block arriving mid-call waits only for the snapshots already taken.
+         */
+        fc::variant dispatch_on_reader_thread( const bts::api::method_data& method_data,
+                                               const fc::variants& arguments_from_caller )
+        {
+          return start_on_reader_thread( method_data, arguments_from_caller ).wait();
+        }
+
+        fc::future<fc::variant> start_on_reader_thread( const bts::api::method_data& method_data,
+                                                        const fc::variants& arguments_from_caller )
+        {
+          const chain_database_ptr chain = _client->get_chain();
+          fc::thread& reader = *_reader_threads[ _next_reader_thread++ % _reader_threads.size() ];
+          // copied, as the reader may outlive a canceled caller
+          return reader.async( [this, chain, method_data, arguments_from_caller]() -> fc::variant
+          {
+            const bts::blockchain::chain_snapshot_ptr snapshot = chain->acquire_snapshot();
+            return invoke_method( method_data, arguments_from_caller );
+          }, "rpc_reader_call" );
+        }
+
+        /**
+         *  Calls method_name once for each entry of parameters_list. Concurrent reads are spread
+         *  over the reader threads with up to batch_max_parallel calls in flight, each against its
+         *  own snapshot, so a batch takes about as long as its slowest call. Results are passed to
+         *  on_result in order as soon as they and every result before them are in; the first
+         *  failed call fails the batch.
+         */
+        fc::variants batch_invoke_method( const std::string& method_name,
+                                          const std::vector<fc::variants>& parameters_list,
+                                          const batch_result_callback& on_result )
+        {
+          FC_ASSERT( parameters_list.size() <= _config.batch_max_size,
+                     "batch of ${count} calls is larger than the limit of ${limit}",
+                     ("count",parameters_list.size())("limit",_config.batch_max_size) );
+          auto iter = _alias_map.find(method_name);
+          if (iter == _alias_map.end())
+            FC_THROW_EXCEPTION( unknown_method, "Invalid command ${command}", ("command", method_name));
+          const bts::api::method_data& method_data = _method_map[iter->second];
+
+          fc::variants results( parameters_list.size() );
+          if( _reader_threads.empty() || !is_concurrent_read( method_data ) )
+          {
+            for( size_t i = 0; i < parameters_list.size(); ++i )
+            {
+              results[i] = dispatch_authenticated_method( method_data, parameters_list[i] );
+              if( on_result ) on_result( i, results[i] );
+            }
+            return results;
+          }
+
+          // each call is traced like a single one, from when it is started until the batch collects its result
+          struct started_call
+          {
+            fc::optional<call_trace>  trace;
+            fc::future<fc::variant>   result;
+          };
+          const size_t max_in_flight = std::max<uint32_t>( _config.batch_max_parallel, 1 );
+          std::deque<started_call> in_flight;
+          size_t next_to_start = 0;
+          for( size_t i = 0; i < parameters_list.size(); ++i )
+          {
+            while( next_to_start < parameters_list.size() && in_flight.size() < max_in_flight )
+            {
+              const fc::variants& arguments = parameters_list[next_to_start++];
+              started_call call;
+              call.trace = start_trace( method_data, arguments );
+              call.result = start_on_reader_thread( method_data, arguments );
+              in_flight.push_back( std::move( call ) );
+            }
+            started_call& call = in_flight.front();
+            results[i] = run_traced( call.trace, [&]() { return call.result.wait(); } );
+            in_flight.pop_front();
+            if( on_result ) on_result( i, results[i] );
+          }
+          return results;
+        }
 
+        fc::variant invoke_method(const bts::api::method_data& method_data,
+                                  const fc::variants& arguments_from_caller)
+        {
           if (!method_data.method)
           {
             // then this is a method using our new generated code
@@ -588,6 +962,14 @@ namespace bts { namespace rpc {
           if (method_data.prerequisites & bts::api::connected_to_network)
             verify_connected_to_network();
 
+          // zero and fixed arity methods take the caller's arguments as they are when the count matches
+          bool fixed_arity = true;
+          for (const bts::api::parameter_data& parameter : method_data.parameters)
+            fixed_arity &= parameter.classification == bts::api::required_positional
+                           || parameter.classification == bts::api::required_positional_hidden;
+          if (fixed_arity && arguments_from_caller.size() == method_data.parameters.size())
+            return method_data.method(arguments_from_caller);
+
           fc::variants modified_positional_arguments;
           fc::mutable_variant_object modified_named_arguments;
 
@@ -653,7 +1035,15 @@ namespace bts { namespace rpc {
           return dispatch_authenticated_method(_method_map[iter->second], arguments);
         }
 
+        void        verify_login( const fc::variants& params )const;
         fc::variant login( fc::rpc::json_connection* json_connection, const fc::variants& params );
+        fc::variant batch_stream( fc::rpc::json_connection* json_connection,
+                                  const std::weak_ptr<fc::rpc::json_connection>& weak_connection,
+                                  const fc::variants& params );
+        fc::variant market_subscribe( fc::rpc::json_connection* json_connection,
+                                      const std::weak_ptr<fc::rpc::json_connection>& weak_connection,
+                                      const fc::variants& params );
+        fc::variant market_unsubscribe( fc::rpc::json_connection* json_connection, const fc::variants& params );
     };
 
     bts::api::common_api* rpc_server_impl::get_client() const
@@ -693,15 +1083,82 @@ namespace bts { namespace rpc {
     //                            {{"username", "string",  true},
     //                             {"password", "string",  true}},
     //        /* prerequisites */ 0});
-    fc::variant rpc_server_impl::login(fc::rpc::json_connection* json_connection, const fc::variants& params)
+    // login <username> <password>, shared by json and binary connections
+    void rpc_server_impl::verify_login( const fc::variants& params )const
     {
       FC_ASSERT( params.size() == 2 );
       FC_ASSERT( params[0].as_string() == _config.rpc_user );
       FC_ASSERT( params[1].as_string() == _config.rpc_password );
+    }
+
+    fc::variant rpc_server_impl::login(fc::rpc::json_connection* json_connection, const fc::variants& params)
+    {
+      verify_login( params );
       _authenticated_connection_set.insert( json_connection );
       return fc::variant( true );
     }
 
+    // market_subscribe <quote_symbol> <base_symbol>: returns the book as a snapshot, then sends
+    // a "market_update" notification for every block that changes the market
+    fc::variant rpc_server_impl::market_subscribe( fc::rpc::json_connection* json_connection,
+                                                   const std::weak_ptr<fc::rpc::json_connection>& weak_connection,
+                                                   const fc::variants& params )
+    {
+      FC_ASSERT( params.size() == 2 );
+      const chain_database_ptr chain = _client->get_chain();
+      if( !_market_feed )
+        _market_feed.reset( new market_feed( chain ) );
+
+      const auto sink = [weak_connection]( const market_feed_update& update )
+      {
+        if( auto connection = weak_connection.lock() )
+          connection->notify( "market_update", fc::variant( update ) );
+      };
+      return fc::variant( _market_feed->subscribe( json_connection,
+                                                   chain->get_asset_id( params[0].as_string() ),
+                                                   chain->get_asset_id( params[1].as_string() ),
+                                                   sink ) );
+    }
+
+    fc::variant rpc_server_impl::market_unsubscribe( fc::rpc::json_connection* json_connection, const fc::variants& params )
+    {
+      FC_ASSERT( params.size() == 2 );
+      if( !_market_feed )
+        return fc::variant( false );
+
+      const chain_database_ptr chain = _client->get_chain();
+      return fc::variant( _market_feed->unsubscribe( json_connection,
+                                                     chain->get_asset_id( params[0].as_string() ),
+                                                     chain->get_asset_id( params[1].as_string() ) ) );
+    }
+
+    /**
+     *  Like batch, but each result is sent as a "batch_result" notification {index, result} as soon
+     *  as it is ready instead of all at once in the reply, which only carries the number of calls.
+     */
+    fc::variant rpc_server_impl::batch_stream( fc::rpc::json_connection* json_connection,
+                                               const std::weak_ptr<fc::rpc::json_connection>& weak_connection,
+                                               const fc::variants& params )
+    {
+      FC_ASSERT( params.size() == 2 );
+      const std::string method_name = params[0].as_string();
+      const std::vector<fc::variants> parameters_list = params[1].as<std::vector<fc::variants>>();
+
+      auto iter = _alias_map.find( method_name );
+      if( iter == _alias_map.end() )
+        FC_THROW_EXCEPTION( unknown_method, "Invalid Method: ${method}", ("method",method_name) );
+      if( (_method_map[iter->second].prerequisites & bts::api::json_authenticated)
+          && _authenticated_connection_set.find( json_connection ) == _authenticated_connection_set.end() )
+        FC_THROW_EXCEPTION( login_required, "not logged in" );
+
+      batch_invoke_method( method_name, parameters_list, [weak_connection]( size_t index, const fc::variant& result )
+      {
+        if( auto connection = weak_connection.lock() )
+          connection->notify( "batch_result", fc::variant( fc::mutable_variant_object( "index", index )( "result", result ) ) );
+      } );
+      return fc::variant( parameters_list.size() );
+    }
+
     std::string rpc_server_impl::help(const std::string& command_name) const
     {
       std::string help_string;
@@ -787,7 +1244,9 @@ namespace bts { namespace rpc {
   {
     if (!cfg.is_valid())
       return false;
-    my->_cache_enabled = cfg.enable_cache;
+    my->configure_cache( cfg );
+    my->configure_trace( cfg );
+    my->start_reader_threads( cfg );
 
     try
     {
@@ -826,7 +1285,9 @@ namespace bts { namespace rpc {
     if(!cfg.is_valid())
       return false;
 
-    my->_cache_enabled = cfg.enable_cache;
+    my->configure_cache( cfg );
+    my->configure_trace( cfg );
+    my->start_reader_threads( cfg );
 
     try
     {
@@ -862,7 +1323,9 @@ namespace bts { namespace rpc {
   {
     if (!cfg.is_valid())
       return false;
-    my->_cache_enabled = cfg.enable_cache;
+    my->configure_cache( cfg );
+    my->configure_trace( cfg );
+    my->start_reader_threads( cfg );
     if(cfg.encrypted_rpc_wif_key.empty())
     {
        std::cerr << ("No WIF");
@@ -913,6 +1376,13 @@ namespace bts { namespace rpc {
     return my->direct_invoke_method(method_name, arguments);
   }
 
+  fc::variants rpc_server::batch_invoke_method( const std::string& method_name,
+                                                const std::vector<fc::variants>& parameters_list,
+                                                const batch_result_callback& on_result )
+  {
+    return my->batch_invoke_method( method_name, parameters_list, on_result );
+  }
+
   const bts::api::method_data& rpc_server::get_method_data(const std::string& method_name)
   {
     auto iter = my->_alias_map.find(method_name);
@@ -920,6 +1390,17 @@ namespace bts { namespace rpc {
       return my->_method_map[iter->second];
     FC_THROW_EXCEPTION(unknown_method, "Method \"${name}\" not found", ("name", method_name));
   }
+  rpc_response_cache_stats rpc_server::get_response_cache_stats()const
+  {
+    if( !my->_response_cache )
+    {
+      rpc_response_cache_stats stats;
+      stats.max_size = my->_cache_max_size;
+      return stats;
+    }
+    return my->_response_cache->get_stats();
+  }
+
   void rpc_server::set_http_file_callback(  const http_callback_type& callback )
   {
      my->_http_file_callback = callback;
@@ -943,6 +1424,7 @@ namespace bts { namespace rpc {
         my->_alias_map[alias] = data.name;
     }
     my->_method_map.insert(detail::rpc_server_impl::method_map_type::value_type(data.name, data));
+    my->_trace_method_ids[data.name] = api_tracer::instance().register_method(data.name);
   }
 
 
@@ -982,6 +1464,15 @@ namespace bts { namespace rpc {
       my->_tcp_serv->close();
     if( my->_accept_loop_complete.valid() && !my->_accept_loop_complete.ready())
       my->_accept_loop_complete.cancel(__FUNCTION__);
+    // closing the socket ends the connection's loop, which removes it from the set
+    const auto binary_connections = my->_open_binary_connections;
+    for( const auto& binary_con : binary_connections )
+      binary_con->close_socket();
+    if( my->_started_trace )
+    {
+      api_tracer::instance().stop();
+      my->_started_trace = false;
+    }
   }
 
   std::string rpc_server::help(const std::string& command_name) const
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace bts { namespace utilities {
+
+   /**
+    *  Pin memory in RAM so it is never written to swap; best effort since resource limits may refuse it.
+    *  Locks are counted per page, so a page shared by several allocations stays locked until the last
+    *  of them is unlocked.
+    */
+   void lock_memory( void* p, size_t size );
+   void unlock_memory( void* p, size_t size );
+
+   /** Overwrite memory with zeros in a way the compiler will not optimize out */
+   void secure_zero_memory( void* p, size_t size );
+
+   /**
+    *  Allocator for containers holding key material: allocations are locked in RAM
+    *  and zeroed before being released.
+    */
+   template<typename T>
+   struct secure_allocator : public std::allocator<T>
+   {
+       typedef std::allocator<T>                base;
+       typedef typename base::size_type         size_type;
+       typedef typename base::pointer           pointer;
+
+       template<typename U>
+       struct rebind { typedef secure_allocator<U> other; };
+
+       secure_allocator() throw() {}
+       secure_allocator( const secure_allocator& a ) throw() : base( a ) {}
+       template<typename U>
+       secure_allocator( const secure_allocator<U>& a ) throw() : base( a ) {}
+
+       pointer allocate( size_type n )
+       {
+           pointer p = base::allocate( n );
+           if( p != nullptr )
+               lock_memory( p, n * sizeof( T ) );
+           return p;
+       }
+
+       void deallocate( pointer p, size_type n )
+       {
+           if( p != nullptr )
+           {
+               secure_zero_memory( p, n * sizeof( T ) );
+               unlock_memory( p, n * sizeof( T ) );
+           }
+           base::deallocate( p, n );
+       }
+   };
+
+} } // bts::utilities
@@ -0,0 +1,124 @@
+#include <bts/utilities/secure_allocator.hpp>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace bts { namespace utilities {
+
+namespace {
+
+size_t page_size()
+{
+#ifdef WIN32
+   static const size_t size = []() -> size_t
+   {
+      SYSTEM_INFO info;
+      GetSystemInfo( &info );
+      return info.dwPageSize;
+   }();
+#else
+   static const size_t size = sysconf( _SC_PAGESIZE );
+#endif
+   return size;
+}
+
+void lock_page( void* page, size_t size )
+{
+#ifdef WIN32
+   VirtualLock( page, size );
+#else
+   mlock( page, size );
+#endif
+}
+
+void unlock_page( void* page, size_t size )
+{
+#ifdef WIN32
+   VirtualUnlock( page, size );
+#else
+   munlock( page, size );
+#endif
+}
+
+/** Small allocations share pages, and the OS does not count locks, so count them here */
+class locked_page_counter
+{
+   public:
+      void lock( void* p, size_t size )
+      {
+         if( size == 0 ) return;
+         const size_t page = page_size();
+         std::lock_guard<std::mutex> guard( _mutex );
+         for( uintptr_t base = first_page( p, page ); base <= last_page( p, size, page ); base += page )
+         {
+            if( _counts[ base ]++ == 0 )
+               lock_page( reinterpret_cast<void*>( base ), page );
+         }
+      }
+
+      void unlock( void* p, size_t size )
+      {
+         if( size == 0 ) return;
+         const size_t page = page_size();
+         std::lock_guard<std::mutex> guard( _mutex );
+         for( uintptr_t base = first_page( p, page ); base <= last_page( p, size, page ); base += page )
+         {
+            const auto iter = _counts.find( base );
+            if( iter == _counts.end() ) continue;
+            if( --iter->second == 0 )
+            {
+               unlock_page( reinterpret_cast<void*>( base ), page );
+               _counts.erase( iter );
+            }
+         }
+      }
+
+   private:
+      static uintptr_t first_page( void* p, size_t page )
+      {
+         return reinterpret_cast<uintptr_t>( p ) & ~( uintptr_t( page ) - 1 );
+      }
+
+      static uintptr_t last_page( void* p, size_t size, size_t page )
+      {
+         return ( reinterpret_cast<uintptr_t>( p ) + size - 1 ) & ~( uintptr_t( page ) - 1 );
+      }
+
+      std::mutex                    _mutex;
+      std::map<uintptr_t, size_t>   _counts;
+};
+
+locked_page_counter& locked_pages()
+{
+   static locked_page_counter counter;
+   return counter;
+}
+
+} // anonymous namespace
+
+void lock_memory( void* p, size_t size )
+{
+   locked_pages().lock( p, size );
+}
+
+void unlock_memory( void* p, size_t size )
+{
+   locked_pages().unlock( p, size );
+}
+
+void secure_zero_memory( void* p, size_t size )
+{
+   volatile char* bytes = static_cast<volatile char*>( p );
+   while( size-- )
+      *bytes++ = 0;
+}
+
+} } // bts::utilities
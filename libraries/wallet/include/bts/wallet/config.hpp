@@ -11,4 +11,8 @@
 
 #define BTS_WALLET_DEFAULT_TRANSACTION_EXPIRATION_SEC       ( 60 * 60 )
 
+#define BTS_WALLET_MAX_DEPOSITS_PER_BATCH_TRANSACTION       100
+
+#define BTS_WALLET_ACCOUNT_KEY_LOOKAHEAD                    100
+
 #define WALLET_DEFAULT_MARKET_TRANSACTION_EXPIRATION_SEC    ( 60 * 10 )
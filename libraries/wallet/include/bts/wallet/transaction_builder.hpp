@@ -7,6 +7,7 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 namespace bts { namespace wallet {
    namespace detail { class wallet_impl; }
@@ -19,6 +20,56 @@ namespace bts { namespace wallet {
       vote_recommended  = 3
    };
 
+   /**
+    * @brief Spendable wallet balances indexed by account and asset, ordered by amount
+    *
+    * Coin selection against the selector takes the largest balances first and remembers what it has already
+    * withdrawn, so that many operations or transactions can be funded from one snapshot of the wallet's balances
+    * without rescanning them and without spending the same funds twice.
+    */
+   class balance_selector
+   {
+      public:
+         balance_selector(){}
+         balance_selector( const std::map<string, std::vector<balance_record>>& account_balances,
+                           const time_point_sec now );
+
+         void add_balance( const string& account_name, const balance_record& record, const time_point_sec now );
+
+         share_type                          get_balance( const string& account_name, const asset_id_type asset_id )const;
+         std::map<asset_id_type, share_type> get_balances( const string& account_name )const;
+
+         /**
+          * Withdraws amount from the account's balances into trx and adds the owners to required_signatures. Nothing
+          * is withdrawn and false is returned if the account does not have enough funds left in the selector.
+          */
+         bool withdraw( const string& account_name,
+                        const asset& amount,
+                        signed_transaction& trx,
+                        std::unordered_set<address>& required_signatures );
+
+      private:
+         typedef std::pair<share_type, balance_id_type> amount_index;
+
+         struct largest_first
+         {
+            bool operator()( const amount_index& a, const amount_index& b )const
+            {
+               if( a.first != b.first ) return a.first > b.first;
+               return a.second < b.second;
+            }
+         };
+
+         struct spendable_balances
+         {
+            std::set<amount_index, largest_first>             by_amount;
+            std::unordered_map<balance_id_type, address>      owners;
+            share_type                                        total = 0;
+         };
+
+         std::map<string, std::map<asset_id_type, spendable_balances>> _balances;
+   };
+
    /**
     * @brief The transaction_builder struct simplifies the process of creating arbitrarily complex transactions.
     *
@@ -318,6 +369,10 @@ namespace bts { namespace wallet {
       detail::wallet_impl* _wimpl;
       //Shorthand name for the signed_transaction
       signed_transaction& trx = transaction_record.trx;
+      ///Snapshot of the wallet's spendable balances; built on first use and shared by all withdrawals in finalize()
+      std::shared_ptr<balance_selector> _balance_selector;
+
+      balance_selector& get_balance_selector();
 
       void validate_market(asset_id_type quote, asset_id_type base)
       {
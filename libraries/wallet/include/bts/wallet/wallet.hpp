@@ -268,6 +268,17 @@ namespace bts { namespace wallet {
                  const vote_strategy strategy,
                  bool sign
                  );
+         /**
+          *  Pays every (recipient, amount) in payouts from one account, packing up to
+          *  BTS_WALLET_MAX_DEPOSITS_PER_BATCH_TRANSACTION deposits and a single fee into each transaction.
+          */
+         vector<wallet_transaction_record> batch_transfer(
+                 const vector<std::pair<string, asset>>& payouts,
+                 const string& sender_account_name,
+                 const string& memo,
+                 const vote_strategy strategy,
+                 bool sign
+                 );
          wallet_transaction_record burn_asset(
                  const asset& asset_to_transfer,
                  const string& paying_account_name,
@@ -53,6 +53,11 @@ namespace bts { namespace wallet {
          void                   import_key( const fc::sha512& password, const string& account_name,
                                             const private_key_type& private_key, bool move_existing );
 
+         // Precomputed account child keys
+         owallet_key_lookahead_record lookup_key_lookahead( const address& account_address )const;
+         void                         store_key_lookahead( const key_lookahead& lookahead );
+         bool                         claim_lookahead_key( const address& derived_address );
+
          // Contact getters and setters
          owallet_contact_record lookup_contact( const variant& data )const;
          owallet_contact_record lookup_contact( const string& label )const;
@@ -75,7 +80,7 @@ namespace bts { namespace wallet {
          // Non-deterministic and not linked to any account
          private_key_type       generate_new_one_time_key( const fc::sha512& password );
 
-         map<private_key_type, string> get_account_private_keys( const fc::sha512& password )const;
+         map<public_key_type, string> get_account_public_keys()const;
 
          // Restore as many broken record invariants as possible
          void                   repair_records( const fc::sha512& password );
@@ -137,6 +142,11 @@ namespace bts { namespace wallet {
          // Cache to lookup keys
          unordered_map<address, address>                                btc_to_bts_address;
 
+         // Precomputed account child keys and a cache to look them up by any address form
+         unordered_map<address, wallet_key_lookahead_record>            key_lookaheads;
+         unordered_map<address, key_data>                               lookahead_keys;
+         unordered_map<address, address>                                lookahead_btc_to_bts_address;
+
          // Cache to lookup accounts and contacts
          unordered_map<string, string>                                  label_to_account_or_contact;
 
@@ -9,6 +9,7 @@
 #include <bts/blockchain/market_operations.hpp>
 #include <bts/game/game_operations.hpp>
 #include <bts/game/client.hpp>
+#include <bts/utilities/secure_allocator.hpp>
 
 namespace bts { namespace wallet { namespace detail {
 
@@ -26,6 +27,7 @@ class wallet_impl : public chain_observer
       fc::optional<fc::time_point>                     _scheduled_lock_time;
       fc::future<void>                                 _relocker_done;
       fc::future<void>                                 _scan_in_progress;
+      fc::future<void>                                 _key_lookahead_refill_done;
 
       unsigned                                         _num_scanner_threads = 1;
       vector<std::unique_ptr<fc::thread>>              _scanner_threads;
@@ -33,10 +35,17 @@ class wallet_impl : public chain_observer
 
       bool                                             _dirty_balances = true;
       unordered_map<balance_id_type, balance_record>   _balance_records;
+      unordered_set<balance_id_type>                   _pending_balance_ids;
 
       bool                                             _dirty_accounts = true;
       vector<private_key_type>                         _stealth_private_keys;
 
+      // Decrypted keys by key address; filled at unlock, zeroed when the wallet locks
+      typedef std::unordered_map<address, private_key_type, std::hash<address>, std::equal_to<address>,
+              bts::utilities::secure_allocator<std::pair<const address, private_key_type>>> private_key_cache_type;
+      mutable private_key_cache_type                   _private_key_cache;
+      fc::future<void>                                 _private_key_cache_filled;
+
       struct login_record
       {
           private_key_type key;
@@ -60,10 +69,23 @@ class wallet_impl : public chain_observer
       void reschedule_relocker();
       void relocker();
 
+      void refill_key_lookaheads();
+      void refill_key_lookaheads_task();
+
+      void fill_private_key_cache();
+      void fill_private_key_cache_task();
+      void clear_private_key_cache();
+
+      private_key_type                  get_private_key( const address& addr )const;
+      map<private_key_type, string>     get_account_private_keys()const;
+
       virtual void block_pushed( const full_block& )override;
       virtual void block_popped( const pending_chain_state_ptr& )override;
+      virtual void state_changed( const pending_chain_state_ptr& state )override;
 
       void scan_balances_experimental();
+      void refresh_balance_record( const balance_id_type& id, const pending_chain_state_ptr& pending_state );
+      void update_balance_records();
 
       void scan_market_transaction(
               const market_transaction& mtrx,
@@ -155,6 +177,12 @@ class wallet_impl : public chain_observer
                                     signed_transaction& trx,
                                     unordered_set<address>& required_signatures )const;
 
+      void withdraw_to_transaction( const asset& amount_to_withdraw,
+                                    const string& from_account_name,
+                                    signed_transaction& trx,
+                                    unordered_set<address>& required_signatures,
+                                    balance_selector& selector )const;
+
       wallet_contact_record generic_recipient_to_contact( const string& generic_recipient )const;
 
       public_key_type deposit_from_transaction( signed_transaction& transaction, const asset& amount,
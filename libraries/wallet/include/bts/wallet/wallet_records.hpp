@@ -27,7 +27,8 @@ namespace bts { namespace wallet {
       property_record_type      = 7,
       setting_record_type       = 9,
       transaction_info_record_type   = 10,
-      packet_info_record_type   = 11
+      packet_info_record_type   = 11,
+      key_lookahead_record_type = 12
    };
 
    enum property_enum
@@ -88,6 +89,21 @@ namespace bts { namespace wallet {
        private_key_type     decrypt_private_key( const fc::sha512& password )const;
    };
 
+   struct lookahead_key : public key_data
+   {
+       vector<address>      derived_addresses; // BTC and PTS encodings of public_key
+
+       void                 derive_addresses();
+   };
+
+   /* Account child keys derived ahead of last_child_key_index so they need no EC math to hand out or match */
+   struct key_lookahead
+   {
+       address                  account_address;
+       public_key_type          parent_key;
+       vector<lookahead_key>    keys;
+   };
+
    struct contact_data
    {
        enum class contact_type_enum : uint8_t
@@ -265,6 +281,7 @@ namespace bts { namespace wallet {
    typedef wallet_record<setting,           setting_record_type>        wallet_setting_record;
    typedef wallet_record<transaction_info,  transaction_info_record_type>    wallet_transaction_record;
    typedef wallet_record<packet_info,       packet_info_record_type>    wallet_packet_record;
+   typedef wallet_record<key_lookahead,     key_lookahead_record_type>  wallet_key_lookahead_record;
 
    typedef optional<wallet_property_record>                             owallet_property_record;
    typedef optional<wallet_master_key_record>                           owallet_master_key_record;
@@ -276,6 +293,7 @@ namespace bts { namespace wallet {
    typedef optional<wallet_setting_record>                              owallet_setting_record;
    typedef optional<wallet_deprecated_transaction_record>               owallet_deprecated_transaction_record;
    typedef optional<wallet_packet_record>                               owallet_packet_record;
+   typedef optional<wallet_key_lookahead_record>                        owallet_key_lookahead_record;
 
    struct generic_wallet_record
    {
@@ -313,6 +331,7 @@ FC_REFLECT_ENUM( bts::wallet::wallet_record_type_enum,
         (setting_record_type)
         (transaction_info_record_type)
         (packet_info_record_type)
+        (key_lookahead_record_type)
         )
 
 FC_REFLECT_ENUM( bts::wallet::property_enum,
@@ -351,6 +370,16 @@ FC_REFLECT( bts::wallet::key_data,
         (memo)
         )
 
+FC_REFLECT_DERIVED( bts::wallet::lookahead_key, (bts::wallet::key_data),
+        (derived_addresses)
+        )
+
+FC_REFLECT( bts::wallet::key_lookahead,
+        (account_address)
+        (parent_key)
+        (keys)
+        )
+
 FC_REFLECT_ENUM( bts::wallet::contact_data::contact_type_enum,
         (account_name)
         (public_key)
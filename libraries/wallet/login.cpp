@@ -39,7 +39,7 @@ std::string wallet::login_start(const std::string& account_name)
                                                 fc::time_point::now() + fc::seconds(my->_login_cleaner_interval_seconds),
                                                 "login_map_cleaner_task");
 
-   auto signature = key->decrypt_private_key(my->_wallet_password)
+   auto signature = my->get_private_key(key->get_address())
                        .sign_compact(fc::sha256::hash((char*)&one_time_public_key,
                                                       sizeof(one_time_public_key)));
 
@@ -11,11 +11,98 @@
 using namespace bts::wallet;
 using namespace bts::wallet::detail;
 
+balance_selector::balance_selector( const std::map<string, std::vector<balance_record>>& account_balances,
+                                    const time_point_sec now )
+{
+   for( const auto& item : account_balances )
+      for( const balance_record& record : item.second )
+         add_balance( item.first, record, now );
+}
+
+void balance_selector::add_balance( const string& account_name, const balance_record& record, const time_point_sec now )
+{
+   const asset balance = record.get_spendable_balance( now );
+   if( balance.amount <= 0 ) return;
+
+   const auto owner = record.owner();
+   if( !owner.valid() ) return;
+
+   spendable_balances& balances = _balances[ account_name ][ balance.asset_id ];
+   const balance_id_type id = record.id();
+   if( !balances.owners.insert( std::make_pair( id, *owner ) ).second ) return;
+
+   balances.by_amount.insert( amount_index( balance.amount, id ) );
+   balances.total += balance.amount;
+}
+
+share_type balance_selector::get_balance( const string& account_name, const asset_id_type asset_id )const
+{
+   const auto account_iter = _balances.find( account_name );
+   if( account_iter == _balances.end() ) return 0;
+
+   const auto asset_iter = account_iter->second.find( asset_id );
+   if( asset_iter == account_iter->second.end() ) return 0;
+
+   return asset_iter->second.total;
+}
+
+std::map<asset_id_type, share_type> balance_selector::get_balances( const string& account_name )const
+{
+   std::map<asset_id_type, share_type> result;
+
+   const auto account_iter = _balances.find( account_name );
+   if( account_iter == _balances.end() ) return result;
+
+   for( const auto& item : account_iter->second )
+      if( item.second.total > 0 )
+         result[ item.first ] = item.second.total;
+
+   return result;
+}
+
+bool balance_selector::withdraw( const string& account_name,
+                                 const asset& amount,
+                                 signed_transaction& trx,
+                                 std::unordered_set<address>& required_signatures )
+{
+   if( amount.amount <= 0 ) return true;
+   if( get_balance( account_name, amount.asset_id ) < amount.amount ) return false;
+
+   spendable_balances& balances = _balances[ account_name ][ amount.asset_id ];
+   share_type remaining = amount.amount;
+   while( remaining > 0 )
+   {
+      const auto largest = balances.by_amount.begin();
+      const amount_index index = *largest;
+      balances.by_amount.erase( largest );
+
+      const share_type withdrawn = std::min( remaining, index.first );
+      trx.withdraw( index.second, withdrawn );
+      required_signatures.insert( balances.owners.at( index.second ) );
+
+      if( withdrawn < index.first )
+         balances.by_amount.insert( amount_index( index.first - withdrawn, index.second ) );
+
+      balances.total -= withdrawn;
+      remaining -= withdrawn;
+   }
+
+   return true;
+}
+
 void  transaction_builder::set_wallet_implementation(std::unique_ptr<bts::wallet::detail::wallet_impl>& wimpl)
 {
     _wimpl = wimpl.get();
 }
 
+balance_selector& transaction_builder::get_balance_selector()
+{
+   if( !_balance_selector )
+      _balance_selector = std::make_shared<balance_selector>( _wimpl->self->get_spendable_account_balance_records(),
+                                                              _wimpl->_blockchain->get_pending_state()->now() );
+   return *_balance_selector;
+}
+
 public_key_type transaction_builder::order_key_for_account(const address& account_address, const string& account_name)
 {
    auto order_key = order_keys[account_address];
@@ -505,7 +592,7 @@ transaction_builder& transaction_builder::finalize( const bool pay_fee, const vo
       }
       else if( balance.amount < 0 )
       {
-          _wimpl->withdraw_to_transaction(-balance, account_name, trx, required_signatures);
+          _wimpl->withdraw_to_transaction(-balance, account_name, trx, required_signatures, get_balance_selector());
       }
    }
 
@@ -632,7 +719,7 @@ transaction_builder& transaction_builder::deposit_to_balance(const balance_id_ty
 //Called when pay_fee doesn't find a positive balance in the trx to pay the fee with
 bool transaction_builder::withdraw_fee()
 {
-   const auto balances = _wimpl->self->get_spendable_account_balances();
+   const balance_selector& balances = get_balance_selector();
 
    //Shake 'em down
    for( const auto& item : outstanding_balances )
@@ -641,11 +728,11 @@ bool transaction_builder::withdraw_fee()
 
       //Got any lunch money?
       const owallet_account_record account_rec = _wimpl->_wallet_db.lookup_account(bag_holder);
-      if( !account_rec || balances.count( account_rec->name ) == 0 )
+      if( !account_rec )
          continue;
 
       //Well how much?
-      const map<asset_id_type, share_type>& account_balances = balances.at( account_rec->name );
+      const map<asset_id_type, share_type> account_balances = balances.get_balances( account_rec->name );
       for( const auto& balance_item : account_balances )
       {
           const asset balance( balance_item.second, balance_item.first );
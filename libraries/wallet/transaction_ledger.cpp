@@ -89,7 +89,6 @@ void wallet_impl::scan_market_transaction(
         }
 
         _wallet_db.store_transaction( record );
-        _dirty_balances = true;
     }
 
     auto okey_ask = _wallet_db.lookup_key( mtrx.ask_owner );
@@ -143,7 +142,6 @@ void wallet_impl::scan_market_transaction(
         }
 
         _wallet_db.store_transaction( record );
-        _dirty_balances = true;
     }
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -180,7 +178,6 @@ void wallet_impl::scan_operation_reward_transaction(
         self->wallet_claimed_transaction( entry );
         
         _wallet_db.store_transaction( record );
-        _dirty_balances = true;
     }
 
 } FC_CAPTURE_AND_RETHROW() }
@@ -281,18 +278,28 @@ void wallet_impl::scan_block( uint32_t block_num )
         }
     }
     
+    // each game is handed all of its results in the block at once
     const vector<game_result_transaction>& game_result_trxs = _blockchain->get_game_result_transactions( block_num );
+    vector<game_id_type> result_games;
+    map<game_id_type, std::pair<vector<game_result_transaction>, vector<uint32_t>>> results_by_game;
     for( uint32_t i = 0; i < game_result_trxs.size(); ++i )
+    {
+        auto& game_results = results_by_game[ game_result_trxs[i].game_id ];
+        if( game_results.first.empty() )
+            result_games.push_back( game_result_trxs[i].game_id );
+        game_results.first.push_back( game_result_trxs[i] );
+        game_results.second.push_back( i );
+    }
+    for( const game_id_type game_id : result_games )
     {
         try
         {
-            auto ogame = _blockchain->get_game_record( game_result_trxs[i].game_id );
+            auto ogame = _blockchain->get_game_record( game_id );
             if ( ogame.valid() )
             {
-                bool has_result = _game_client->get_v8_engine( ogame->name )->scan_result( game_result_trxs[i], block_num, block_header.timestamp, i, self->shared_from_this());
-                
-                if ( has_result )
-                    _dirty_balances = true;
+                const auto& game_results = results_by_game[ game_id ];
+                _game_client->get_v8_engine( ogame->name )->scan_results( game_results.first, game_results.second, block_num,
+                                                                          block_header.timestamp, self->shared_from_this() );
             }
         }
         catch( ... )
@@ -545,8 +552,6 @@ wallet_transaction_record wallet_impl::scan_transaction(
     if( store_record && ( !already_exists || overwrite_existing ) )
         _wallet_db.store_transaction( *transaction_record );
 
-    _dirty_balances |= store_record;
-
     return *transaction_record;
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -1449,6 +1454,16 @@ bool wallet_impl::scan_deposit( const deposit_operation& op, wallet_transaction_
        }
   }
 
+  if( cache_deposit )
+  {
+      // Keys still in the lookahead window must not be handed out again
+      bool claimed_lookahead_key = false;
+      for( const address& owner : op.condition.owners() )
+          claimed_lookahead_key |= _wallet_db.claim_lookahead_key( owner );
+      if( claimed_lookahead_key )
+          refill_key_lookaheads();
+  }
+
   return cache_deposit;
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -1471,7 +1486,7 @@ wallet_transaction_record wallet::scan_transaction( const string& transaction_id
    const auto block = my->_blockchain->get_block_header( block_num );
    const auto record = my->scan_transaction( transaction_record->trx, block_num, block.timestamp, overwrite_existing );
 
-   if( my->_dirty_balances ) my->scan_balances_experimental();
+   my->update_balance_records();
    if( my->_dirty_accounts ) my->scan_accounts();
 
    return record;
@@ -1503,14 +1518,42 @@ void wallet::sign_transaction( signed_transaction& transaction, const unordered_
 void wallet_impl::sign_transaction( signed_transaction& transaction, const unordered_set<address>& required_signatures )const
 { try {
     const auto chain_id = _blockchain->get_chain_id();
+
+    // Keys are looked up and decrypted here because the wallet db is not thread safe
+    vector<private_key_type> signers;
+    signers.reserve( required_signatures.size() );
     for( const auto& addr : required_signatures )
-        transaction.sign( self->get_private_key( addr ), chain_id );
+        signers.push_back( self->get_private_key( addr ) );
+
+    if( signers.size() < 2 )
+    {
+        for( const auto& signer : signers )
+            transaction.sign( signer, chain_id );
+        return;
+    }
+
+    const auto trx_digest = transaction.digest( chain_id );
+    vector<fc::ecc::compact_signature> signatures( signers.size() );
+    vector<fc::future<void>> sign_progress;
+    sign_progress.reserve( signers.size() );
+    for( uint32_t i = 0; i < signers.size(); ++i )
+    {
+        sign_progress.push_back( _scanner_threads[ i % _num_scanner_threads ]->async( [ &, i ]()
+        {
+            signatures[ i ] = signers[ i ].sign_compact( trx_digest );
+        }, "sign transaction" ) );
+    }
+
+    for( auto& fut : sign_progress )
+        fut.wait();
+
+    transaction.signatures.insert( transaction.signatures.end(), signatures.begin(), signatures.end() );
 } FC_CAPTURE_AND_RETHROW( (transaction)(required_signatures) ) }
 
 void wallet::cache_transaction( wallet_transaction_record& transaction_record )
 { try {
    my->_blockchain->store_pending_transaction( transaction_record.trx, true );
-   my->scan_balances_experimental();
+   my->update_balance_records();
 
    transaction_record.record_id = transaction_record.trx.id();
    transaction_record.created_time = blockchain::now();
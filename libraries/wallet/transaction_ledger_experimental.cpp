@@ -13,10 +13,24 @@ void detail::wallet_impl::scan_balances_experimental()
 
     const auto scan_balance = [&]( const balance_record& record )
     {
-        const balance_id_type id = record.id();
-        const obalance_record pending_record = pending_state->get_balance_record( id );
-        if( !pending_record.valid() ) return;
+        refresh_balance_record( record.id(), pending_state );
+    };
+
+    _balance_records.clear();
+    _blockchain->scan_balances( scan_balance );
+
+    _pending_balance_ids.clear();
+    for( const auto& item : pending_state->_balance_id_to_record )
+        _pending_balance_ids.insert( item.first );
+
+    _dirty_balances = false;
+} FC_CAPTURE_AND_RETHROW() }
 
+void detail::wallet_impl::refresh_balance_record( const balance_id_type& id, const pending_chain_state_ptr& pending_state )
+{ try {
+    obalance_record pending_record = pending_state->get_balance_record( id );
+    if( pending_record.valid() )
+    {
         const set<address>& owners = pending_record->owners();
         for( const address& owner : owners )
         {
@@ -24,13 +38,39 @@ void detail::wallet_impl::scan_balances_experimental()
             if( !key_record.valid() || !key_record->has_private_key() ) continue;
 
             _balance_records[ id ] = std::move( *pending_record );
-            break;
+            return;
         }
-    };
+    }
 
-    _balance_records.clear();
-    _blockchain->scan_balances( scan_balance );
-    _dirty_balances = false;
+    _balance_records.erase( id );
+} FC_CAPTURE_AND_RETHROW( (id) ) }
+
+/**
+ *  Brings the owned balance cache up to date without walking the chain's balance table. Block changes
+ *  are applied as they arrive through state_changed(); here we only need to re-read the balances touched
+ *  by unconfirmed transactions, both current ones and those that have since been dropped or confirmed.
+ */
+void detail::wallet_impl::update_balance_records()
+{ try {
+    if( _dirty_balances )
+    {
+        scan_balances_experimental();
+        return;
+    }
+
+    const auto pending_state = _blockchain->get_pending_state();
+
+    unordered_set<balance_id_type> pending_ids;
+    for( const auto& item : pending_state->_balance_id_to_record )
+        pending_ids.insert( item.first );
+
+    for( const balance_id_type& id : _pending_balance_ids )
+        refresh_balance_record( id, pending_state );
+
+    for( const balance_id_type& id : pending_ids )
+        refresh_balance_record( id, pending_state );
+
+    _pending_balance_ids = std::move( pending_ids );
 } FC_CAPTURE_AND_RETHROW() }
 
 void detail::wallet_impl::scan_accounts()
@@ -56,7 +96,7 @@ void detail::wallet_impl::scan_accounts()
     if( self->is_unlocked() )
     {
         _stealth_private_keys.clear();
-        const auto& account_keys = _wallet_db.get_account_private_keys( _wallet_password );
+        const auto& account_keys = get_account_private_keys();
         _stealth_private_keys.reserve( account_keys.size() );
         for( const auto& item : account_keys )
            _stealth_private_keys.push_back( item.first );
@@ -92,7 +132,7 @@ transaction_ledger_entry detail::wallet_impl::scan_transaction_experimental( con
                                                                              const time_point_sec timestamp,
                                                                              bool overwrite_existing )
 { try {
-    const map<private_key_type, string> account_keys = _wallet_db.get_account_private_keys( _wallet_password );
+    const map<private_key_type, string> account_keys = get_account_private_keys();
 
     // TODO: Move this into a separate function
     map<address, string> account_balances;
@@ -764,8 +804,6 @@ void detail::wallet_impl::scan_transaction_experimental( const transaction_evalu
         ulog( "wallet_transaction_record_v2:\n${rec}", ("rec",fc::json::to_pretty_string( record )) );
         _wallet_db.experimental_transactions[ record.id ] = record;
     }
-
-    _dirty_balances |= relevant_to_me;
 } FC_CAPTURE_AND_RETHROW( (eval_state)(account_balances)(account_names)(record)(store_record) ) }
 
 transaction_ledger_entry detail::wallet_impl::apply_transaction_experimental( const signed_transaction& transaction )
@@ -38,6 +38,25 @@ namespace detail {
        self->start_scan( std::min( self->get_last_scanned_block_number() + 1, block_data.block_num ), -1 );
    }
 
+   void wallet_impl::state_changed( const pending_chain_state_ptr& state )
+   {
+       if( !self->is_open() || _dirty_balances ) return;
+
+       try
+       {
+           const auto pending_state = _blockchain->get_pending_state();
+           for( const auto& item : state->_balance_id_to_record )
+               refresh_balance_record( item.first, pending_state );
+           for( const balance_id_type& id : state->_balance_id_remove )
+               refresh_balance_record( id, pending_state );
+       }
+       catch( const fc::exception& e )
+       {
+           wlog( "Failed to apply balance changes; scheduling a full balance scan: ${e}", ("e",e.to_detail_string()) );
+           _dirty_balances = true;
+       }
+   }
+
    void wallet_impl::block_popped( const pending_chain_state_ptr& )
    {
        if( !self->is_open() || !self->is_unlocked() ) return;
@@ -62,38 +81,29 @@ namespace detail {
            )const
    { try {
       FC_ASSERT( !from_account_name.empty() );
-      auto amount_remaining = amount_to_withdraw;
 
-      const account_balance_record_summary_type balance_records = self->get_spendable_account_balance_records( from_account_name );
-      if( balance_records.find( from_account_name ) == balance_records.end() )
-         FC_CAPTURE_AND_THROW( insufficient_funds, (from_account_name)(amount_to_withdraw)(balance_records) );
-      for( const auto& record : balance_records.at( from_account_name ) )
-      {
-          const asset balance = record.get_spendable_balance( _blockchain->get_pending_state()->now() );
-          if( balance.amount <= 0 || balance.asset_id != amount_remaining.asset_id )
-              continue;
+      balance_selector selector( self->get_spendable_account_balance_records( from_account_name ),
+                                 _blockchain->get_pending_state()->now() );
+      withdraw_to_transaction( amount_to_withdraw, from_account_name, trx, required_signatures, selector );
+   } FC_CAPTURE_AND_RETHROW( (amount_to_withdraw)(from_account_name)(trx)(required_signatures) ) }
 
-          const auto owner = record.owner();
-          if( !owner.valid() )
-              continue;
+   void wallet_impl::withdraw_to_transaction(
+           const asset& amount_to_withdraw,
+           const string& from_account_name,
+           signed_transaction& trx,
+           unordered_set<address>& required_signatures,
+           balance_selector& selector
+           )const
+   { try {
+      FC_ASSERT( !from_account_name.empty() );
 
-          if( amount_remaining.amount > balance.amount )
-          {
-              trx.withdraw( record.id(), balance.amount );
-              required_signatures.insert( *owner );
-              amount_remaining -= balance;
-          }
-          else
-          {
-              trx.withdraw( record.id(), amount_remaining.amount );
-              required_signatures.insert( *owner );
-              return;
-          }
+      if( !selector.withdraw( from_account_name, amount_to_withdraw, trx, required_signatures ) )
+      {
+          const string required = _blockchain->to_pretty_asset( amount_to_withdraw );
+          const string available = _blockchain->to_pretty_asset( asset( selector.get_balance( from_account_name, amount_to_withdraw.asset_id ),
+                                                                        amount_to_withdraw.asset_id ) );
+          FC_CAPTURE_AND_THROW( insufficient_funds, (required)(available) );
       }
-
-      const string required = _blockchain->to_pretty_asset( amount_to_withdraw );
-      const string available = _blockchain->to_pretty_asset( amount_to_withdraw - amount_remaining );
-      FC_CAPTURE_AND_THROW( insufficient_funds, (required)(available)(balance_records) );
    } FC_CAPTURE_AND_RETHROW( (amount_to_withdraw)(from_account_name)(trx)(required_signatures) ) }
 
    wallet_contact_record wallet_impl::generic_recipient_to_contact( const string& generic_recipient )const
@@ -287,6 +297,201 @@ namespace detail {
        }
    }
 
+   void wallet_impl::refill_key_lookaheads()
+   {
+       if( !_key_lookahead_refill_done.valid() || _key_lookahead_refill_done.ready() )
+           _key_lookahead_refill_done = fc::async( [ this ](){ refill_key_lookaheads_task(); }, "refill_key_lookaheads_task" );
+   }
+
+   void wallet_impl::refill_key_lookaheads_task()
+   { try {
+       vector<string> account_names;
+       for( const auto& item : _wallet_db.get_accounts() )
+           account_names.push_back( item.second.name );
+
+       for( const string& account_name : account_names )
+       {
+           if( !self->is_open() || !self->is_unlocked() ) return;
+
+           const owallet_account_record account_record = _wallet_db.lookup_account( account_name );
+           if( !account_record.valid() || account_record->is_retracted() ) continue;
+
+           const public_key_type parent_public_key = account_record->active_key();
+           const owallet_key_record parent_key_record = _wallet_db.lookup_key( address( parent_public_key ) );
+           if( !parent_key_record.valid() || !parent_key_record->has_private_key() ) continue;
+
+           key_lookahead lookahead;
+           lookahead.account_address = account_record->owner_address();
+           lookahead.parent_key = parent_public_key;
+
+           const owallet_key_lookahead_record lookahead_record = _wallet_db.lookup_key_lookahead( lookahead.account_address );
+           if( lookahead_record.valid() && lookahead_record->parent_key == parent_public_key )
+           {
+               for( const lookahead_key& key : lookahead_record->keys )
+               {
+                   if( key.child_key_index > account_record->last_child_key_index )
+                       lookahead.keys.push_back( key );
+               }
+           }
+
+           if( lookahead.keys.size() >= BTS_WALLET_ACCOUNT_KEY_LOOKAHEAD ) continue;
+
+           uint32_t first_child_key_index = account_record->last_child_key_index + 1;
+           if( !lookahead.keys.empty() )
+               first_child_key_index = lookahead.keys.back().child_key_index + 1;
+
+           const uint32_t count = BTS_WALLET_ACCOUNT_KEY_LOOKAHEAD - lookahead.keys.size();
+
+           const fc::sha512 password = _wallet_password;
+           const private_key_type parent_private_key = parent_key_record->decrypt_private_key( password );
+
+           // Shared with the scanner threads so they stay valid if this task is canceled mid-derivation
+           const auto derived_keys = std::make_shared<vector<lookahead_key>>( count );
+           const address account_address = lookahead.account_address;
+           vector<fc::future<void>> derive_key_progress;
+           derive_key_progress.reserve( count );
+           for( uint32_t i = 0; i < count; ++i )
+           {
+               derive_key_progress.push_back( _scanner_threads[ i % _num_scanner_threads ]->async(
+                       [ this, i, derived_keys, account_address, first_child_key_index, password, parent_private_key ]()
+               {
+                   lookahead_key& key = derived_keys->at( i );
+                   key.account_address = account_address;
+                   key.child_key_index = first_child_key_index + i;
+                   key.encrypt_private_key( password, _wallet_db.get_account_child_key( parent_private_key, key.child_key_index ) );
+                   key.derive_addresses();
+               }, "derive lookahead key" ) );
+           }
+
+           for( auto& fut : derive_key_progress )
+               fut.wait();
+
+           // The wallet may have been locked or the account changed while we were deriving
+           if( !self->is_open() || !self->is_unlocked() ) return;
+           const owallet_account_record current_account_record = _wallet_db.lookup_account( account_name );
+           if( !current_account_record.valid() || current_account_record->active_key() != parent_public_key ) continue;
+
+           lookahead.keys.insert( lookahead.keys.end(), derived_keys->begin(), derived_keys->end() );
+           _wallet_db.store_key_lookahead( lookahead );
+       }
+   } FC_CAPTURE_AND_RETHROW() }
+
+   void wallet_impl::fill_private_key_cache()
+   {
+       if( !_private_key_cache_filled.valid() || _private_key_cache_filled.ready() )
+           _private_key_cache_filled = fc::async( [ this ](){ fill_private_key_cache_task(); }, "fill_private_key_cache_task" );
+   }
+
+   void wallet_impl::fill_private_key_cache_task()
+   { try {
+       typedef vector<std::pair<address, private_key_type>,
+                      bts::utilities::secure_allocator<std::pair<address, private_key_type>>> decrypted_keys_type;
+
+       // Copied out because the wallet db must only be touched from this thread
+       const auto encrypted_keys = std::make_shared<vector<std::pair<address, vector<char>>>>();
+       for( const auto& item : _wallet_db.get_keys() )
+       {
+           const wallet_key_record& key_record = item.second;
+           if( !key_record.has_private_key() ) continue;
+           if( _private_key_cache.count( item.first ) > 0 ) continue;
+           encrypted_keys->emplace_back( item.first, key_record.encrypted_private_key );
+       }
+       if( encrypted_keys->empty() ) return;
+
+       const fc::sha512 password = _wallet_password;
+       const size_t num_threads = std::min<size_t>( _num_scanner_threads, encrypted_keys->size() );
+       const auto decrypted_keys = std::make_shared<vector<decrypted_keys_type>>( num_threads );
+
+       vector<fc::future<void>> decrypt_progress;
+       decrypt_progress.reserve( num_threads );
+       for( size_t t = 0; t < num_threads; ++t )
+       {
+           decrypt_progress.push_back( _scanner_threads[ t ]->async( [ t, num_threads, encrypted_keys, decrypted_keys, password ]()
+           {
+               for( size_t i = t; i < encrypted_keys->size(); i += num_threads )
+               {
+                   try
+                   {
+                       key_data key;
+                       key.encrypted_private_key = encrypted_keys->at( i ).second;
+                       decrypted_keys->at( t ).emplace_back( encrypted_keys->at( i ).first,
+                                                              key.decrypt_private_key( password ) );
+                   }
+                   catch( const fc::exception& e )
+                   {
+                       elog( "Error decrypting private key: ${e}", ("e",e.to_detail_string()) );
+                   }
+               }
+           }, "decrypt private keys" ) );
+       }
+
+       for( auto& fut : decrypt_progress )
+           fut.wait();
+
+       if( !self->is_open() || !self->is_unlocked() ) return;
+       for( const decrypted_keys_type& keys : *decrypted_keys )
+           _private_key_cache.insert( keys.begin(), keys.end() );
+   } FC_CAPTURE_AND_RETHROW() }
+
+   void wallet_impl::clear_private_key_cache()
+   {
+       try
+       {
+         _private_key_cache_filled.cancel_and_wait( "wallet_impl::clear_private_key_cache()" );
+       }
+       catch( const fc::exception& e )
+       {
+         wlog( "Unexpected exception from wallet's fill_private_key_cache_task() : ${e}", ("e", e) );
+       }
+       catch( ... )
+       {
+         wlog( "Unexpected exception from wallet's fill_private_key_cache_task()" );
+       }
+
+       // The secure allocator zeroes every node and bucket as it is released
+       private_key_cache_type().swap( _private_key_cache );
+   }
+
+   private_key_type wallet_impl::get_private_key( const address& addr )const
+   { try {
+       const owallet_key_record key_record = _wallet_db.lookup_key( addr );
+       FC_ASSERT( key_record.valid() );
+       FC_ASSERT( key_record->has_private_key() );
+
+       const address key_address = key_record->get_address();
+       const auto iter = _private_key_cache.find( key_address );
+       if( iter != _private_key_cache.end() )
+           return iter->second;
+
+       const private_key_type private_key = key_record->decrypt_private_key( _wallet_password );
+       _private_key_cache[ key_address ] = private_key;
+       return private_key;
+   } FC_CAPTURE_AND_RETHROW( (addr) ) }
+
+   map<private_key_type, string> wallet_impl::get_account_private_keys()const
+   { try {
+       map<private_key_type, string> private_keys;
+       for( const auto& item : _wallet_db.get_account_public_keys() )
+       {
+           const public_key_type& public_key = item.first;
+           const string& account_name = item.second;
+
+           const owallet_key_record key_record = _wallet_db.lookup_key( public_key );
+           if( !key_record.valid() || !key_record->has_private_key() )
+               continue;
+
+           try
+           {
+               private_keys[ get_private_key( public_key ) ] = account_name;
+           }
+           catch( const fc::exception& e )
+           {
+               elog( "Error decrypting private key: ${e}", ("e",e.to_detail_string()) );
+           }
+       }
+       return private_keys;
+   } FC_CAPTURE_AND_RETHROW() }
+
    void wallet_impl::start_scan_task( const uint32_t start_block_num, const uint32_t limit )
    { try {
        fc::oexception scan_exception;
@@ -353,7 +558,7 @@ namespace detail {
                ulog( "Scan complete." );
            }
 
-           if( _dirty_balances ) scan_balances_experimental();
+           update_balance_records();
            if( _dirty_accounts ) scan_accounts();
        }
        catch( const fc::exception& e )
@@ -761,7 +966,9 @@ namespace detail {
       const auto current_account = _wallet_db.lookup_account( account_name );
       FC_ASSERT( current_account.valid() );
 
-      return _wallet_db.generate_new_account_child_key( _wallet_password, account_name );
+      const private_key_type new_private_key = _wallet_db.generate_new_account_child_key( _wallet_password, account_name );
+      refill_key_lookaheads();
+      return new_private_key;
    } FC_CAPTURE_AND_RETHROW( (account_name) ) }
 
    public_key_type wallet_impl::get_new_public_key( const string& account_name )
@@ -1230,7 +1437,9 @@ namespace detail {
           wallet_lock_state_changed( false );
           ilog( "Wallet unlocked until time: ${t}", ("t", fc::time_point_sec(*my->_scheduled_lock_time)) );
 
+          my->fill_private_key_cache();
           my->scan_accounts();
+          my->refill_key_lookaheads();
       }
       catch( ... )
       {
@@ -1248,6 +1457,19 @@ namespace detail {
    {
       cancel_scan();
 
+      try
+      {
+        my->_key_lookahead_refill_done.cancel_and_wait( "wallet::lock()" );
+      }
+      catch( const fc::exception& e )
+      {
+        wlog( "Unexpected exception from wallet's refill_key_lookaheads_task() : ${e}", ("e", e) );
+      }
+      catch( ... )
+      {
+        wlog( "Unexpected exception from wallet's refill_key_lookaheads_task()" );
+      }
+
       try
       {
         my->_login_map_cleaner_done.cancel_and_wait("wallet::lock()");
@@ -1261,6 +1483,7 @@ namespace detail {
         wlog("Unexpected exception from wallet's login_map_cleaner()");
       }
 
+      my->clear_private_key_cache();
       my->_stealth_private_keys.clear();
       my->_dirty_accounts = true;
       my->_wallet_password = fc::sha512();
@@ -1342,6 +1565,7 @@ namespace detail {
           set_last_scanned_block_number( my->_blockchain->get_head_block_num() );
 
        my->_dirty_accounts = true;
+       my->refill_key_lookaheads();
 
       return account_public_key;
    } FC_CAPTURE_AND_RETHROW( (account_name) ) }
@@ -1463,6 +1687,9 @@ namespace detail {
       if( NOT is_open()     ) FC_CAPTURE_AND_THROW( wallet_closed );
       if( NOT is_unlocked() ) FC_CAPTURE_AND_THROW( wallet_locked );
 
+      // Existing balances owned by the new key can only be found with a full pass
+      my->_dirty_balances = true;
+
       const public_key_type new_public_key = new_private_key.get_public_key();
       const address new_address = address( new_public_key );
 
@@ -1605,10 +1832,7 @@ namespace detail {
       FC_ASSERT( is_open() );
       FC_ASSERT( is_unlocked() );
 
-      auto key = my->_wallet_db.lookup_key( addr );
-      FC_ASSERT( key.valid() );
-      FC_ASSERT( key->has_private_key() );
-      return key->decrypt_private_key( my->_wallet_password );
+      return my->get_private_key( addr );
    } FC_CAPTURE_AND_RETHROW( (addr) ) }
 
    public_key_type  wallet::get_public_key( const address& addr) const
@@ -2539,7 +2763,7 @@ namespace detail {
        FC_ASSERT( withdraw_condition.memo.valid() );
 
        omemo_status status;
-       const map<private_key_type, string> account_keys = my->_wallet_db.get_account_private_keys( my->_wallet_password );
+       const map<private_key_type, string> account_keys = my->get_account_private_keys();
        for( const auto& key_item : account_keys )
        {
            const private_key_type& key = key_item.first;
@@ -2599,9 +2823,7 @@ namespace detail {
 
        trx.expiration = blockchain::now() + get_transaction_expiration();
 
-       owallet_key_record delegate_key = my->_wallet_db.lookup_key( delegate_account_record->active_key() );
-       FC_ASSERT( delegate_key && delegate_key->has_private_key() );
-       const auto delegate_private_key = delegate_key->decrypt_private_key( my->_wallet_password );
+       const auto delegate_private_key = my->get_private_key( delegate_account_record->active_key() );
        const auto delegate_public_key = delegate_private_key.get_public_key();
        required_signatures.insert( delegate_public_key );
 
@@ -3179,6 +3401,88 @@ namespace detail {
       return record;
    } FC_CAPTURE_AND_RETHROW( (amount)(sender_account_name)(generic_recipient)(memo)(strategy)(sign) ) }
 
+   vector<wallet_transaction_record> wallet::batch_transfer(
+           const vector<std::pair<string, asset>>& payouts,
+           const string& sender_account_name,
+           const string& memo,
+           const vote_strategy strategy,
+           bool sign
+           )
+   { try {
+      if( NOT is_open()     ) FC_CAPTURE_AND_THROW( wallet_closed );
+      if( NOT is_unlocked() ) FC_CAPTURE_AND_THROW( wallet_locked );
+
+      const owallet_account_record sender_account = lookup_account( sender_account_name );
+      if( !sender_account.valid() )
+          FC_CAPTURE_AND_THROW( unknown_wallet_account );
+
+      // One snapshot of the sender's balances funds every transaction in the batch
+      balance_selector selector( get_spendable_account_balance_records( sender_account->name ),
+                                 my->_blockchain->get_pending_state()->now() );
+
+      map<asset_id_type, asset> fees;
+      const auto get_fee = [&]( const asset_id_type asset_id ) -> asset
+      {
+          const auto iter = fees.find( asset_id );
+          if( iter != fees.end() ) return iter->second;
+          return fees[ asset_id ] = get_transaction_fee( asset_id );
+      };
+
+      vector<wallet_transaction_record> records;
+      records.reserve( (payouts.size() + BTS_WALLET_MAX_DEPOSITS_PER_BATCH_TRANSACTION - 1) / BTS_WALLET_MAX_DEPOSITS_PER_BATCH_TRANSACTION );
+
+      for( size_t begin = 0; begin < payouts.size(); begin += BTS_WALLET_MAX_DEPOSITS_PER_BATCH_TRANSACTION )
+      {
+          const size_t end = std::min<size_t>( payouts.size(), begin + BTS_WALLET_MAX_DEPOSITS_PER_BATCH_TRANSACTION );
+
+          wallet_transaction_record record;
+          signed_transaction& trx = record.trx;
+          unordered_set<address> required_signatures;
+
+          trx.expiration = blockchain::now() + get_transaction_expiration();
+
+          map<asset_id_type, share_type> required_amounts;
+          for( size_t i = begin; i < end; ++i )
+          {
+              const asset& amount = payouts[ i ].second;
+              if( amount.amount <= 0 )
+                  FC_THROW_EXCEPTION( invalid_asset_amount, "Cannot transfer a non-positive amount!", ("payout",payouts[ i ]) );
+
+              const wallet_contact_record recipient = my->generic_recipient_to_contact( payouts[ i ].first );
+              const public_key_type recipient_key = my->deposit_from_transaction( trx, amount, *sender_account, recipient, memo );
+              required_amounts[ amount.asset_id ] += amount.amount;
+
+              auto entry = ledger_entry();
+              entry.from_account = sender_account->owner_key;
+              entry.to_account = recipient_key;
+              entry.amount = amount;
+              entry.memo = memo;
+              record.ledger_entries.push_back( entry );
+          }
+
+          record.fee = get_fee( payouts[ begin ].second.asset_id );
+          required_amounts[ record.fee.asset_id ] += record.fee.amount;
+
+          for( const auto& item : required_amounts )
+          {
+              my->withdraw_to_transaction( asset( item.second, item.first ),
+                                           sender_account->name,
+                                           trx,
+                                           required_signatures,
+                                           selector );
+          }
+
+          my->set_delegate_slate( trx, strategy );
+
+          if( sign )
+              my->sign_transaction( trx, required_signatures );
+
+          records.push_back( std::move( record ) );
+      }
+
+      return records;
+   } FC_CAPTURE_AND_RETHROW( (sender_account_name)(memo)(strategy)(sign) ) }
+
    wallet_transaction_record wallet::register_account(
            const string& account_to_register,
            const variant& public_data,
@@ -4505,7 +4809,7 @@ namespace detail {
                 ("name",account_name) );
 
       FC_ASSERT( opt_key->has_private_key() );
-      return opt_key->decrypt_private_key( my->_wallet_password );
+      return my->get_private_key( opt_key->get_address() );
    } FC_CAPTURE_AND_RETHROW( (account_name) ) }
 
    public_key_type wallet::get_active_public_key( const string& account_name )const
@@ -4972,29 +5276,49 @@ namespace detail {
       FC_ASSERT( quote_symbol.empty() || quote_record.valid() );
       FC_ASSERT( base_symbol.empty() || base_record.valid() );
 
-      const auto filter = [&]( const market_order& order ) -> bool
+      optional<address> account_address;
+      if( !account_name.empty() )
       {
-          if( quote_record.valid() && order.market_index.order_price.quote_asset_id != quote_record->id )
-              return false;
+          const owallet_account_record account_record = my->_wallet_db.lookup_account( account_name );
+          if( !account_record.valid() )
+              return order_map;
+          account_address = account_record->account_address;
+      }
 
-          if( base_record.valid() && order.market_index.order_price.base_asset_id != base_record->id )
-              return false;
+      // Look up our own keys in the chain's owner index instead of scanning every open order
+      vector<market_order> orders;
+      for( const auto& item : my->_wallet_db.get_keys() )
+      {
+          const wallet_key_record& key_record = item.second;
+          if( !key_record.has_private_key() )
+              continue;
 
-          const owallet_key_record key_record = my->_wallet_db.lookup_key( order.get_owner() );
-          if( !key_record.valid() || !key_record->has_private_key() )
-              return false;
+          if( account_address.valid() && key_record.account_address != *account_address )
+              continue;
 
-          if( !account_name.empty() )
+          for( const market_order& order : my->_blockchain->get_market_orders_by_owner( item.first ) )
           {
-              const owallet_account_record account_record = my->_wallet_db.lookup_account( key_record->account_address );
-              if( !account_record.valid() || account_record->name != account_name )
-                  return false;
+              if( quote_record.valid() && order.market_index.order_price.quote_asset_id != quote_record->id )
+                  continue;
+
+              if( base_record.valid() && order.market_index.order_price.base_asset_id != base_record->id )
+                  continue;
+
+              orders.push_back( order );
           }
+      }
 
-          return true;
-      };
+      // Same selection a full scan would have made: asks before bids, each in market index order
+      std::sort( orders.begin(), orders.end(), []( const market_order& a, const market_order& b )
+      {
+          const bool a_is_ask = a.type == ask_order;
+          const bool b_is_ask = b.type == ask_order;
+          if( a_is_ask != b_is_ask ) return a_is_ask;
+          return a.market_index < b.market_index;
+      } );
+      if( orders.size() > limit )
+          orders.erase( orders.begin() + limit, orders.end() );
 
-      const auto orders = my->_blockchain->scan_market_orders( filter, limit );
       for( const auto& order : orders )
           order_map[ order.get_id() ] = order;
 
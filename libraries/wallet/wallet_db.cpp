@@ -1,9 +1,11 @@
+#include <bts/blockchain/key_address_cache.hpp>
 #include <bts/blockchain/time.hpp>
 #include <bts/db/level_map.hpp>
 #include <bts/wallet/exceptions.hpp>
 #include <bts/wallet/wallet_db.hpp>
 
 #include <fc/io/json.hpp>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -65,6 +67,9 @@ namespace bts { namespace wallet {
                    case packet_info_record_type:
                        load_packet_record( record.as<wallet_packet_record>() );
                        break;
+                   case key_lookahead_record_type:
+                       load_key_lookahead_record( record.as<wallet_key_lookahead_record>() );
+                       break;
                    default:
                        elog( "Unknown wallet record type: ${type}", ("type",record.type) );
                        break;
@@ -108,11 +113,8 @@ namespace bts { namespace wallet {
                self->keys[ key_address ] = key_record;
 
                // Cache address map
-               self->btc_to_bts_address[ key_address ] = key_address;
-               self->btc_to_bts_address[ address( pts_address( key_record.public_key, false, 0  ) ) ] = key_address; // Uncompressed BTC
-               self->btc_to_bts_address[ address( pts_address( key_record.public_key, true,  0  ) ) ] = key_address; // Compressed BTC
-               self->btc_to_bts_address[ address( pts_address( key_record.public_key, false, 56 ) ) ] = key_address; // Uncompressed PTS
-               self->btc_to_bts_address[ address( pts_address( key_record.public_key, true,  56 ) ) ] = key_address; // Compressed PTS
+               for( const address& derived_address : key_address_cache::instance().get_addresses( key_record.public_key ) )
+                   self->btc_to_bts_address[ derived_address ] = key_address;
            } FC_CAPTURE_AND_RETHROW( (key_record) ) }
 
            void load_contact_record( const wallet_contact_record& record )
@@ -175,6 +177,39 @@ namespace bts { namespace wallet {
              const packet_id_type& record_id = packet_record.packet_id;
              self->packets[ record_id ] = packet_record;
          } FC_CAPTURE_AND_RETHROW( (packet_record) ) }
+
+           void load_key_lookahead_record( const wallet_key_lookahead_record& lookahead_record )
+           { try {
+               unload_key_lookahead_record( lookahead_record.account_address );
+               self->key_lookaheads[ lookahead_record.account_address ] = lookahead_record;
+
+               // Cache address map
+               for( const lookahead_key& key : lookahead_record.keys )
+               {
+                   const address key_address = key.get_address();
+                   self->lookahead_keys[ key_address ] = key;
+                   self->lookahead_btc_to_bts_address[ key_address ] = key_address;
+                   for( const address& derived_address : key.derived_addresses )
+                       self->lookahead_btc_to_bts_address[ derived_address ] = key_address;
+               }
+           } FC_CAPTURE_AND_RETHROW( (lookahead_record) ) }
+
+           void unload_key_lookahead_record( const address& account_address )
+           {
+               const auto iter = self->key_lookaheads.find( account_address );
+               if( iter == self->key_lookaheads.end() )
+                   return;
+
+               for( const lookahead_key& key : iter->second.keys )
+               {
+                   const address key_address = key.get_address();
+                   self->lookahead_keys.erase( key_address );
+                   self->lookahead_btc_to_bts_address.erase( key_address );
+                   for( const address& derived_address : key.derived_addresses )
+                       self->lookahead_btc_to_bts_address.erase( derived_address );
+               }
+               self->key_lookaheads.erase( iter );
+           }
      };
 
    } // namespace detail
@@ -234,6 +269,10 @@ namespace bts { namespace wallet {
       keys.clear();
       btc_to_bts_address.clear();
 
+      key_lookaheads.clear();
+      lookahead_keys.clear();
+      lookahead_btc_to_bts_address.clear();
+
       transactions.clear();
       id_to_transaction_record_index.clear();
 
@@ -459,36 +498,60 @@ namespace bts { namespace wallet {
        FC_ASSERT( parent_key_record->has_private_key(), "Parent private key not found!" );
 
        const private_key_type parent_private_key = parent_key_record->decrypt_private_key( password );
+
+       // Prefer keys that have already been derived in the background
+       owallet_key_lookahead_record lookahead_record = lookup_key_lookahead( account_record->owner_address() );
+       if( lookahead_record.valid() && lookahead_record->parent_key != parent_public_key )
+           lookahead_record.reset();
+
        uint32_t child_key_index = account_record->last_child_key_index;
        private_key_type account_child_private_key;
-       public_key_type account_child_public_key;
-       address account_child_address;
+       key_data child_key;
        while( true )
        {
            ++child_key_index;
            FC_ASSERT( child_key_index != 0, "Overflow!" );
 
-           account_child_private_key = get_account_child_key( parent_private_key, child_key_index );
-           account_child_public_key = account_child_private_key.get_public_key();
-           account_child_address = address( account_child_public_key );
+           optional<lookahead_key> precomputed_key;
+           if( lookahead_record.valid() )
+           {
+               for( const lookahead_key& key : lookahead_record->keys )
+               {
+                   if( key.child_key_index != child_key_index ) continue;
+                   precomputed_key = key;
+                   break;
+               }
+           }
+
+           if( precomputed_key.valid() )
+           {
+               account_child_private_key = precomputed_key->decrypt_private_key( password );
+               child_key = *precomputed_key;
+           }
+           else
+           {
+               account_child_private_key = get_account_child_key( parent_private_key, child_key_index );
+               child_key = key_data();
+               child_key.child_key_index = child_key_index;
+               child_key.encrypt_private_key( password, account_child_private_key );
+           }
 
-           owallet_key_record child_key_record = lookup_key( account_child_address );
-           if( child_key_record.valid() && child_key_record->has_private_key() ) continue;
+           // Check the stored keys directly since lookup_key() also matches lookahead keys
+           const auto key_iter = keys.find( child_key.get_address() );
+           if( key_iter != keys.end() && key_iter->second.has_private_key() ) continue;
 
            break;
        }
 
        account_record->last_child_key_index = child_key_index;
-
-       key_data child_key;
        child_key.account_address = account_record->owner_address();
-       child_key.child_key_index = child_key_index;
-       child_key.public_key = account_child_public_key;
-       child_key.encrypt_private_key( password, account_child_private_key );
 
        store_account( *account_record );
        store_key( child_key );
 
+       if( lookahead_record.valid() )
+           store_key_lookahead( *lookahead_record );
+
        return account_child_private_key;
    } FC_CAPTURE_AND_RETHROW( (account_name) ) }
 
@@ -650,6 +713,19 @@ namespace bts { namespace wallet {
                return key_record;
            }
        }
+
+       // Keys that have not been handed out yet can still receive funds
+       const auto lookahead_map_iter = lookahead_btc_to_bts_address.find( derived_address );
+       if( lookahead_map_iter != lookahead_btc_to_bts_address.end() )
+       {
+           const address& key_address = lookahead_map_iter->second;
+           const auto key_iter = lookahead_keys.find( key_address );
+           if( key_iter != lookahead_keys.end() )
+           {
+               const key_data& key = key_iter->second;
+               return wallet_key_record( key );
+           }
+       }
        return owallet_key_record();
    } FC_CAPTURE_AND_RETHROW( (derived_address) ) }
 
@@ -684,6 +760,77 @@ namespace bts { namespace wallet {
        }
    } FC_CAPTURE_AND_RETHROW( (key) ) }
 
+   owallet_key_lookahead_record wallet_db::lookup_key_lookahead( const address& account_address )const
+   { try {
+       FC_ASSERT( is_open() );
+       const auto iter = key_lookaheads.find( account_address );
+       if( iter != key_lookaheads.end() )
+       {
+           const wallet_key_lookahead_record& lookahead_record = iter->second;
+           return lookahead_record;
+       }
+       return owallet_key_lookahead_record();
+   } FC_CAPTURE_AND_RETHROW( (account_address) ) }
+
+   void wallet_db::store_key_lookahead( const key_lookahead& lookahead )
+   { try {
+       FC_ASSERT( is_open() );
+
+       const owallet_account_record account_record = lookup_account( lookahead.account_address );
+       FC_ASSERT( account_record.valid(), "Account not found!" );
+
+       owallet_key_lookahead_record lookahead_record = lookup_key_lookahead( lookahead.account_address );
+       if( !lookahead_record.valid() )
+           lookahead_record = wallet_key_lookahead_record();
+
+       key_lookahead& temp = *lookahead_record;
+       temp = lookahead;
+
+       // Drop keys that have already been handed out
+       const uint32_t last_child_key_index = account_record->last_child_key_index;
+       vector<lookahead_key>& remaining_keys = lookahead_record->keys;
+       remaining_keys.erase( std::remove_if( remaining_keys.begin(), remaining_keys.end(),
+                                             [ & ]( const lookahead_key& key )
+                                             {
+                                                 return key.child_key_index <= last_child_key_index;
+                                             } ), remaining_keys.end() );
+
+       store_and_reload_record( *lookahead_record );
+   } FC_CAPTURE_AND_RETHROW( (lookahead.account_address) ) }
+
+   /* Funds seen on a lookahead key mean it was handed out elsewhere, e.g. by the wallet this one was restored from */
+   bool wallet_db::claim_lookahead_key( const address& derived_address )
+   { try {
+       FC_ASSERT( is_open() );
+
+       const auto lookahead_map_iter = lookahead_btc_to_bts_address.find( derived_address );
+       if( lookahead_map_iter == lookahead_btc_to_bts_address.end() ) return false;
+       const auto key_iter = lookahead_keys.find( lookahead_map_iter->second );
+       if( key_iter == lookahead_keys.end() ) return false;
+       const key_data claimed_key = key_iter->second;
+
+       owallet_account_record account_record = lookup_account( claimed_key.account_address );
+       const owallet_key_lookahead_record lookahead_record = lookup_key_lookahead( claimed_key.account_address );
+       if( !account_record.valid() || !lookahead_record.valid() ) return false;
+
+       // Earlier keys in the window may have been handed out too, so keep matching them once they are pruned
+       for( const lookahead_key& key : lookahead_record->keys )
+       {
+           if( key.child_key_index > claimed_key.child_key_index ) continue;
+           if( keys.find( key.get_address() ) != keys.end() ) continue;
+           store_key( key );
+       }
+
+       if( account_record->last_child_key_index < claimed_key.child_key_index )
+       {
+           account_record->last_child_key_index = claimed_key.child_key_index;
+           store_account( *account_record );
+       }
+
+       store_key_lookahead( *lookahead_record );
+       return true;
+   } FC_CAPTURE_AND_RETHROW( (derived_address) ) }
+
    void wallet_db::import_key( const fc::sha512& password, const string& account_name, const private_key_type& private_key,
                                bool move_existing )
    { try {
@@ -901,7 +1048,7 @@ namespace bts { namespace wallet {
    } FC_CAPTURE_AND_RETHROW() }
 
    // Only returns private keys corresponding to owner and active keys
-   map<private_key_type, string> wallet_db::get_account_private_keys( const fc::sha512& password )const
+   map<public_key_type, string> wallet_db::get_account_public_keys()const
    { try {
        map<public_key_type, string> public_keys;
        for( const auto& account_item : accounts )
@@ -915,27 +1062,7 @@ namespace bts { namespace wallet {
                    public_keys[ active_key ] = account.name;
            }
        }
-
-       map<private_key_type, string> private_keys;
-       for( const auto& public_key_item : public_keys )
-       {
-           const auto& public_key = public_key_item.first;
-           const auto& account_name = public_key_item.second;
-
-           const auto key_record = lookup_key( public_key );
-           if( !key_record.valid() || !key_record->has_private_key() )
-               continue;
-
-           try
-           {
-               private_keys[ key_record->decrypt_private_key( password ) ] = account_name;
-           }
-           catch( const fc::exception& e )
-           {
-               elog( "Error decrypting private key: ${e}", ("e",e.to_detail_string()) );
-           }
-       }
-       return private_keys;
+       return public_keys;
    } FC_CAPTURE_AND_RETHROW() }
 
    void wallet_db::repair_records( const fc::sha512& password )
@@ -982,11 +1109,8 @@ namespace bts { namespace wallet {
                        if( key_record.public_key != public_key )
                        {
                            keys.erase( key_address );
-                           btc_to_bts_address.erase( key_address );
-                           btc_to_bts_address.erase( address( pts_address( key_record.public_key, false, 0  ) ) );
-                           btc_to_bts_address.erase( address( pts_address( key_record.public_key, true,  0  ) ) );
-                           btc_to_bts_address.erase( address( pts_address( key_record.public_key, false, 56 ) ) );
-                           btc_to_bts_address.erase( address( pts_address( key_record.public_key, true,  56 ) ) );
+                           for( const address& derived_address : key_address_cache::instance().get_addresses( key_record.public_key ) )
+                               btc_to_bts_address.erase( derived_address );
 
                            key_record.public_key = public_key;
                            my->load_key_record( key_record );
@@ -995,11 +1119,8 @@ namespace bts { namespace wallet {
                    else
                    {
                        keys.erase( key_address );
-                       btc_to_bts_address.erase( key_address );
-                       btc_to_bts_address.erase( address( pts_address( key_record.public_key, false, 0  ) ) );
-                       btc_to_bts_address.erase( address( pts_address( key_record.public_key, true,  0  ) ) );
-                       btc_to_bts_address.erase( address( pts_address( key_record.public_key, false, 56 ) ) );
-                       btc_to_bts_address.erase( address( pts_address( key_record.public_key, true,  56 ) ) );
+                       for( const address& derived_address : key_address_cache::instance().get_addresses( key_record.public_key ) )
+                           btc_to_bts_address.erase( derived_address );
                        remove_item( key_record.wallet_record_index );
                        continue;
                    }
@@ -1263,6 +1384,20 @@ namespace bts { namespace wallet {
             store_and_reload_record( key.second, true );
          }
       }
+
+      vector<wallet_key_lookahead_record> lookahead_records;
+      for( const auto& item : key_lookaheads )
+         lookahead_records.push_back( item.second );
+
+      for( auto& lookahead_record : lookahead_records )
+      {
+         for( lookahead_key& key : lookahead_record.keys )
+         {
+            const auto priv_key = key.decrypt_private_key( old_password );
+            key.encrypt_private_key( new_password, priv_key );
+         }
+         store_and_reload_record( lookahead_record, true );
+      }
    } FC_CAPTURE_AND_RETHROW() }
 
    void wallet_db::remove_transaction( const transaction_id_type& record_id )
@@ -1,4 +1,5 @@
 #include <bts/blockchain/chain_interface.hpp>
+#include <bts/blockchain/key_address_cache.hpp>
 #include <bts/wallet/exceptions.hpp>
 #include <bts/wallet/wallet_records.hpp>
 #include <fc/crypto/aes.hpp>
@@ -54,6 +55,12 @@ namespace bts { namespace wallet {
        return fc::raw::unpack<private_key_type>( plain_text );
     } FC_CAPTURE_AND_RETHROW() }
 
+    void lookahead_key::derive_addresses()
+    {
+       const key_addresses addresses = key_address_cache::instance().get_addresses( public_key );
+       derived_addresses.assign( addresses.begin() + 1, addresses.end() );
+    }
+
     contact_data::contact_data( const chain_interface& db, const string& data, const string& label )
     { try {
         contact_data record;
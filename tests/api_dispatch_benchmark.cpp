@@ -0,0 +1,108 @@
+/**
+ *  Measures what the generated RPC server wrappers cost on top of the client methods they call.
+ *
+ *  Every method is called three ways against the same client: typed, through the client
+ *  interface; through the RPC server dispatch, converting parameters and the result to and
+ *  from fc::variant; and from request JSON text to an encoded JSON reply, as the HTTP server
+ *  does. The calls per second of each show where the time goes.
+ *
+ *  api_dispatch_benchmark --data-dir ~/.BitSharesPlay --calls 20000
+ */
+#include <bts/client/client.hpp>
+#include <bts/rpc/rpc_encoding.hpp>
+#include <bts/rpc/rpc_server.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+#include <fc/log/logger_config.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+using namespace bts::client;
+
+namespace {
+
+struct benchmark_method
+{
+   std::string              name;
+   std::string              params_json;
+   std::function<void()>    typed_call;
+};
+
+double calls_per_second( const uint32_t calls, const std::function<void()>& call )
+{
+   const fc::time_point start = fc::time_point::now();
+   for( uint32_t i = 0; i < calls; ++i )
+      call();
+   const fc::microseconds elapsed = fc::time_point::now() - start;
+   return calls / (std::max<int64_t>( elapsed.count(), 1 ) / 1000000.0);
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{ try {
+   namespace po = boost::program_options;
+   po::options_description options( "Options" );
+   options.add_options()
+      ( "help", "Print this help message and exit" )
+      ( "data-dir", po::value<std::string>(), "Client data directory to open; a temporary directory with the built in genesis by default" )
+      ( "calls", po::value<uint32_t>()->default_value( 10000 ), "Calls per method and path" );
+
+   po::variables_map vm;
+   po::store( po::parse_command_line( argc, argv, options ), vm );
+   po::notify( vm );
+
+   if( vm.count( "help" ) )
+   {
+      std::cout << options << "\n";
+      return 0;
+   }
+
+   fc::configure_logging( fc::logging_config() );
+
+   fc::temp_directory temp_dir;
+   const fc::path data_dir = vm.count( "data-dir" ) ? fc::path( vm["data-dir"].as<std::string>() ) : temp_dir.path();
+
+   const auto client = std::make_shared<bts::client::client>( "api_dispatch_benchmark" );
+   client->open( data_dir );
+   const bts::rpc::rpc_server_ptr server = client->get_rpc_server();
+
+   const std::vector<benchmark_method> methods =
+   {
+      { "blockchain_get_block_count", "[]", [&]{ client->blockchain_get_block_count(); } },
+      { "blockchain_get_info", "[]", [&]{ client->blockchain_get_info(); } },
+      { "blockchain_get_block", "[\"1\"]", [&]{ client->blockchain_get_block( "1" ); } },
+      { "blockchain_list_assets", "[\"\", 100]", [&]{ client->blockchain_list_assets( "", 100 ); } },
+      { "blockchain_list_delegates", "[0, 101]", [&]{ client->blockchain_list_delegates( 0, 101 ); } },
+      { "blockchain_list_active_delegates", "[0, 101]", [&]{ client->blockchain_list_active_delegates( 0, 101 ); } }
+   };
+
+   const uint32_t calls = vm["calls"].as<uint32_t>();
+   std::cout << std::left << std::setw( 36 ) << "method"
+             << std::right << std::setw( 14 ) << "typed/s" << std::setw( 14 ) << "dispatch/s" << std::setw( 14 ) << "json/s" << "\n";
+
+   for( const benchmark_method& method : methods )
+   {
+      const fc::variants params = fc::json::from_string( method.params_json ).get_array();
+      const std::string request = "{\"id\":1,\"method\":\"" + method.name + "\",\"params\":" + method.params_json + "}";
+
+      const double typed = calls_per_second( calls, method.typed_call );
+      const double dispatch = calls_per_second( calls, [&]{ server->direct_invoke_method( method.name, params ); } );
+      const double json = calls_per_second( calls, [&]
+      {
+         const fc::variant_object call = fc::json::from_string( request ).get_object();
+         const fc::variant result = server->direct_invoke_method( call["method"].as_string(), call["params"].get_array() );
+         bts::rpc::encode_rpc_reply( bts::rpc::json_rpc_encoding, call["id"], result );
+      } );
+
+      std::cout << std::left << std::setw( 36 ) << method.name << std::right << std::fixed << std::setprecision( 0 )
+                << std::setw( 14 ) << typed << std::setw( 14 ) << dispatch << std::setw( 14 ) << json << "\n";
+   }
+
+   return 0;
+} FC_CAPTURE_AND_LOG( (argc) ) return 1; }
@@ -0,0 +1,177 @@
+#define BOOST_TEST_MODULE AssetMathTests
+
+#include <boost/test/unit_test.hpp>
+
+#include <bts/blockchain/asset.hpp>
+#include <bts/blockchain/exceptions.hpp>
+#include <fc/bigint.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/real128.hpp>
+#include <fc/time.hpp>
+
+#include <functional>
+#include <iostream>
+#include <random>
+
+using namespace bts::blockchain;
+
+namespace {
+
+/** The fc::bigint implementations asset.cpp used before the native wide integer math */
+price reference_multiply( const price& l, const price& r )
+{
+   if( l.is_infinite() || r.is_infinite() || l.ratio == fc::uint128() || r.ratio == fc::uint128() )
+      return l * r;
+
+   fc::bigint product = l.ratio;
+   product *= r.ratio;
+   product /= FC_REAL128_PRECISION;
+   if( product == fc::bigint() )
+      FC_THROW_EXCEPTION( price_multiplication_underflow, "price multiplication underflow" );
+   if( product >= fc::bigint( price::infinite() ) )
+      FC_THROW_EXCEPTION( price_multiplication_overflow, "price multiplication overflow" );
+   return price( fc::uint128( product ), l.quote_asset_id, l.base_asset_id );
+}
+
+price reference_divide( const asset& a, const asset& b )
+{
+   auto l = a; auto r = b;
+   if( l.asset_id < r.asset_id ) { std::swap( l, r ); }
+   if( a.asset_id == b.asset_id || r.amount == 0 )
+      return a / b;
+
+   price p;
+   p.base_asset_id = r.asset_id;
+   p.quote_asset_id = l.asset_id;
+   fc::bigint bl = l.amount;
+   fc::bigint br = r.amount;
+   p.ratio = (bl * fc::bigint( FC_REAL128_PRECISION )) / br;
+   return p;
+}
+
+asset reference_multiply( const asset& a, const price& p )
+{
+   if( a.asset_id == p.base_asset_id )
+   {
+      fc::bigint amnt = fc::bigint( a.amount ) * fc::bigint( p.ratio );
+      amnt /= FC_REAL128_PRECISION;
+      if( amnt.log2() >= 128 )
+         FC_THROW_EXCEPTION( addition_overflow, "overflow ${a} * ${p}", ("a",a)("p",p) );
+      return asset( amnt.to_int64(), p.quote_asset_id );
+   }
+   else if( a.asset_id == p.quote_asset_id )
+   {
+      fc::bigint amt( a.amount );
+      amt *= FC_REAL128_PRECISION;
+      fc::bigint result = amt / fc::bigint( p.ratio );
+      if( result.log2() >= 128 )
+         FC_THROW_EXCEPTION( addition_overflow, "overflow ${a} / ${p}", ("a",a)("p",p) );
+      return asset( result.to_int64(), p.base_asset_id );
+   }
+   return a * p;
+}
+
+/** Either the result or the code of the exception thrown */
+template<typename Func>
+std::pair<int64_t, std::string> outcome( Func&& f )
+{
+   try
+   {
+      return std::make_pair( int64_t( 0 ), f() );
+   }
+   catch( const fc::exception& e )
+   {
+      return std::make_pair( e.code(), std::string() );
+   }
+}
+
+std::string to_string( const price& p ) { return std::string( p ); }
+std::string to_string( const asset& a ) { return fc::to_string( a.amount ) + " " + fc::to_string( int64_t( a.asset_id.value ) ); }
+
+struct operand_generator
+{
+   std::mt19937_64 gen{ 31337 };
+
+   /** Values clustered around interesting magnitudes, including the extremes */
+   share_type next_amount()
+   {
+      switch( gen() % 8 )
+      {
+         case 0: return 0;
+         case 1: return gen() % 2 ? INT64_MAX : INT64_MIN;
+         case 2: return share_type( gen() % 1000 ) - 500;
+         default:
+         {
+            const share_type v = share_type( gen() >> ( gen() % 64 + 1 ) );
+            return gen() % 4 == 0 ? -v : v;
+         }
+      }
+   }
+
+   fc::uint128 next_ratio()
+   {
+      switch( gen() % 8 )
+      {
+         case 0: return fc::uint128();
+         case 1: return price::infinite();
+         case 2: return fc::uint128( gen() % 1000 );
+         case 3: return fc::uint128( gen() % 100000 ) * FC_REAL128_PRECISION;
+         default:
+         {
+            const unsigned shift = gen() % 128;
+            fc::uint128 v( gen(), gen() );
+            return shift >= 64 ? fc::uint128( 0, v.high_bits() >> ( shift - 64 ) ) : fc::uint128( v.high_bits() >> shift, v.low_bits() );
+         }
+      }
+   }
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE( native_math_matches_bigint )
+{
+   operand_generator g;
+   for( int i = 0; i < 200000; ++i )
+   {
+      const price pl( g.next_ratio(), asset_id_type( 1 ), asset_id_type( 0 ) );
+      const price pr( g.next_ratio(), asset_id_type( 1 ), asset_id_type( 0 ) );
+      BOOST_REQUIRE( outcome( [&]{ return to_string( pl * pr ); } ) == outcome( [&]{ return to_string( reference_multiply( pl, pr ) ); } ) );
+
+      const asset al( g.next_amount(), asset_id_type( 1 ) );
+      const asset ar( g.next_amount(), asset_id_type( 0 ) );
+      BOOST_REQUIRE( outcome( [&]{ return to_string( al / ar ); } ) == outcome( [&]{ return to_string( reference_divide( al, ar ) ); } ) );
+
+      BOOST_REQUIRE( outcome( [&]{ return to_string( ar * pl ); } ) == outcome( [&]{ return to_string( reference_multiply( ar, pl ) ); } ) );
+      BOOST_REQUIRE( outcome( [&]{ return to_string( al * pl ); } ) == outcome( [&]{ return to_string( reference_multiply( al, pl ) ); } ) );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( asset_math_benchmark )
+{
+   const int iterations = 1000000;
+   operand_generator g;
+   std::vector<asset> amounts;
+   std::vector<price> prices;
+   for( int i = 0; i < 1024; ++i )
+   {
+      amounts.push_back( asset( share_type( g.gen() % 100000000000ll ) + 1, asset_id_type( i % 2 ) ) );
+      prices.push_back( price( fc::uint128( g.gen() % 1000000 + 1 ) * ( FC_REAL128_PRECISION / 1000 ), asset_id_type( 1 ), asset_id_type( 0 ) ) );
+   }
+
+   auto run = [&]( const char* name, const std::function<share_type( const asset&, const price& )>& op )
+   {
+      share_type sink = 0;
+      const auto start = fc::time_point::now();
+      for( int i = 0; i < iterations; ++i )
+         sink += op( amounts[ i % amounts.size() ], prices[ (i * 7) % prices.size() ] );
+      const auto elapsed = fc::time_point::now() - start;
+      std::cout << name << ": " << double( elapsed.count() ) * 1000 / iterations << " ns/op (" << sink % 10 << ")\n";
+   };
+
+   run( "asset * price (native) ", []( const asset& a, const price& p ) { return (a * p).amount; } );
+   run( "asset * price (bigint) ", []( const asset& a, const price& p ) { return reference_multiply( a, p ).amount; } );
+   run( "price * price (native) ", []( const asset&, const price& p ) { return share_type( (p * p).ratio.low_bits() & 1 ); } );
+   run( "price * price (bigint) ", []( const asset&, const price& p ) { return share_type( reference_multiply( p, p ).ratio.low_bits() & 1 ); } );
+   run( "asset / asset (native) ", []( const asset& a, const price& ) { return share_type( (a / asset( 3, asset_id_type( a.asset_id.value == 0 ? 1 : 0 ) )).ratio.low_bits() & 1 ); } );
+   run( "asset / asset (bigint) ", []( const asset& a, const price& ) { return share_type( reference_divide( a, asset( 3, asset_id_type( a.asset_id.value == 0 ? 1 : 0 ) ) ).ratio.low_bits() & 1 ); } );
+}
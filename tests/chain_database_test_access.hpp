@@ -0,0 +1,65 @@
+#pragma once
+
+#include <bts/blockchain/chain_database.hpp>
+#include <bts/blockchain/market_engine.hpp>
+
+namespace bts { namespace blockchain {
+
+   /**
+    *  Hooks into chain_database for tests and benchmarks only; chain_database befriends this class
+    *  so none of it is part of the database's public interface.
+    */
+   class chain_database_test_access
+   {
+      public:
+         /**
+          *  Matches one market against the committed order books, outside of any block, and applies
+          *  the result directly. For a scratch database only: the changes bypass undo state.
+          */
+         static vector<market_transaction> execute_market( chain_database& db, const asset_id_type quote_id,
+                                                           const asset_id_type base_id, const time_point_sec timestamp )
+         { try {
+             const auto snapshot_lock = db.my->lock_snapshots();
+             const pending_chain_state_ptr pending_state = std::make_shared<pending_chain_state>( db.shared_from_this() );
+             detail::market_engine engine( pending_state, *db.my );
+             if( !engine.execute( quote_id, base_id, timestamp ) )
+                 return vector<market_transaction>();
+
+             pending_state->apply_changes();
+             return std::move( engine._market_transactions );
+         } FC_CAPTURE_AND_RETHROW( (quote_id)(base_id)(timestamp) ) }
+
+         /**
+          *  Runs execute_market over markets the way blocks do, each in its own child of pending_state merged
+          *  back in order, or one after another when serial is set. For checking the merge against serial
+          *  execution; nothing is written past pending_state.
+          */
+         static vector<market_transaction> match_markets( const chain_database& db,
+                                                          const vector<pair<asset_id_type, asset_id_type>>& markets,
+                                                          const pending_chain_state_ptr& pending_state,
+                                                          const chain_database::market_executor& execute_market,
+                                                          const bool serial )
+         { try {
+             if( !serial )
+                 return db.my->match_markets( markets, pending_state, execute_market );
+
+             vector<market_transaction> market_transactions;
+             for( const auto& market_pair : markets )
+             {
+                 const pending_chain_state_ptr market_state = std::make_shared<pending_chain_state>( pending_state );
+                 const vector<market_transaction> results = execute_market( market_pair, market_state );
+                 market_state->apply_changes();
+                 market_transactions.insert( market_transactions.end(), results.begin(), results.end() );
+             }
+             return market_transactions;
+         } FC_CAPTURE_AND_RETHROW( (markets)(serial) ) }
+
+         /** Replaces the game results recorded for an already applied block, as the wallet scans them */
+         static void store_game_result_transactions( chain_database& db, const uint32_t block_num,
+                                                     const vector<game_result_transaction>& trxs )
+         { try {
+             db.my->_game_result_transactions_db.store( block_num, trxs );
+         } FC_CAPTURE_AND_RETHROW( (block_num)(trxs) ) }
+   };
+
+} } // bts::blockchain
@@ -1,6 +1,21 @@
 #define BOOST_TEST_MODULE BlockchainTests2cc
 #include <boost/test/unit_test.hpp>
 #include "dev_fixture.hpp"
+#include "chain_database_test_access.hpp"
+
+#include <bts/blockchain/extended_address.hpp>
+#include <bts/blockchain/fork_blocks.hpp>
+#include <bts/db/paged_level_map.hpp>
+#include <bts/game/client.hpp>
+#include <bts/game/v8_game.hpp>
+#include <bts/game/v8_helper.hpp>
+#include <bts/rpc/market_feed.hpp>
+#include <bts/rpc/rpc_encoding.hpp>
+#include <fc/io/raw_variant.hpp>
+#include <bts/wallet/config.hpp>
+
+#include <cstring>
+#include <limits>
 
 
 BOOST_FIXTURE_TEST_CASE( basic_commands, chain_fixture )
@@ -713,6 +728,790 @@ BOOST_FIXTURE_TEST_CASE( basic_commands, chain_fixture )
    exec(clientb, "history c-account");
 } FC_LOG_AND_RETHROW() }
 
+BOOST_FIXTURE_TEST_CASE( batch_transfer_pays_out, chain_fixture )
+{ try {
+   exec( clienta, "scan 0 100" );
+
+   const auto wallet = clienta->get_wallet();
+   const chain_database_ptr chain = clienta->get_chain();
+   const uint32_t payout_count = BTS_WALLET_MAX_DEPOSITS_PER_BATCH_TRANSACTION + 2;
+
+   vector<std::pair<string, asset>> payouts;
+   vector<address> recipients;
+   share_type paid_out = 0;
+   for( uint32_t i = 0; i < payout_count; ++i )
+   {
+      const auto key = fc::ecc::private_key::regenerate( fc::sha256::hash( "payout" + fc::to_string( i ) ) );
+      recipients.push_back( address( key.get_public_key() ) );
+      payouts.emplace_back( string( recipients.back() ), asset( 10000 + i ) );
+      paid_out += payouts.back().second.amount;
+   }
+
+   const auto balance_of = [&]() -> share_type
+   {
+      return wallet->get_spendable_account_balances( "delegate31" )[ "delegate31" ][ 0 ];
+   };
+   const share_type balance_before = balance_of();
+
+   const auto records = wallet->batch_transfer( payouts, "delegate31", "", vote_none, true );
+   BOOST_REQUIRE_EQUAL( records.size(), 2u );
+   BOOST_CHECK_EQUAL( records[ 0 ].ledger_entries.size(), BTS_WALLET_MAX_DEPOSITS_PER_BATCH_TRANSACTION );
+   BOOST_CHECK_EQUAL( records[ 1 ].ledger_entries.size(), 2u );
+   for( const auto& record : records )
+   {
+      BOOST_CHECK( record.fee == wallet->get_transaction_fee() );
+      clienta->network_broadcast_transaction( record.trx );
+   }
+   produce_block( clienta );
+
+   for( uint32_t i = 0; i < payout_count; ++i )
+   {
+      const obalance_record balance = chain->get_balance_record(
+            withdraw_condition( withdraw_with_signature( recipients[ i ] ), 0 ).get_address() );
+      BOOST_REQUIRE( balance.valid() );
+      BOOST_CHECK_EQUAL( balance->balance, payouts[ i ].second.amount );
+   }
+
+   // One fee per transaction, not per payout
+   exec( clienta, "scan 0 100" );
+   BOOST_CHECK_EQUAL( balance_before - balance_of(), paid_out + 2 * wallet->get_transaction_fee().amount );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( cached_private_key_signs_like_imported_key, chain_fixture )
+{ try {
+   exec( clienta, "scan 0 100" );
+
+   const auto wallet = clienta->get_wallet();
+   const private_key_type& imported_key = delegate_private_keys[ 31 ];
+   const address signer( imported_key.get_public_key() );
+
+   // The first lookup may decrypt the stored key, the second is served from the cache
+   BOOST_CHECK( wallet->get_private_key( signer ) == imported_key );
+   BOOST_CHECK( wallet->get_private_key( signer ) == imported_key );
+
+   const auto recipient = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "signing" ) ) );
+   const auto record = wallet->transfer( asset( 10000 ), "delegate31", string( address( recipient.get_public_key() ) ),
+                                         "", vote_none, true );
+   BOOST_REQUIRE( !record.trx.signatures.empty() );
+
+   // Signatures are not deterministic, so compare the keys they recover to
+   const digest_type digest = record.trx.digest( clienta->get_chain()->get_chain_id() );
+   bool signed_by_imported_key = false;
+   for( const auto& signature : record.trx.signatures )
+      signed_by_imported_key |= fc::ecc::public_key( signature, digest ) == imported_key.get_public_key();
+   BOOST_CHECK( signed_by_imported_key );
+
+   clienta->network_broadcast_transaction( record.trx );
+   produce_block( clienta );
+   const obalance_record balance = clienta->get_chain()->get_balance_record(
+         withdraw_condition( withdraw_with_signature( address( recipient.get_public_key() ) ), 0 ).get_address() );
+   BOOST_REQUIRE( balance.valid() );
+   BOOST_CHECK_EQUAL( balance->balance, 10000 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( parallel_markets_match_serial, chain_fixture )
+{ try {
+   const chain_database_ptr chain = clienta->get_chain();
+   const oasset_record base_asset = chain->get_asset_record( asset_id_type( 0 ) );
+   BOOST_REQUIRE( base_asset.valid() );
+
+   // USD is the quote asset of both markets
+   const auto make_asset = [&]( const asset_id_type id, const string& symbol ) -> asset_record
+   {
+      asset_record record = *base_asset;
+      record.id = id;
+      record.symbol = symbol;
+      record.current_supply = 1000000;
+      record.collected_fees = 0;
+      return record;
+   };
+   const pending_chain_state_ptr initial_state = std::make_shared<pending_chain_state>( chain );
+   initial_state->store_asset_record( make_asset( 100, "GLD" ) );
+   initial_state->store_asset_record( make_asset( 101, "USD" ) );
+
+   const vector<pair<asset_id_type, asset_id_type>> markets = { { 101, 0 }, { 101, 100 } };
+   const auto execute_market = []( const pair<asset_id_type, asset_id_type>& market_pair,
+                                   const pending_chain_state_ptr& market_state ) -> vector<market_transaction>
+   {
+      oasset_record quote_asset = market_state->get_asset_record( market_pair.first );
+      oasset_record base_asset = market_state->get_asset_record( market_pair.second );
+      // The first market changes the supply of USD, the second only collects fees in it
+      if( market_pair.second == 0 )
+         quote_asset->current_supply += 5000;
+      quote_asset->collected_fees += 10;
+      base_asset->collected_fees += 20;
+      market_state->store_asset_record( *quote_asset );
+      market_state->store_asset_record( *base_asset );
+      return vector<market_transaction>();
+   };
+
+   const auto run = [&]( const bool serial ) -> pending_chain_state_ptr
+   {
+      const pending_chain_state_ptr pending_state = std::make_shared<pending_chain_state>( initial_state );
+      chain_database_test_access::match_markets( *chain, markets, pending_state, execute_market, serial );
+      return pending_state;
+   };
+   const pending_chain_state_ptr parallel_state = run( false );
+   const pending_chain_state_ptr serial_state = run( true );
+
+   for( const asset_id_type asset_id : { asset_id_type( 0 ), asset_id_type( 100 ), asset_id_type( 101 ) } )
+   {
+      const oasset_record parallel_record = parallel_state->get_asset_record( asset_id );
+      const oasset_record serial_record = serial_state->get_asset_record( asset_id );
+      BOOST_REQUIRE( parallel_record.valid() && serial_record.valid() );
+      BOOST_CHECK( fc::raw::pack( *parallel_record ) == fc::raw::pack( *serial_record ) );
+   }
+   BOOST_CHECK_EQUAL( parallel_state->get_asset_record( asset_id_type( 101 ) )->current_supply, 1005000 );
+   BOOST_CHECK_EQUAL( parallel_state->get_asset_record( asset_id_type( 101 ) )->collected_fees, 20 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( paged_level_map_scan_merges_unflushed_writes )
+{ try {
+   fc::temp_directory dir;
+   bts::db::paged_level_map<uint32_t, string> records;
+   records.open( dir.path() );
+   for( uint32_t key = 0; key <= 18; key += 2 )
+      records.store( key, "stored" + fc::to_string( key ) );
+
+   records.set_write_through( false );
+   records.store( 3, "dirty3" );    // between two keys in leveldb
+   records.store( 4, "dirty4" );    // replaces a key in leveldb
+   records.remove( 6 );             // hides a key in leveldb
+   records.store( 7, "dirty7" );    // stored and removed before any flush
+   records.remove( 7 );
+   records.store( 21, "dirty21" );  // past the last key in leveldb
+
+   const vector<std::pair<uint32_t, string>> expected = {
+      { 2, "stored2" }, { 3, "dirty3" }, { 4, "dirty4" }, { 8, "stored8" }, { 10, "stored10" },
+      { 12, "stored12" }, { 14, "stored14" }, { 16, "stored16" }, { 18, "stored18" }, { 21, "dirty21" } };
+
+   const auto scan = [&]( const size_t limit ) -> vector<std::pair<uint32_t, string>>
+   {
+      vector<std::pair<uint32_t, string>> result;
+      records.scan( 1, 21, [&]( const uint32_t key, const string& value ) -> bool
+      {
+         result.emplace_back( key, value );
+         return result.size() < limit;
+      } );
+      return result;
+   };
+
+   BOOST_CHECK( scan( expected.size() + 1 ) == expected );
+   BOOST_CHECK( scan( 3 ) == vector<std::pair<uint32_t, string>>( expected.begin(), expected.begin() + 3 ) );
+
+   // Once flushed the same records come from leveldb alone
+   records.flush();
+   BOOST_CHECK( scan( expected.size() + 1 ) == expected );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( paged_level_map_refetches_evicted_records )
+{ try {
+   fc::temp_directory dir;
+   bts::db::paged_level_map<uint32_t, string> records;
+   records.open( dir.path() );
+   records.set_max_cached( 2 );
+
+   for( uint32_t key = 1; key <= 5; ++key )
+      records.store( key, "stored" + fc::to_string( key ) );
+   BOOST_CHECK_EQUAL( records.cached_size(), 2u );
+
+   for( uint32_t key = 1; key <= 5; ++key )
+   {
+      const fc::optional<string> value = records.fetch_optional( key );
+      BOOST_REQUIRE( value.valid() );
+      BOOST_CHECK_EQUAL( *value, "stored" + fc::to_string( key ) );
+   }
+   BOOST_CHECK_EQUAL( records.cached_size(), 2u );
+
+   // Unflushed writes must survive their eviction from the cache
+   records.set_write_through( false );
+   records.store( 10, "dirty10" );
+   records.remove( 1 );
+   for( uint32_t key = 11; key <= 13; ++key )
+      records.store( key, "dirty" + fc::to_string( key ) );
+   BOOST_REQUIRE( records.fetch_optional( 10 ).valid() );
+   BOOST_CHECK_EQUAL( *records.fetch_optional( 10 ), "dirty10" );
+   BOOST_CHECK( !records.fetch_optional( 1 ).valid() );
+
+   records.close();
+   records.open( dir.path() );
+   BOOST_REQUIRE( records.fetch_optional( 10 ).valid() );
+   BOOST_CHECK_EQUAL( *records.fetch_optional( 10 ), "dirty10" );
+   BOOST_CHECK( !records.fetch_optional( 1 ).valid() );
+   BOOST_CHECK( records.fetch_optional( 2 ).valid() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( pending_state_scan_matches_fetches, chain_fixture )
+{ try {
+   const chain_database_ptr chain = clienta->get_chain();
+   const int32_t game_id = 99;
+
+   const auto make_record = [&]( const int32_t record_game_id, const int32_t index ) -> game_data_record
+   {
+      game_data_record record;
+      record.game_id = record_game_id;
+      record.data = fc::mutable_variant_object( "index", index )( "value", index * 10 );
+      return record;
+   };
+
+   // The chain holds the even indexes 2 to 20, and a record of another game in between
+   for( int32_t index = 2; index <= 20; index += 2 )
+      chain->store_game_data_record( game_id, index, make_record( game_id, index ) );
+   chain->store_game_data_record( game_id - 1, 5, make_record( game_id - 1, 5 ) );
+
+   // Each layer removes records inside the first few and adds some on either side of them
+   const pending_chain_state_ptr base_state = std::make_shared<pending_chain_state>( chain );
+   base_state->store_game_data_record( game_id, 2, make_record( game_id, 2 ).make_null() );
+   base_state->store_game_data_record( game_id, 5, make_record( game_id, 5 ) );
+   base_state->store_game_data_record( game_id, 11, make_record( game_id, 11 ) );
+
+   const pending_chain_state_ptr state = std::make_shared<pending_chain_state>( base_state );
+   state->store_game_data_record( game_id, 4, make_record( game_id, 4 ).make_null() );
+   state->store_game_data_record( game_id, 6, make_record( game_id, 6 ).make_null() );
+   state->store_game_data_record( game_id, 7, make_record( game_id, 7 ) );
+   state->store_game_data_record( game_id, 20, make_record( game_id, 20 ).make_null() );
+   state->store_game_data_record( game_id, 2, make_record( game_id, 2 ) );
+
+   const auto fetch_each = [&]( const int32_t first, const int32_t last, const uint32_t limit )
+   {
+      map<data_id_type, game_data_record> records;
+      for( int32_t index = first; index <= last && records.size() < limit; ++index )
+      {
+         const ogame_data_record record = state->get_game_data_record( game_id, index );
+         if( record.valid() && !record->is_null() )
+            records[ index ] = *record;
+      }
+      return records;
+   };
+
+   const vector<std::pair<int32_t, int32_t>> ranges = { { 1, 21 }, { 3, 11 }, { 7, 7 }, { 6, 6 }, { 9, 8 } };
+   for( const auto& range : ranges )
+   {
+      for( uint32_t limit = 0; limit <= 12; ++limit )
+      {
+         const auto scanned = state->scan_game_data_records( game_id, range.first, range.second, limit );
+         const auto fetched = fetch_each( range.first, range.second, limit );
+         BOOST_REQUIRE_EQUAL( scanned.size(), fetched.size() );
+         for( auto scanned_itr = scanned.begin(), fetched_itr = fetched.begin(); scanned_itr != scanned.end(); ++scanned_itr, ++fetched_itr )
+         {
+            BOOST_CHECK_EQUAL( int32_t( scanned_itr->first ), int32_t( fetched_itr->first ) );
+            BOOST_CHECK_EQUAL( fc::json::to_string( scanned_itr->second.data ), fc::json::to_string( fetched_itr->second.data ) );
+         }
+      }
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( meter_steps_counts_loops_and_calls )
+{ try {
+   using bts::game::v8_helper;
+
+   // Loop conditions are and-ed with a step, for-in loops only run over what exists
+   BOOST_CHECK_EQUAL( v8_helper::meter_steps( "while( true ) {}" ), "while(__bts_step() && ( true )) {}" );
+   BOOST_CHECK_EQUAL( v8_helper::meter_steps( "do { x++; } while( x < 10 );" ), "do { x++; } while(__bts_step() && ( x < 10 ));" );
+   BOOST_CHECK_EQUAL( v8_helper::meter_steps( "for( var i = 0; i < n; i++ ) f( i );" ),
+                      "for( var i = 0;__bts_step() && ( i < n); i++ ) f( i );" );
+   BOOST_CHECK_EQUAL( v8_helper::meter_steps( "for( ;; ) {}" ), "for( ;__bts_step(); ) {}" );
+   BOOST_CHECK_EQUAL( v8_helper::meter_steps( "for( var k in o ) { f( k ); }" ), "for( var k in o ) { f( k ); }" );
+
+   // Function bodies start with a step, after any directives; other blocks are left alone
+   BOOST_CHECK_EQUAL( v8_helper::meter_steps( "function f( a ) { 'use strict'; return a / 2; }" ),
+                      "function f( a ) { 'use strict';;__bts_step(); return a / 2; }" );
+   BOOST_CHECK_EQUAL( v8_helper::meter_steps( "var o = { get a() { return /[)]{/.test( s ); } };" ),
+                      "var o = { get a() {;__bts_step(); return /[)]{/.test( s ); } };" );
+   BOOST_CHECK_EQUAL( v8_helper::meter_steps( "if( x ) { y(); } switch( z ) { case 1: break; } try {} catch( e ) {}" ),
+                      "if( x ) { y(); } switch( z ) { case 1: break; } try {} catch( e ) {}" );
+
+   // Nothing inside strings, comments and regular expressions is touched
+   const string quoted = "var s = 'while( true ) {}'; // for( ;; ) {}\n/* function() {} */ var r = /while(x)/g;";
+   BOOST_CHECK_EQUAL( v8_helper::meter_steps( quoted ), quoted );
+
+   // A script could stand its own function in for the step
+   BOOST_CHECK_THROW( v8_helper::meter_steps( "var __bts_step = function() { return true; };" ), fc::exception );
+   BOOST_CHECK_THROW( v8_helper::meter_steps( "this['__bts_step'] = 1;" ), fc::exception );
+   BOOST_CHECK_THROW( v8_helper::meter_steps( "with( o ) { while( true ) {} }" ), fc::exception );
+   BOOST_CHECK_EQUAL( v8_helper::meter_steps( "o.with( 1 );" ), "o.with( 1 );" );
+} FC_LOG_AND_RETHROW() }
+
+namespace {
+
+/** Reads back what bts::rpc::msgpack_pack writes */
+class msgpack_reader
+{
+   public:
+      explicit msgpack_reader( const std::vector<char>& data ) : _data( data ) {}
+
+      bool at_end()const { return _pos == _data.size(); }
+
+      fc::variant read()
+      {
+         const uint8_t tag = next();
+         if( tag < 0x80 ) return fc::variant( uint64_t( tag ) );
+         if( tag >= 0xe0 ) return fc::variant( int64_t( int8_t( tag ) ) );
+         if( ( tag & 0xf0 ) == 0x80 ) return read_object( tag & 0x0f );
+         if( ( tag & 0xf0 ) == 0x90 ) return read_array( tag & 0x0f );
+         if( ( tag & 0xe0 ) == 0xa0 ) return fc::variant( read_string( tag & 0x1f ) );
+         switch( tag )
+         {
+            case 0xc0: return fc::variant();
+            case 0xc2: return fc::variant( false );
+            case 0xc3: return fc::variant( true );
+            case 0xc4: return read_blob( big_endian( 1 ) );
+            case 0xc5: return read_blob( big_endian( 2 ) );
+            case 0xc6: return read_blob( big_endian( 4 ) );
+            case 0xcb:
+            {
+               const uint64_t bits = big_endian( 8 );
+               double value;
+               std::memcpy( &value, &bits, sizeof( value ) );
+               return fc::variant( value );
+            }
+            case 0xcc: return fc::variant( big_endian( 1 ) );
+            case 0xcd: return fc::variant( big_endian( 2 ) );
+            case 0xce: return fc::variant( big_endian( 4 ) );
+            case 0xcf: return fc::variant( big_endian( 8 ) );
+            case 0xd0: return fc::variant( int64_t( int8_t( big_endian( 1 ) ) ) );
+            case 0xd1: return fc::variant( int64_t( int16_t( big_endian( 2 ) ) ) );
+            case 0xd2: return fc::variant( int64_t( int32_t( big_endian( 4 ) ) ) );
+            case 0xd3: return fc::variant( int64_t( big_endian( 8 ) ) );
+            case 0xd9: return fc::variant( read_string( big_endian( 1 ) ) );
+            case 0xda: return fc::variant( read_string( big_endian( 2 ) ) );
+            case 0xdb: return fc::variant( read_string( big_endian( 4 ) ) );
+            case 0xdc: return read_array( big_endian( 2 ) );
+            case 0xdd: return read_array( big_endian( 4 ) );
+            case 0xde: return read_object( big_endian( 2 ) );
+            case 0xdf: return read_object( big_endian( 4 ) );
+         }
+         FC_THROW( "unexpected MessagePack tag ${t}", ("t",tag) );
+      }
+
+   private:
+      uint8_t next()
+      {
+         FC_ASSERT( _pos < _data.size() );
+         return uint8_t( _data[ _pos++ ] );
+      }
+
+      uint64_t big_endian( const size_t bytes )
+      {
+         uint64_t value = 0;
+         for( size_t i = 0; i < bytes; ++i )
+            value = ( value << 8 ) | next();
+         return value;
+      }
+
+      string read_string( const size_t size )
+      {
+         FC_ASSERT( _pos + size <= _data.size() );
+         const string value( _data.data() + _pos, size );
+         _pos += size;
+         return value;
+      }
+
+      fc::variant read_blob( const size_t size )
+      {
+         fc::blob value;
+         const string bytes = read_string( size );
+         value.data.assign( bytes.begin(), bytes.end() );
+         return fc::variant( value );
+      }
+
+      fc::variant read_array( const size_t size )
+      {
+         fc::variants items;
+         for( size_t i = 0; i < size; ++i )
+            items.push_back( read() );
+         return fc::variant( items );
+      }
+
+      fc::variant read_object( const size_t size )
+      {
+         fc::mutable_variant_object object;
+         for( size_t i = 0; i < size; ++i )
+         {
+            const string key = read().as_string();
+            object[ key ] = read();
+         }
+         return fc::variant( object );
+      }
+
+      const std::vector<char>&   _data;
+      size_t                     _pos = 0;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE( rpc_reply_encodings_round_trip )
+{ try {
+   using namespace bts::rpc;
+
+   fc::variants wide_array;
+   for( uint32_t i = 0; i < 20; ++i )
+      wide_array.push_back( fc::variant( i ) );
+   fc::blob blob;
+   blob.data = { 0, 1, 2, char( 0xff ) };
+
+   // Every width the encoder picks between, on both sides of its boundaries
+   const fc::variant value = fc::mutable_variant_object
+      ( "fixint", 127 )( "uint8", 200 )( "uint16", 70000 )( "uint32", uint64_t( 5000000000ull ) )
+      ( "max_uint64", std::numeric_limits<uint64_t>::max() )
+      ( "negative_fixint", -32 )( "int8", -100 )( "int16", -40000 )( "int32", int64_t( -3000000000ll ) )
+      ( "min_int64", std::numeric_limits<int64_t>::min() )
+      ( "double", 0.1 )( "true", true )( "false", false )( "null", fc::variant() )
+      ( "fixstr", "short" )( "str8", string( 40, 'x' ) )( "str16", string( 300, 'y' ) )
+      ( "array16", wide_array )( "nested", fc::mutable_variant_object( "empty", fc::variants() ) )
+      ( "blob", blob );
+   const fc::variant id( 42 );
+   const fc::variant error = fc::mutable_variant_object( "message", "failed" )( "code", 10 );
+
+   for( const fc::variant* reply_error : { (const fc::variant*)nullptr, &error } )
+   {
+      const string value_name = reply_error != nullptr ? "error" : "result";
+      const fc::variant& reply_value = reply_error != nullptr ? *reply_error : value;
+      const string expected = fc::json::to_string( fc::mutable_variant_object( "id", id )( value_name, reply_value ) );
+
+      // The JSON reply is streamed around the id but reads the same as one serialized object
+      const std::vector<char> json = encode_rpc_reply( json_rpc_encoding, id, value, reply_error );
+      BOOST_CHECK_EQUAL( string( json.begin(), json.end() ), expected );
+
+      const std::vector<char> msgpack = encode_rpc_reply( msgpack_rpc_encoding, id, value, reply_error );
+      msgpack_reader reader( msgpack );
+      BOOST_CHECK_EQUAL( fc::json::to_string( reader.read() ), expected );
+      BOOST_CHECK( reader.at_end() );
+
+      const std::vector<char> raw = encode_rpc_reply( raw_rpc_encoding, id, value, reply_error );
+      BOOST_CHECK_EQUAL( fc::json::to_string( fc::raw::unpack<fc::variant>( raw ) ), expected );
+
+      // A reply reused for another request only differs in its id
+      const encoded_rpc_reply without_id = encode_rpc_reply_without_id( msgpack_rpc_encoding, value, reply_error );
+      BOOST_CHECK( without_id.with_id( msgpack_rpc_encoding, id ) == msgpack );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( game_marshalling_matches_json, chain_fixture )
+{ try {
+   using namespace v8;
+   using bts::game::v8_helper;
+
+   bts::game::client& games = bts::game::client::get_current();
+   Isolate* isolate = static_cast<Isolate*>( games.create_isolate() );
+   {
+      Locker locker( isolate );
+      Isolate::Scope isolate_scope( isolate );
+      HandleScope handle_scope( isolate );
+      Local<Context> context = v8_helper::CreateShellContext( isolate );
+      Context::Scope context_scope( context );
+
+      const auto stringify = [&]( Local<Value> value ) -> string
+      {
+         return *String::Utf8Value( v8_helper::toJson( isolate, value ) );
+      };
+
+      // Into scripts: what JSON.parse made of fc::json's text
+      const vector<fc::variant> values = {
+         fc::variant( 1.5 ), fc::variant( 0.1 ), fc::variant( -2.0 ), fc::variant( 1e300 ), fc::variant( 12345678.9 ),
+         fc::variant( int64_t( 7 ) ), fc::variant( int64_t( -5 ) ), fc::variant( int64_t( -3000000000LL ) ),
+         fc::variant( int64_t( 4294967296LL ) ), fc::variant( std::numeric_limits<int64_t>::min() ),
+         fc::variant( std::numeric_limits<int64_t>::max() ), fc::variant( uint64_t( 3000000000ULL ) ),
+         fc::variant( std::numeric_limits<uint64_t>::max() ),
+         fc::json::from_string( R"({"a":{"b":[1,{"c":-2.25,"d":9300000000000000000}],"e":null},"f":"x","g":[[],{}]})" )
+      };
+      for( const auto& value : values )
+      {
+         HandleScope value_scope( isolate );
+         const string json = fc::json::to_string( value );
+         BOOST_CHECK_EQUAL( stringify( v8_helper::cpp_to_json( isolate, value ) ),
+                            stringify( v8_helper::parseJson( isolate, String::NewFromUtf8( isolate, json.c_str() ) ) ) );
+      }
+
+      // Out of scripts: what fc::json made of JSON.stringify's text, down to the variant types
+      const vector<string> expressions = {
+         "1.5", "0.1 + 0.2", "-7", "-0", "3000000000", "-3000000000", "Math.pow( 2, 53 ) + 2", "9.3e18", "-9.3e18", "1e21",
+         "1 / 0", "NaN", "[ 1, , 3 ]", "[ undefined, function() {} ]", "new Date( 0 )",
+         "({ a: { b: [ 1, , { c: undefined, d: function() {}, e: -2.25 } ] }, f: 12345678.9, g: '9' })"
+      };
+      for( const auto& expression : expressions )
+      {
+         HandleScope value_scope( isolate );
+         TryCatch try_catch( isolate );
+         Local<Script> script = Script::Compile( String::NewFromUtf8( isolate, ( "(" + expression + ")" ).c_str() ) );
+         BOOST_REQUIRE( !script.IsEmpty() );
+         Local<Value> result = script->Run();
+         BOOST_REQUIRE( !result.IsEmpty() );
+
+         const fc::variant native = v8_helper::json_to_cpp<fc::variant>( isolate, result );
+         const fc::variant json = fc::json::from_string( stringify( result ) );
+         BOOST_CHECK_EQUAL( fc::json::to_string( native ), fc::json::to_string( json ) );
+         BOOST_CHECK( fc::raw::pack( native ) == fc::raw::pack( json ) );
+      }
+   }
+   games.dispose_isolate( isolate );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( wallet_scans_game_results_by_game, chain_fixture )
+{ try {
+   const chain_database_ptr chain = clienta->get_chain();
+   const auto wallet = clienta->get_wallet();
+   produce_block( clienta );
+   const uint32_t block_num = chain->get_head_block_num();
+
+   // Each script keeps what it was called with in a virtual wallet transaction, numbered by call
+   const auto make_game = [&]( const game_id_type id, const string& name, const string& script_code )
+   {
+      game_record record;
+      record.id = id;
+      record.name = name;
+      record.owner_account_id = game_record::god_owner_id;
+      record.script_code = script_code;
+      chain->store_game_record( record );
+   };
+   make_game( 90, "batchscan", R"(
+      var PLAY = {}, calls = 0;
+      PLAY.global = function( game_id, assets ) { return true; };
+      PLAY.scan_results = function( results, trx_indexes, block_num, block_time, wallet ) {
+         var seen = { typed: trx_indexes instanceof Uint32Array, block_num: block_num, indexes: [], tags: [] };
+         for( var i = 0; i < results.length; i++ ) { seen.indexes.push( trx_indexes[ i ] ); seen.tags.push( results[ i ].data.tag ); }
+         calls++;
+         wallet.store_transaction( { record_id: 'aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa' + calls, is_virtual: true, contract: JSON.stringify( seen ) } );
+      };
+   )" );
+   make_game( 91, "singlescan", R"(
+      var PLAY = {}, calls = 0;
+      PLAY.global = function( game_id, assets ) { return true; };
+      PLAY.scan_result = function( result, block_num, block_time, trx_index, wallet ) {
+         calls++;
+         wallet.store_transaction( { record_id: 'bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb' + calls, is_virtual: true,
+                                     contract: JSON.stringify( { index: trx_index, tag: result.data.tag } ) } );
+      };
+   )" );
+
+   // The two games' results alternate in the block
+   vector<game_result_transaction> results;
+   for( const string tag : { "a0", "b0", "a1", "b1" } )
+   {
+      game_result_transaction result;
+      result.game_id = tag[ 0 ] == 'a' ? 90 : 91;
+      result.data = fc::mutable_variant_object( "tag", tag );
+      results.push_back( result );
+   }
+   chain_database_test_access::store_game_result_transactions( *chain, block_num, results );
+   wallet->start_scan( block_num, 1, false );
+
+   const auto seen = [&]( const string& record_id ) -> fc::variant_object
+   {
+      return fc::json::from_string( wallet->get_transaction( record_id ).contract ).get_object();
+   };
+
+   // PLAY.scan_results gets every result of its game in one call
+   const fc::variant_object batch = seen( "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa1" );
+   BOOST_CHECK( batch[ "typed" ].as_bool() );
+   BOOST_CHECK_EQUAL( batch[ "block_num" ].as_uint64(), block_num );
+   BOOST_CHECK_EQUAL( fc::json::to_string( batch[ "indexes" ] ), "[0,2]" );
+   BOOST_CHECK_EQUAL( fc::json::to_string( batch[ "tags" ] ), "[\"a0\",\"a1\"]" );
+   BOOST_CHECK_THROW( wallet->get_transaction( "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa2" ), fc::exception );
+
+   // PLAY.scan_result still sees each result on its own, with its index in the block
+   const fc::variant_object first = seen( "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb1" );
+   BOOST_CHECK_EQUAL( first[ "index" ].as_uint64(), 1u );
+   BOOST_CHECK_EQUAL( first[ "tag" ].as_string(), "b0" );
+   const fc::variant_object second = seen( "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb2" );
+   BOOST_CHECK_EQUAL( second[ "index" ].as_uint64(), 3u );
+   BOOST_CHECK_EQUAL( second[ "tag" ].as_string(), "b1" );
+   BOOST_CHECK_THROW( wallet->get_transaction( "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb3" ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( game_scripts_read_and_write_data_records, chain_fixture )
+{ try {
+   bts::game::client& games = bts::game::client::get_current();
+   const chain_database_ptr chain = games.get_chain_database();
+   const game_id_type game_id = 92;
+
+   game_record game;
+   game.id = game_id;
+   game.name = "datarecords";
+   game.owner_account_id = game_record::god_owner_id;
+   // Odd blocks spend the call's budget down to a few units before scanning everything
+   game.script_code = R"(
+      var PLAY = {};
+      PLAY.global = function( game_id, assets ) { return true; };
+      PLAY.execute = function( blockchain, block_num, chainstate ) {
+         if( block_num % 2 ) {
+            var ids = [];
+            for( var i = 0; i < 99990; i++ ) ids.push( 1 );
+            chainstate.get_game_data_records( 92, ids );
+            chainstate.scan_game_data_records( 92, 1, 10, 2 );
+            chainstate.scan_game_data_records( 92, 1, 10 );
+            return 0;
+         }
+         chainstate.set_game_data_records( 92, [ { game_id: 92, data: { index: 7, value: 'p7' } },
+                                                 { game_id: 0, data: { index: 2 } } ] );
+         var result = {
+            records: chainstate.get_game_data_records( 92, [ 7, 2, 3 ] ),
+            pending: chainstate.scan_game_data_records( 92, 1, 10, 3 ),
+            committed: blockchain.scan_game_data_records( 92, 1, 10, 3 )
+         };
+         return { execute_results: [ result ], game_datas: [], diff_balances: [], diff_supply: [] };
+      };
+   )";
+   chain->store_game_record( game );
+
+   for( int32_t index = 1; index <= 6; ++index )
+   {
+      game_data_record record;
+      record.game_id = game_id;
+      record.data = fc::mutable_variant_object( "index", index )( "value", "c" + fc::to_string( index ) );
+      chain->store_game_data_record( game_id, index, record );
+   }
+
+   const auto engine = games.get_v8_engine( game.name );
+   const auto values = []( const fc::variant& records ) -> string
+   {
+      vector<string> result;
+      for( const fc::variant& record : records.get_array() )
+         result.push_back( record.is_null() ? "null" : record.get_object()[ "data" ].get_object()[ "value" ].as_string() );
+      return fc::json::to_string( result );
+   };
+
+   const pending_chain_state_ptr pending_state = std::make_shared<pending_chain_state>( chain );
+   engine->execute( game_id, chain, BTS_V0_GAME_EXECUTION_LIMITS_FORK_BLOCK_NUM, pending_state );
+   BOOST_REQUIRE_EQUAL( pending_state->game_result_transactions.size(), 1u );
+   const fc::variant_object result = pending_state->game_result_transactions[ 0 ].data.get_object();
+
+   // The chain state sees the script's own writes, the blockchain only what was committed
+   BOOST_CHECK_EQUAL( values( result[ "records" ] ), "[\"p7\",\"null\",\"c3\"]" );
+   BOOST_CHECK_EQUAL( values( result[ "pending" ] ), "[\"c1\",\"c3\",\"c4\"]" );
+   BOOST_CHECK_EQUAL( values( result[ "committed" ] ), "[\"c1\",\"c2\",\"c3\"]" );
+   BOOST_REQUIRE( pending_state->get_game_data_record( game_id, 7 ).valid() );
+   BOOST_CHECK( pending_state->get_game_data_record( game_id, 2 )->is_null() );
+
+   // Nine units are left after the lookups: the limited scan fits, scanning all six records does not
+   const pending_chain_state_ptr spent_state = std::make_shared<pending_chain_state>( chain );
+   try
+   {
+      engine->execute( game_id, chain, BTS_V0_GAME_EXECUTION_LIMITS_FORK_BLOCK_NUM + 1, spent_state );
+      BOOST_ERROR( "scanning past the budget did not throw" );
+   }
+   catch( const fc::exception& e )
+   {
+      BOOST_CHECK( e.to_detail_string().find( "Game script execution budget exceeded" ) != string::npos );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( market_feed_snapshot_skips_queued_blocks, chain_fixture )
+{ try {
+   using bts::rpc::market_feed;
+   using bts::rpc::market_feed_update;
+
+   const chain_database_ptr chain = clienta->get_chain();
+   const asset_id_type quote_id = 100;
+   const asset_id_type base_id = 0;
+
+   asset_record quote_asset = *chain->get_asset_record( base_id );
+   quote_asset.id = quote_id;
+   quote_asset.symbol = "FEED";
+   const auto owner = fc::ecc::private_key::regenerate( fc::sha256::hash( string( "market_feed" ) ) );
+   const market_index_key bid_key( price( fc::uint128_t( 1000000 ), quote_id, base_id ), address( owner.get_public_key() ) );
+
+   const pending_chain_state_ptr setup_state = std::make_shared<pending_chain_state>( chain );
+   setup_state->store_asset_record( quote_asset );
+   setup_state->store_bid_record( bid_key, order_record( 1000 ) );
+   setup_state->apply_changes();
+
+   // The test delivers the chain's notifications itself, so it decides which are still queued
+   market_feed feed( chain );
+   chain->remove_observer( &feed );
+
+   const uint32_t queued_block_num = chain->get_head_block_num() + 1;
+   produce_block( clienta );
+   BOOST_REQUIRE_EQUAL( chain->get_head_block_num(), queued_block_num );
+
+   vector<market_feed_update> received;
+   const market_feed_update snapshot = feed.subscribe( &received, quote_id, base_id,
+                                                       [&]( const market_feed_update& update ) { received.push_back( update ); } );
+   BOOST_CHECK( snapshot.snapshot );
+   BOOST_CHECK_EQUAL( snapshot.sequence, 0u );
+   BOOST_CHECK_EQUAL( snapshot.block_num, queued_block_num );
+   BOOST_REQUIRE_EQUAL( snapshot.orders.size(), 1u );
+   BOOST_CHECK_EQUAL( snapshot.orders[ 0 ].state.balance, 1000 );
+
+   // The change of the block that was queued when subscribing is in the snapshot already
+   const pending_chain_state_ptr block_state = std::make_shared<pending_chain_state>( chain );
+   block_state->bids[ bid_key ] = order_record( 1000 );
+   feed.state_changed( block_state );
+   BOOST_CHECK( received.empty() );
+
+   // Popping the block reverts it
+   const pending_chain_state_ptr undo_state = std::make_shared<pending_chain_state>( chain );
+   undo_state->bids[ bid_key ] = order_record( 0 );
+   feed.block_popped( undo_state );
+   feed.state_changed( undo_state );
+   BOOST_REQUIRE_EQUAL( received.size(), 1u );
+   BOOST_CHECK( received[ 0 ].undo );
+   BOOST_CHECK_EQUAL( received[ 0 ].sequence, 1u );
+   BOOST_CHECK_EQUAL( received[ 0 ].block_num, queued_block_num );
+   BOOST_REQUIRE_EQUAL( received[ 0 ].orders.size(), 1u );
+   BOOST_CHECK_EQUAL( received[ 0 ].orders[ 0 ].state.balance, 0 );
+
+   // Pushing it again is new to the subscriber
+   feed.state_changed( block_state );
+   BOOST_REQUIRE_EQUAL( received.size(), 2u );
+   BOOST_CHECK( !received[ 1 ].undo );
+   BOOST_CHECK_EQUAL( received[ 1 ].sequence, 2u );
+   BOOST_CHECK_EQUAL( received[ 1 ].block_num, queued_block_num );
+   BOOST_REQUIRE_EQUAL( received[ 1 ].orders.size(), 1u );
+   BOOST_CHECK_EQUAL( received[ 1 ].orders[ 0 ].state.balance, 1000 );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_FIXTURE_TEST_CASE( lookahead_deposit_claims_key, chain_fixture )
+{ try {
+   exec( clienta, "scan 0 100" );
+
+   const auto wallet = clienta->get_wallet();
+   const string account_name = "lookahead-account";
+   wallet->create_account( account_name );
+
+   const wallet_account_record account = wallet->get_account( account_name );
+   const private_key_type parent_key = wallet->get_private_key( address( account.active_key() ) );
+   const auto child_key = [&]( const uint32_t child_key_index ) -> public_key_type
+   {
+      fc::sha256::encoder enc;
+      fc::raw::pack( enc, child_key_index );
+      return extended_private_key( parent_key ).child( enc.result() ).get_public_key();
+   };
+
+   // A key past the next one, as if handed out by another copy of this wallet
+   const uint32_t claimed_index = account.last_child_key_index + 5;
+   const public_key_type claimed_key = child_key( claimed_index );
+   const address claimed_address( claimed_key );
+
+   // The window is filled in the background
+   for( uint32_t i = 0; i < 1000; ++i )
+   {
+      try
+      {
+         wallet->get_public_key( claimed_address );
+         break;
+      }
+      catch( const fc::exception& )
+      {
+         fc::usleep( fc::milliseconds( 10 ) );
+      }
+   }
+   BOOST_REQUIRE( wallet->get_public_key( claimed_address ) == claimed_key );
+
+   const auto record = wallet->transfer( asset( 10000 ), "delegate31", string( claimed_address ), "", vote_none, true );
+   clienta->network_broadcast_transaction( record.trx );
+   produce_block( clienta );
+   exec( clienta, "scan 0 100" );
+
+   BOOST_CHECK_EQUAL( wallet->get_account( account_name ).last_child_key_index, claimed_index );
+   BOOST_CHECK( wallet->get_private_key( claimed_address ).get_public_key() == claimed_key );
+
+   // New keys resume past the claimed one instead of handing it out again
+   BOOST_CHECK( wallet->get_new_public_key( account_name ) == child_key( claimed_index + 1 ) );
+   for( uint32_t i = 0; i < 10; ++i )
+      BOOST_CHECK( wallet->get_new_public_key( account_name ) != claimed_key );
+} FC_LOG_AND_RETHROW() }
+
 #if 0
 BOOST_FIXTURE_TEST_CASE( malicious_trading, chain_fixture )
 { try {
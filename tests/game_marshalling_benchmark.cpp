@@ -0,0 +1,236 @@
+/**
+ *  Measures what moving records between C++ and game scripts costs.
+ *
+ *  A dice game's execute is run over a set of bet records: for every bet the script reads
+ *  the record and the player's balance from the chain state, settles the bet, and writes
+ *  both back, as PLAY.execute does through get_game_data_record, get_balance_record and
+ *  set_game_data_record. The native callbacks marshal the records either through
+ *  v8_helper, or through JSON text as v8_helper used to; records per second are printed
+ *  for both.
+ *
+ *  game_marshalling_benchmark --records 5000 --rounds 10
+ */
+#include <bts/blockchain/balance_record.hpp>
+#include <bts/blockchain/game_record.hpp>
+#include <bts/game/v8_helper.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/log/logger_config.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+using namespace bts::blockchain;
+using namespace bts::game;
+
+namespace {
+
+class ArrayBufferAllocator : public v8::ArrayBuffer::Allocator {
+public:
+    virtual void* Allocate(size_t length) {
+        void* data = AllocateUninitialized(length);
+        return data == NULL ? data : memset(data, 0, length);
+    }
+    virtual void* AllocateUninitialized(size_t length) { return malloc(length); }
+    virtual void Free(void* data, size_t) { free(data); }
+};
+
+const char* const dice_game_script =
+   "var PLAY = {};\n"
+   "PLAY.execute = function(state, count) {\n"
+   "   var game_datas = [];\n"
+   "   for (var i = 0; i < count; i++) {\n"
+   "      var bet = state.get_game_data_record(i);\n"
+   "      var balance = state.get_balance_record(bet.data.owner);\n"
+   "      var won = (bet.data.roll * 7 + i) % 100 < bet.data.odds;\n"
+   "      bet.data.settled = true;\n"
+   "      bet.data.payout = won ? bet.data.amount * 2 : 0;\n"
+   "      balance.balance = balance.balance + bet.data.payout;\n"
+   "      state.set_balance_record(balance);\n"
+   "      state.set_game_data_record(bet);\n"
+   "      game_datas.push(bet.data.index);\n"
+   "   }\n"
+   "   return { execute_results: [], game_datas: game_datas, diff_balances: [], diff_supply: [] };\n"
+   "};\n";
+
+struct benchmark_state
+{
+   bool                                 through_json = false;
+   std::vector<game_data_record>        bets;
+   std::vector<balance_record>          balances;
+   uint64_t                             records_written = 0;
+};
+
+template<typename T>
+Local<Value> to_v8( Isolate* isolate, const benchmark_state& state, const T& value )
+{
+   if( !state.through_json )
+      return v8_helper::cpp_to_json( isolate, value );
+   const std::string json = fc::json::to_string( value );
+   return v8_helper::parseJson( isolate, String::NewFromUtf8( isolate, json.c_str() ) );
+}
+
+template<typename T>
+T from_v8( Isolate* isolate, const benchmark_state& state, Handle<Value> value )
+{
+   if( !state.through_json )
+      return v8_helper::json_to_cpp<T>( isolate, value );
+   const std::string json = *String::Utf8Value( v8_helper::toJson( isolate, value ) );
+   return fc::json::from_string( json ).as<T>();
+}
+
+benchmark_state& get_state( const v8::FunctionCallbackInfo<Value>& args )
+{
+   return *static_cast<benchmark_state*>( Local<External>::Cast( args.Data() )->Value() );
+}
+
+void get_game_data_record( const v8::FunctionCallbackInfo<Value>& args )
+{
+   benchmark_state& state = get_state( args );
+   args.GetReturnValue().Set( to_v8( args.GetIsolate(), state, state.bets[ args[0]->Uint32Value() ] ) );
+}
+
+void get_balance_record( const v8::FunctionCallbackInfo<Value>& args )
+{
+   benchmark_state& state = get_state( args );
+   const std::string owner = *String::Utf8Value( args[0] );
+   const size_t index = std::strtoul( owner.c_str() + owner.find( '_' ) + 1, nullptr, 10 );
+   args.GetReturnValue().Set( to_v8( args.GetIsolate(), state, state.balances[ index ] ) );
+}
+
+void set_game_data_record( const v8::FunctionCallbackInfo<Value>& args )
+{
+   benchmark_state& state = get_state( args );
+   const game_data_record bet = from_v8<game_data_record>( args.GetIsolate(), state, args[0] );
+   state.bets[ bet.get_game_data_index() ] = bet;
+   ++state.records_written;
+}
+
+void set_balance_record( const v8::FunctionCallbackInfo<Value>& args )
+{
+   benchmark_state& state = get_state( args );
+   from_v8<balance_record>( args.GetIsolate(), state, args[0] );
+   ++state.records_written;
+}
+
+void make_records( benchmark_state& state, const uint32_t count, const uint32_t players )
+{
+   for( uint32_t i = 0; i < players; ++i )
+   {
+      balance_record balance( address(), asset( 1000000, 1 ), 0 );
+      balance.balance = 1000000 + i;
+      balance.last_update = fc::time_point_sec( 1420000000 + i );
+      state.balances.push_back( balance );
+   }
+   for( uint32_t i = 0; i < count; ++i )
+   {
+      game_data_record bet;
+      bet.game_id = 1;
+      bet.data = fc::mutable_variant_object( "index", i )
+                                           ( "owner", "player_" + fc::to_string( uint64_t( i % players ) ) )
+                                           ( "round", i / 100 )
+                                           ( "roll", i * 31 % 100 )
+                                           ( "odds", 49 )
+                                           ( "amount", 1000 + i )
+                                           ( "memo", "bet " + fc::to_string( uint64_t( i ) ) )
+                                           ( "settled", false );
+      state.bets.push_back( bet );
+   }
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{ try {
+   namespace po = boost::program_options;
+   po::options_description options( "Options" );
+   options.add_options()
+      ( "help", "Print this help message and exit" )
+      ( "records", po::value<uint32_t>()->default_value( 5000 ), "Bet records settled by each execute" )
+      ( "players", po::value<uint32_t>()->default_value( 500 ), "Balance records the bets are spread over" )
+      ( "rounds", po::value<uint32_t>()->default_value( 10 ), "Executes per marshalling path" );
+
+   po::variables_map vm;
+   po::store( po::parse_command_line( argc, argv, options ), vm );
+   po::notify( vm );
+
+   if( vm.count( "help" ) )
+   {
+      std::cout << options << "\n";
+      return 0;
+   }
+
+   fc::configure_logging( fc::logging_config() );
+
+   V8::InitializeICU();
+   Platform* platform = platform::CreateDefaultPlatform();
+   V8::InitializePlatform( platform );
+   V8::Initialize();
+
+   ArrayBufferAllocator allocator;
+   Isolate::CreateParams create_params;
+   create_params.array_buffer_allocator = &allocator;
+   Isolate* isolate = Isolate::New( create_params );
+
+   benchmark_state state;
+   {
+      // v8_helper::toJson takes a Locker, so the isolate is always used under one
+      v8::Locker locker( isolate );
+      Isolate::Scope isolate_scope( isolate );
+      HandleScope handle_scope( isolate );
+
+      Local<Context> context = v8_helper::CreateShellContext( isolate );
+      Context::Scope context_scope( context );
+
+      Local<External> data = External::New( isolate, &state );
+      Local<Object> chain_state = Object::New( isolate );
+      chain_state->Set( String::NewFromUtf8( isolate, "get_game_data_record" ), FunctionTemplate::New( isolate, get_game_data_record, data )->GetFunction() );
+      chain_state->Set( String::NewFromUtf8( isolate, "get_balance_record" ), FunctionTemplate::New( isolate, get_balance_record, data )->GetFunction() );
+      chain_state->Set( String::NewFromUtf8( isolate, "set_game_data_record" ), FunctionTemplate::New( isolate, set_game_data_record, data )->GetFunction() );
+      chain_state->Set( String::NewFromUtf8( isolate, "set_balance_record" ), FunctionTemplate::New( isolate, set_balance_record, data )->GetFunction() );
+
+      TryCatch try_catch( isolate );
+      Local<Script> script = Script::Compile( String::NewFromUtf8( isolate, dice_game_script ) );
+      FC_ASSERT( !script.IsEmpty() && !script->Run().IsEmpty(), "${e}", ("e", v8_helper::ReportException( isolate, &try_catch )) );
+      Local<Object> play = context->Global()->Get( String::NewFromUtf8( isolate, "PLAY" ) )->ToObject();
+      Local<Function> execute = Local<Function>::Cast( play->Get( String::NewFromUtf8( isolate, "execute" ) ) );
+
+      const uint32_t records = vm["records"].as<uint32_t>();
+      const uint32_t rounds = vm["rounds"].as<uint32_t>();
+      std::cout << std::left << std::setw( 12 ) << "path" << std::right << std::setw( 16 ) << "records/s" << "\n";
+
+      for( const bool through_json : { true, false } )
+      {
+         state.through_json = through_json;
+         state.bets.clear();
+         state.balances.clear();
+         make_records( state, records, vm["players"].as<uint32_t>() );
+         state.records_written = 0;
+
+         const fc::time_point start = fc::time_point::now();
+         for( uint32_t round = 0; round < rounds; ++round )
+         {
+            HandleScope round_scope( isolate );
+            Local<Value> argv[2] = { chain_state, Integer::New( isolate, records ) };
+            Local<Value> result = execute->Call( context->Global(), 2, argv );
+            FC_ASSERT( !result.IsEmpty(), "${e}", ("e", v8_helper::ReportException( isolate, &try_catch )) );
+            v8_helper::json_to_cpp<fc::variant>( isolate, result );
+         }
+         const fc::microseconds elapsed = fc::time_point::now() - start;
+
+         std::cout << std::left << std::setw( 12 ) << (through_json ? "json" : "native") << std::right << std::fixed
+                   << std::setprecision( 0 ) << std::setw( 16 )
+                   << state.records_written / (std::max<int64_t>( elapsed.count(), 1 ) / 1000000.0) << "\n";
+      }
+   }
+
+   isolate->Dispose();
+   V8::Dispose();
+   V8::ShutdownPlatform();
+   delete platform;
+   return 0;
+} FC_CAPTURE_AND_LOG( (argc) ) return 1; }
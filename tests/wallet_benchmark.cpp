@@ -0,0 +1,159 @@
+/**
+ *  Measures what the wallet spends building and signing transfers.
+ *
+ *  A scratch chain is opened from a genesis that funds delegate0, and the delegate's key is
+ *  imported into a new wallet. Paying a list of new addresses through batch_transfer is timed
+ *  against paying some of them one transfer at a time; microseconds per payout are printed
+ *  for both. Nothing is broadcast.
+ *
+ *  Every signature needs the signer's private key: the time to look it up from the unlocked
+ *  wallet's key cache is printed next to the AES decrypt each use cost before the cache.
+ *
+ *  wallet_benchmark --payouts 10000 --transfers 1000 --key-lookups 10000
+ */
+#include <bts/blockchain/config.hpp>
+#include <bts/blockchain/genesis_state.hpp>
+#include <bts/blockchain/time.hpp>
+#include <bts/client/client.hpp>
+#include <bts/wallet/wallet.hpp>
+#include <bts/wallet/wallet_records.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+#include <fc/log/logger_config.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+using namespace bts::blockchain;
+using namespace bts::wallet;
+
+namespace {
+
+fc::ecc::private_key delegate_key( const uint32_t i )
+{
+   return fc::ecc::private_key::regenerate( fc::sha256::hash( "wallet_benchmark delegate" + fc::to_string( i ) ) );
+}
+
+/** Every delegate holds an equal share of the initial balance */
+void save_genesis( const fc::path& file )
+{
+   genesis_state config;
+   config.timestamp = bts::blockchain::now();
+
+   for( uint32_t i = 0; i < BTS_BLOCKCHAIN_NUM_DELEGATES; ++i )
+   {
+      genesis_delegate delegate_account;
+      delegate_account.name = "delegate" + fc::to_string( i );
+      delegate_account.owner = delegate_key( i ).get_public_key();
+      config.delegates.push_back( delegate_account );
+
+      genesis_balance balance;
+      balance.raw_address = pts_address( fc::ecc::public_key_data( delegate_account.owner ) );
+      balance.balance = double( BTS_BLOCKCHAIN_MAX_SHARES / 5 ) / BTS_BLOCKCHAIN_NUM_DELEGATES;
+      config.initial_balances.push_back( balance );
+   }
+
+   fc::json::save_to_file( config, file );
+}
+
+double microseconds_per( const fc::microseconds& elapsed, const size_t count )
+{
+   return elapsed.count() / double( std::max<size_t>( count, 1 ) );
+}
+
+} // anonymous namespace
+
+int main( int argc, char** argv )
+{ try {
+   namespace po = boost::program_options;
+   po::options_description options( "Options" );
+   options.add_options()
+      ( "help", "Print this help message and exit" )
+      ( "payouts", po::value<uint32_t>()->default_value( 10000 ), "Payouts made through batch_transfer" )
+      ( "transfers", po::value<uint32_t>()->default_value( 1000 ), "Payouts made one transfer at a time" )
+      ( "key-lookups", po::value<uint32_t>()->default_value( 10000 ), "Private key lookups per path" );
+
+   po::variables_map vm;
+   po::store( po::parse_command_line( argc, argv, options ), vm );
+   po::notify( vm );
+
+   if( vm.count( "help" ) )
+   {
+      std::cout << options << "\n";
+      return 0;
+   }
+
+   fc::configure_logging( fc::logging_config() );
+
+   fc::temp_directory data_dir;
+   save_genesis( data_dir.path() / "genesis.json" );
+
+   const auto client = std::make_shared<bts::client::client>( "wallet_benchmark" );
+   client->open( data_dir.path(), data_dir.path() / "genesis.json" );
+
+   // The scratch wallet is thrown away with its directory
+   const string password = fc::ecc::private_key::generate().get_secret().str();
+   const wallet_ptr wallet = client->get_wallet();
+   wallet->create( "wallet_benchmark", password );
+   wallet->unlock( password, 99999999 );
+   wallet->import_private_key( delegate_key( 0 ), string( "delegate0" ) );
+   wallet->start_scan( 0, -1, false );
+
+   const uint32_t payout_count = vm["payouts"].as<uint32_t>();
+   const uint32_t transfer_count = std::min( vm["transfers"].as<uint32_t>(), payout_count );
+
+   vector<std::pair<string, asset>> payouts;
+   payouts.reserve( payout_count );
+   for( uint32_t i = 0; i < payout_count; ++i )
+   {
+      const auto key = fc::ecc::private_key::regenerate( fc::sha256::hash( "payout" + fc::to_string( i ) ) );
+      payouts.emplace_back( string( address( key.get_public_key() ) ), asset( 10000 + i ) );
+   }
+
+   fc::time_point start = fc::time_point::now();
+   const auto records = wallet->batch_transfer( payouts, "delegate0", "", vote_none, true );
+   const fc::microseconds batch_elapsed = fc::time_point::now() - start;
+
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < transfer_count; ++i )
+      wallet->transfer( payouts[ i ].second, "delegate0", payouts[ i ].first, "", vote_none, true );
+   const fc::microseconds transfer_elapsed = fc::time_point::now() - start;
+
+   std::cout << std::left << std::setw( 16 ) << "path" << std::right << std::setw( 10 ) << "payouts"
+             << std::setw( 14 ) << "transactions" << std::setw( 14 ) << "us/payout" << "\n";
+   std::cout << std::fixed << std::setprecision( 1 );
+   std::cout << std::left << std::setw( 16 ) << "batch_transfer" << std::right << std::setw( 10 ) << payout_count
+             << std::setw( 14 ) << records.size() << std::setw( 14 ) << microseconds_per( batch_elapsed, payout_count ) << "\n";
+   std::cout << std::left << std::setw( 16 ) << "transfer" << std::right << std::setw( 10 ) << transfer_count
+             << std::setw( 14 ) << transfer_count << std::setw( 14 ) << microseconds_per( transfer_elapsed, transfer_count ) << "\n";
+
+   const private_key_type signer_key = delegate_key( 0 );
+   const address signer( signer_key.get_public_key() );
+   const uint32_t key_lookups = vm["key-lookups"].as<uint32_t>();
+
+   const fc::sha512 password_hash = fc::sha512::hash( password );
+   key_data encrypted_key;
+   encrypted_key.encrypt_private_key( password_hash, signer_key );
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < key_lookups; ++i )
+      FC_ASSERT( encrypted_key.decrypt_private_key( password_hash ) == signer_key );
+   const fc::microseconds decrypt_elapsed = fc::time_point::now() - start;
+
+   start = fc::time_point::now();
+   for( uint32_t i = 0; i < key_lookups; ++i )
+      FC_ASSERT( wallet->get_private_key( signer ) == signer_key );
+   const fc::microseconds cached_elapsed = fc::time_point::now() - start;
+
+   std::cout << "\n" << std::left << std::setw( 16 ) << "private key" << std::right << std::setw( 10 ) << "lookups"
+             << std::setw( 14 ) << "us/lookup" << "\n";
+   std::cout << std::left << std::setw( 16 ) << "decrypted" << std::right << std::setw( 10 ) << key_lookups
+             << std::setw( 14 ) << microseconds_per( decrypt_elapsed, key_lookups ) << "\n";
+   std::cout << std::left << std::setw( 16 ) << "cached" << std::right << std::setw( 10 ) << key_lookups
+             << std::setw( 14 ) << microseconds_per( cached_elapsed, key_lookups ) << "\n";
+
+   return 0;
+} FC_CAPTURE_AND_LOG( (argc) ) return 1; }